@@ -12,9 +12,37 @@
  * @{
  */
 
-/** Number of NeoPixels present on the PCB. */
+/** Number of NeoPixels present on the PCB; used when no count has been configured. */
 #define PIXELKEY_NEOPIXEL_COUNT         (4U)
 
+/** Maximum number of NeoPixels that may be configured; all per-pixel state must fit in @ref PIXELKEY_PIXEL_ARENA_SIZE. */
+#define PIXELKEY_NEOPIXEL_COUNT_MAX     (128U)
+
+/**
+ * Number of keyframe layers composited for each NeoPixel.
+ * Each layer holds a keyframe, color, and start time per NeoPixel in the pixel arena.
+ */
+#ifndef PIXELKEY_LAYER_COUNT
+#define PIXELKEY_LAYER_COUNT            (2U)
+#endif
+
+/** Size in bytes of the arena holding all per-pixel state, carved once at startup. */
+#define PIXELKEY_PIXEL_ARENA_SIZE       (8U * 1024U)
+
+/**
+ * Number of frames rendered ahead of the one being transmitted.
+ * Absorbs render stalls of up to this many frame periods at the cost of the same amount of command latency.
+ */
+#ifndef PIXELKEY_RENDER_AHEAD_FRAMES
+#define PIXELKEY_RENDER_AHEAD_FRAMES    (2U)
+#endif
+
+/** Reads the core cycle counter; it is started at boot to measure the cost of each frame. */
+#define HAL_CYCLES_GET()                (DWT->CYCCNT)
+
+/** Converts a number of core cycles to microseconds. */
+#define HAL_CYCLES_TO_US(cycles)        ((cycles) / (SystemCoreClock / 1000000UL))
+
 /** Length of the GPT waveform buffer. */
 #define NPDATA_GPT_BUFFER_LENGTH        (8U)
 
@@ -23,9 +51,6 @@
 /** Count for the high period of a 0-bit. */
 #define NPDATA_GPT_B0                   (15)
 
-/** Number of keyframes allowed to be queued. */
-#define PIXELKEY_KEYFRAME_QUEUE_LENGTH  (4)
-
 /** Command input buffer length. */
 #define PIXELKEY_INPUT_COMMAND_BUFFER_LENGTH    (256)
 
@@ -36,6 +61,16 @@
 
 #define PIXELKEY_DEFAULT_FRAMERATE      (30)
 
+/** The framerate governor is off by default; the configured framerate is used as-is. */
+#define PIXELKEY_DEFAULT_GOVERNOR       (0)
+
+#define PIXELKEY_DEFAULT_FRAMERATE_MIN  (10)
+
+#define PIXELKEY_DEFAULT_FRAMERATE_MAX  (60)
+
+/** Keyframes are evaluated for every frame by default rather than interpolated. */
+#define PIXELKEY_DEFAULT_EVAL_RATE      (0)
+
 #define PIXELKEY_DEFAULT_COM_ECHO       (0)
 
 #define PIXELKEY_DEFAULT_PHY_FREQUENCY  (800)
@@ -6,11 +6,14 @@
 #include "hal_tasks.h"
 
 #include "config.h"
+#include "palette.h"
 #include "serial.h"
 #include "neopixel.h"
 #include "pixelkey.h"
 #include "pixelkey_hal.h"
 #include "keyframes.h"
+#include "keyframe_pool.h"
+#include "framerate_governor.h"
 
 // Enable the SysTick clock and use the processor clock as the source.
 #define SYSTICK_CONFIG_VALUE    (SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_ENABLE_Msk)
@@ -23,21 +26,76 @@ FSP_CPP_HEADER
 void R_BSP_WarmStart(bsp_warm_start_event_t event);
 FSP_CPP_FOOTER
 
+static void cycle_counter_init(void);
 #if DIAGNOSTICS_ENABLE
 static void systick_init(void);
 #endif
 
 extern const serial_api_t g_hal_usb_serial;
 extern const config_api_t g_hal_config;
+extern const palette_api_t g_hal_palette;
+
+extern void pixelkey_task_do_frame(void);
 
 /* *****************************************************************************
  * Static variables
  * ****************************************************************************/
 
+/** Backing memory for all per-pixel state. */
+static uint8_t pixel_arena_mem[PIXELKEY_PIXEL_ARENA_SIZE] ALIGN(8);
+
+/** Arena that all per-pixel state is carved from at startup. */
+static arena_t pixel_arena;
+
 /* *****************************************************************************
  * Static functions
  * ****************************************************************************/
 
+/**
+ * Allocates all per-pixel state from the pixel arena and opens the NeoPixel data transfer.
+ * @param count Number of NeoPixels to allocate state for.
+ * @retval PIXELKEY_ERROR_NONE               All state was allocated.
+ * @retval PIXELKEY_ERROR_INDEX_OUT_OF_RANGE count is not supported.
+ * @retval PIXELKEY_ERROR_OUT_OF_MEMORY      The pixel arena is too small for count NeoPixels.
+ */
+static pixelkey_error_t pixel_state_init(uint32_t count)
+{
+    arena_init(&pixel_arena, pixel_arena_mem, sizeof(pixel_arena_mem));
+
+    pixelkey_error_t err = pixelkey_frameproc_init(&pixel_arena, count);
+    if (err == PIXELKEY_ERROR_NONE)
+    {
+        err = npdata_open(&pixel_arena, count);
+    }
+
+    return err;
+}
+
+/**
+ * Idle task; runs whenever no other tasks are queued.
+ */
+static void idle_task(void)
+{
+    // Return keyframes released during rendering to their pools.
+    keyframe_reclaim();
+
+    // Top up the frames rendered ahead.
+    pixelkey_task_do_frame();
+
+    hal_usb_idle();
+}
+
+/**
+ * Starts the core cycle counter used to measure the cost of each frame.
+ */
+static void cycle_counter_init(void)
+{
+    // The DWT is only clocked when trace is enabled.
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0U;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
 #if DIAGNOSTICS_ENABLE
 static void systick_init(void)
 {
@@ -56,7 +114,9 @@ static void systick_init(void)
 void hal_frame_timer_callback(timer_callback_args_t * p_args)
 {
     ARG_NOT_USED(p_args);
-    tasks_queue(TASK_FRAME_TX);
+
+    // Transmit straight from the interrupt so the frame period does not depend on the running task.
+    npdata_frame_send();
 }
 
 void hal_rtc_callback(rtc_callback_args_t *p_args)
@@ -80,6 +140,9 @@ pixelkey_error_t pixelkey_hal_frame_timer_update(framerate_t new_framerate)
     g_frame_timer.p_api->stop(&g_frame_timer_ctrl);
     g_frame_timer.p_api->reset(&g_frame_timer_ctrl);
 
+    // Frames rendered from here on are timed for the new rate.
+    npdata_framerate_set(new_framerate);
+
     if (FSP_SUCCESS != g_frame_timer.p_api->periodSet(&g_frame_timer_ctrl, new_period))
     {
         return PIXELKEY_ERROR_HAL_ERROR;
@@ -109,6 +172,10 @@ void hal_entry(void)
 
     config_data_t const * const p_config = config_get_or_default();
 
+    // Load the user palette stored next to the config.
+    palette_register(&g_hal_palette);
+    palette_init();
+
 #if DIAGNOSTICS_ENABLE
     // Configure SysTick for diagnostics
     systick_init();
@@ -118,16 +185,25 @@ void hal_entry(void)
     LOG_TIME_RESET_ALL();
 #endif
 
+    cycle_counter_init();
+
     // Setup initial data first.
-    pixelkey_frameproc_init((framerate_t)p_config->framerate);
-    color_gamma_build(p_config->gamma_factor);
+    // The per-pixel state is sized from the configured count; fall back to the PCB's NeoPixels if it does not fit.
+    if (pixel_state_init(p_config->num_neopixels) != PIXELKEY_ERROR_NONE)
+    {
+        if (pixel_state_init(PIXELKEY_NEOPIXEL_COUNT) != PIXELKEY_ERROR_NONE)
+        {
+            BKPT();
+        }
+    }
 
     pixelkey_commandproc_init();
 
     // Configure and open the peripherals
-    npdata_open();
     g_frame_timer.p_api->open(&g_frame_timer_ctrl, &g_frame_timer_cfg);
-    pixelkey_hal_frame_timer_update((framerate_t)p_config->framerate);
+    framerate_governor_init(p_config->flags_b.governor_enabled, (framerate_t)p_config->framerate,
+                            p_config->framerate_min, p_config->framerate_max);
+    pixelkey_hal_frame_timer_update(framerate_governor_framerate_get());
 
     g_usb.p_api->open(&g_usb_ctrl, &g_usb_cfg);
 
@@ -146,34 +222,41 @@ void hal_entry(void)
     p_kf_blink->args.color2_provided = true;
     p_kf_blink->args.period = 2.0f;
 
-    keyframe_fade_t * p_kf_fade = (keyframe_fade_t *) keyframe_fade_ctor(NULL);
-    p_kf_fade->args.colors[0] = color_red.hsv;
-    p_kf_fade->args.colors[0].value = 25;
-    p_kf_fade->args.colors[1] = color_green.hsv;
-    p_kf_fade->args.colors[1].value = 25;
-    p_kf_fade->args.colors[2] = color_blue.hsv;
-    p_kf_fade->args.colors[2].value = 25;
-    p_kf_fade->args.colors[3] = color_red.hsv;
-    p_kf_fade->args.colors[3].value = 25;
-    p_kf_fade->args.colors_len = 4;
-    p_kf_fade->args.fade_type = FADE_TYPE_CUBIC;
-    p_kf_fade->args.curve = cb_linear;
-    p_kf_fade->args.period = 6;
-    p_kf_fade->args.push_current = false;
+    // Four colors fit a short argument block, leaving the full-size blocks for parsed fades.
+    keyframe_fade_t * p_kf_fade = (keyframe_fade_t *) keyframe_fade_ctor(NULL, keyframe_fade_args_alloc(4), true);
+    p_kf_fade->p_args->colors[0] = color_red.hsv;
+    p_kf_fade->p_args->colors[0].value = 25;
+    p_kf_fade->p_args->colors[1] = color_green.hsv;
+    p_kf_fade->p_args->colors[1].value = 25;
+    p_kf_fade->p_args->colors[2] = color_blue.hsv;
+    p_kf_fade->p_args->colors[2].value = 25;
+    p_kf_fade->p_args->colors[3] = color_red.hsv;
+    p_kf_fade->p_args->colors[3].value = 25;
+    p_kf_fade->p_args->colors_len = 4;
+    p_kf_fade->p_args->fade_type = FADE_TYPE_CUBIC;
+    p_kf_fade->p_args->curve = cb_linear;
+    p_kf_fade->p_args->period = 6;
+    p_kf_fade->p_args->push_current = false;
     p_kf_fade->base.modifiers.repeat_count = -1;
 
     p_kf = (keyframe_base_t *)p_kf_fade;
 
-    pixelkey_keyframeproc_push(0, p_kf->p_api->clone(p_kf));
-    pixelkey_keyframeproc_push(1, p_kf->p_api->clone(p_kf));
-    pixelkey_keyframeproc_push(2, p_kf->p_api->clone(p_kf));
-    pixelkey_keyframeproc_push(3, p_kf->p_api->clone(p_kf));
+    // One broadcast instance is shared by every NeoPixel, so this never runs out of pool blocks.
+    p_kf->flags |= KEYFRAME_FLAG_BROADCAST;
+    p_kf->broadcast.refs = 1;
+    for (uint16_t i = 0; i < pixelkey_keyframeproc_pixel_count_get(); i++)
+    {
+        pixelkey_keyframeproc_push(i, p_kf);
+    }
+
+    // Release the templates; the NeoPixels keep their own references to the fade.
+    pixelkey_keyframeproc_release(p_kf);
+    keyframe_destroy(&p_kf_blink->base);
 
     // Do the frame processing so it is ready on the first timer overflow.
-    extern void pixelkey_task_do_frame(void);
     pixelkey_task_do_frame();
 
-    tasks_run(hal_usb_idle);
+    tasks_run(idle_task);
 }
 
 /*******************************************************************************************************************//**
@@ -14,72 +14,129 @@
 #include "pixelkey_errors.h"
 
 #include "config.h"
+#include "palette.h"
 
 /** Number of data flash blocks required by @ref config_data_t (rounds up). */
 #define DATA_FLASH_BLOCKS_PER_CONFIG    ((sizeof(config_data_t) + BSP_FEATURE_FLASH_LP_DF_BLOCK_SIZE - 1)/BSP_FEATURE_FLASH_LP_DF_BLOCK_SIZE)
 
+/** Number of data flash blocks required by @ref palette_data_t (rounds up). */
+#define DATA_FLASH_BLOCKS_PER_PALETTE   ((sizeof(palette_data_t) + BSP_FEATURE_FLASH_LP_DF_BLOCK_SIZE - 1)/BSP_FEATURE_FLASH_LP_DF_BLOCK_SIZE)
+
 // Grab the start of data flash from the linker script.
 extern char const __Data_Flash_Start;
 
 static pixelkey_error_t flash_config_write(config_data_t const * const p_config_data);
 static pixelkey_error_t flash_config_read(config_data_t ** pp_config_data);
+static pixelkey_error_t flash_palette_write(palette_data_t * const p_palette_data);
+static pixelkey_error_t flash_palette_read(palette_data_t const ** pp_palette_data);
 
 /** Pointer to the configuration struct at the start of the Data Flash section. */
 config_data_t const * const p_nv_config = (config_data_t *)((void *)&__Data_Flash_Start);
 
+/** Pointer to the palette struct in the Data Flash blocks following the configuration. */
+palette_data_t const * const p_nv_palette =
+    (palette_data_t *)((void *)(&__Data_Flash_Start + DATA_FLASH_BLOCKS_PER_CONFIG * BSP_FEATURE_FLASH_LP_DF_BLOCK_SIZE));
+
 /** Calculated NV memory CRC to validate the data. */
 static uint32_t nv_crc = UINT32_MAX;
 
+/** Calculated NV memory CRC to validate the palette. */
+static uint32_t nv_palette_crc = UINT32_MAX;
+
 const config_api_t g_hal_config =
 {
     .write = flash_config_write,
     .read = flash_config_read,
 };
 
-static pixelkey_error_t flash_config_write(config_data_t const * const p_config_data)
+const palette_api_t g_hal_palette =
 {
-    // Copy the config struct locally so we can CRC and set the length.
-    config_data_t data = *p_config_data;
-    data.header.length = sizeof(config_data_t);
+    .write = flash_palette_write,
+    .read = flash_palette_read,
+};
 
+/**
+ * Calculates the CRC-CCITT of a block of memory.
+ * @param[in]  p_data Pointer to the data.
+ * @param      length Number of bytes.
+ * @param[out] p_crc  Pointer to store the 16-bit CRC.
+ * @retval PIXELKEY_ERROR_NONE            CRC was calculated.
+ * @retval PIXELKEY_ERROR_NV_MEMORY_ERROR CRC peripheral could not be opened.
+ */
+static pixelkey_error_t flash_crc(void const * p_data, uint32_t length, uint32_t * p_crc)
+{
     if (FSP_SUCCESS != g_crc0.p_api->open(&g_crc0_ctrl, &g_crc0_cfg))
     {
         return PIXELKEY_ERROR_NV_MEMORY_ERROR;
     }
     crc_input_t crc_in =
     {
-        .p_input_buffer = &data.header.length,
-        .num_bytes = p_nv_config->header.length - sizeof(data.header.crc),
+        .p_input_buffer = (void *)p_data,
+        .num_bytes = length,
         .crc_seed = 0,
     };
     uint32_t crc = 0;
     g_crc0.p_api->calculate(&g_crc0_ctrl, &crc_in, &crc);
-    data.header.crc = crc & UINT16_MAX;  // Mask to make sure there are only 16-bits.
+    *p_crc = crc & UINT16_MAX;  // Mask to make sure there are only 16-bits.
 
     g_crc0.p_api->close(&g_crc0_ctrl);
+    return PIXELKEY_ERROR_NONE;
+}
 
+/**
+ * Erases and writes data flash blocks.
+ * @param[in] p_data     Pointer to the data to write.
+ * @param     p_nv       Pointer to the start of the data flash blocks.
+ * @param     length     Number of bytes to write.
+ * @param     num_blocks Number of blocks to erase.
+ * @retval PIXELKEY_ERROR_NONE            Write was successful.
+ * @retval PIXELKEY_ERROR_NV_MEMORY_ERROR NV memory error occurred on write.
+ */
+static pixelkey_error_t flash_blocks_write(void const * p_data, void const * p_nv, uint32_t length, uint32_t num_blocks)
+{
     if (FSP_SUCCESS != g_flash0.p_api->open(&g_flash0_ctrl, &g_flash0_cfg))
     {
         return PIXELKEY_ERROR_NV_MEMORY_ERROR;
     }
 
-    if (FSP_SUCCESS != g_flash0.p_api->erase(&g_flash0_ctrl, (uint32_t)((void *)p_nv_config), DATA_FLASH_BLOCKS_PER_CONFIG))
+    if (FSP_SUCCESS != g_flash0.p_api->erase(&g_flash0_ctrl, (uint32_t)p_nv, num_blocks))
     {
         g_flash0.p_api->close(&g_flash0_ctrl);
         return PIXELKEY_ERROR_NV_MEMORY_ERROR;
     }
 
-    if (FSP_SUCCESS != g_flash0.p_api->write(&g_flash0_ctrl, (uint32_t)((void *)&data), (uint32_t)((void *)p_nv_config), sizeof(config_data_t)))
+    if (FSP_SUCCESS != g_flash0.p_api->write(&g_flash0_ctrl, (uint32_t)p_data, (uint32_t)p_nv, length))
     {
         g_flash0.p_api->close(&g_flash0_ctrl);
         return PIXELKEY_ERROR_NV_MEMORY_ERROR;
     }
 
     g_flash0.p_api->close(&g_flash0_ctrl);
-    nv_crc = data.header.crc;
     return PIXELKEY_ERROR_NONE;
 }
 
+static pixelkey_error_t flash_config_write(config_data_t const * const p_config_data)
+{
+    // Copy the config struct locally so we can CRC and set the length.
+    config_data_t data = *p_config_data;
+    data.header.length = sizeof(config_data_t);
+
+    uint32_t crc = 0;
+    pixelkey_error_t err = flash_crc(&data.header.length, sizeof(config_data_t) - sizeof(data.header.crc), &crc);
+    if (err != PIXELKEY_ERROR_NONE)
+    {
+        return err;
+    }
+    data.header.crc = (uint16_t)crc;
+
+    err = flash_blocks_write(&data, p_nv_config, sizeof(config_data_t), DATA_FLASH_BLOCKS_PER_CONFIG);
+    if (err == PIXELKEY_ERROR_NONE)
+    {
+        nv_crc = data.header.crc;
+    }
+    return err;
+}
+
 static pixelkey_error_t flash_config_read(config_data_t ** pp_config_data)
 {
     if (p_nv_config->header.crc == UINT16_MAX && p_nv_config->header.length == UINT8_MAX)
@@ -89,21 +146,13 @@ static pixelkey_error_t flash_config_read(config_data_t ** pp_config_data)
 
     if (nv_crc == UINT32_MAX)
     {
-        if (FSP_SUCCESS != g_crc0.p_api->open(&g_crc0_ctrl, &g_crc0_cfg))
+        pixelkey_error_t err = flash_crc(&p_nv_config->header.length,
+                                         p_nv_config->header.length - sizeof(p_nv_config->header.crc),
+                                         &nv_crc);
+        if (err != PIXELKEY_ERROR_NONE)
         {
-            return PIXELKEY_ERROR_NV_MEMORY_ERROR;
+            return err;
         }
-        crc_input_t crc_in =
-        {
-            .p_input_buffer = (void *)&p_nv_config->header.length,
-            .num_bytes = p_nv_config->header.length - sizeof(p_nv_config->header.crc),
-            .crc_seed = 0,
-        };
-        uint32_t crc = 0;
-        g_crc0.p_api->calculate(&g_crc0_ctrl, &crc_in, &crc);
-        nv_crc = crc & UINT16_MAX;  // Mask to make sure there are only 16-bits.
-
-        g_crc0.p_api->close(&g_crc0_ctrl);
     }
 
     if (nv_crc != (uint32_t)p_nv_config->header.crc)
@@ -116,4 +165,61 @@ static pixelkey_error_t flash_config_read(config_data_t ** pp_config_data)
     return PIXELKEY_ERROR_NONE;
 }
 
+static pixelkey_error_t flash_palette_write(palette_data_t * const p_palette_data)
+{
+    // Fill the header in place; the palette is too large to copy onto the stack.
+    p_palette_data->header.length = sizeof(palette_data_t);
+    p_palette_data->header.version = PALETTE_DATA_VERSION;
+
+    uint32_t crc = 0;
+    pixelkey_error_t err = flash_crc(&p_palette_data->header.length,
+                                     sizeof(palette_data_t) - sizeof(p_palette_data->header.crc),
+                                     &crc);
+    if (err != PIXELKEY_ERROR_NONE)
+    {
+        return err;
+    }
+    p_palette_data->header.crc = (uint16_t)crc;
+
+    err = flash_blocks_write(p_palette_data, p_nv_palette, sizeof(palette_data_t), DATA_FLASH_BLOCKS_PER_PALETTE);
+    if (err == PIXELKEY_ERROR_NONE)
+    {
+        nv_palette_crc = p_palette_data->header.crc;
+    }
+    return err;
+}
+
+static pixelkey_error_t flash_palette_read(palette_data_t const ** pp_palette_data)
+{
+    if (p_nv_palette->header.crc == UINT16_MAX && p_nv_palette->header.length == UINT16_MAX)
+    {
+        return PIXELKEY_ERROR_NV_NOT_INITIALIZED;
+    }
+
+    if (p_nv_palette->header.length != sizeof(palette_data_t))
+    {
+        return PIXELKEY_ERROR_NV_CRC_MISMATCH;
+    }
+
+    if (nv_palette_crc == UINT32_MAX)
+    {
+        pixelkey_error_t err = flash_crc(&p_nv_palette->header.length,
+                                         sizeof(palette_data_t) - sizeof(p_nv_palette->header.crc),
+                                         &nv_palette_crc);
+        if (err != PIXELKEY_ERROR_NONE)
+        {
+            return err;
+        }
+    }
+
+    if (nv_palette_crc != (uint32_t)p_nv_palette->header.crc)
+    {
+        return PIXELKEY_ERROR_NV_CRC_MISMATCH;
+    }
+
+    *pp_palette_data = p_nv_palette;
+
+    return PIXELKEY_ERROR_NONE;
+}
+
 /** @} */
@@ -38,8 +38,50 @@
 
 static void push_data_to_buffer(uint32_t * const p_block);
 
-/** NeoPixel frame buffer. */
-volatile color_rgb_t g_npdata_frame[PIXELKEY_NEOPIXEL_COUNT] = {0};
+/** Number of frame buffers; one is being transmitted while the rest hold frames rendered ahead. */
+#define NPDATA_FRAME_SLOTS          (PIXELKEY_RENDER_AHEAD_FRAMES + 1U)
+
+static_assert(PIXELKEY_RENDER_AHEAD_FRAMES >= 1U && NPDATA_FRAME_SLOTS <= UINT8_MAX, "Unsupported render-ahead depth.");
+
+/** Frame buffer being transmitted; one of @ref npdata_frames. */
+volatile color_rgb_t * g_npdata_frame = NULL;
+
+/**
+ * Ring of frame buffers; @ref npdata_pixel_count elements each, allocated by @ref npdata_open.
+ * Frames from @ref npdata_frame_tail up to @ref npdata_frame_head are rendered and waiting to be sent. The slot before
+ * the tail is the one being transmitted, so the renderer stops when the head reaches it.
+ */
+static color_rgb_t * npdata_frames[NPDATA_FRAME_SLOTS] = {0};
+
+/** Slot the next frame is rendered into; only written by the renderer. */
+static volatile uint8_t npdata_frame_head = 0;
+
+/** Slot of the next frame to send; only written by @ref npdata_frame_send. */
+static volatile uint8_t npdata_frame_tail = 0;
+
+/** Cycle count when the current transmission started. */
+static uint32_t npdata_tx_start = 0;
+
+/** Number of core cycles the last completed transmission took. */
+static volatile uint32_t npdata_tx_cycles = 0;
+
+/** Number of transmissions started; wraps. */
+static volatile uint32_t npdata_tx_count = 0;
+
+/**
+ * Time the frame being transmitted is shown; advanced by @ref npdata_frame_period each time a transmission starts.
+ * Frame n after the tail is shown at this time plus n + 1 frame periods.
+ */
+static volatile timestep_t npdata_clock = 0;
+
+/** Time between frame timer ticks. */
+static volatile timestep_t npdata_frame_period = 0;
+
+/** Number of NeoPixels in the frame buffer. */
+static uint32_t npdata_pixel_count = 0;
+
+/** Number of DMAC blocks needed to transfer a frame. */
+static uint16_t npdata_num_blocks = 0;
 
 /** GPT compare ping-pong buffer for generating NeoPixel timing waveforms. */
 static volatile uint32_t npdata_gpt_buffer[2][NPDATA_GPT_BUFFER_LENGTH] ALIGN(4) = {0};
@@ -104,6 +146,7 @@ void dmac0_repeat_isr(void)
         // Shutdown the transfer.
         g_npdata_timer.p_api->stop(&g_npdata_timer_ctrl);
         g_npdata_transfer.p_api->disable(&g_npdata_transfer_ctrl);
+        npdata_tx_cycles = HAL_CYCLES_GET() - npdata_tx_start;
         LOG_TIME(DIAG_TIMING_FRAME_TX);
         LOG_TIME(DIAG_TIMING_FRAME_BLOCK_TX);
     }
@@ -152,6 +195,11 @@ static inline void push_data_to_buffer(uint32_t * const p_block)
             if (npdata_frame_cnt == 0)
             {
                 // No more elements left.
+                // Pad the rest of the final block with a low output; it becomes part of the reset period.
+                for (i++; i < NPDATA_GPT_BUFFER_LENGTH; i++)
+                {
+                    p_block[i] = 0U;
+                }
                 return;
             }
 
@@ -165,39 +213,148 @@ static inline void push_data_to_buffer(uint32_t * const p_block)
 }
 
 /**
- * Gets a pointer to the frame buffer.
- * @warning Do not write to the frame buffer while @ref npdata_status_get() returns @ref TRANSFER_STATUS_WORKING.
+ * Gets the next slot index in the frame ring.
+ * @param slot The current slot.
+ * @return The slot after slot.
  */
-volatile color_rgb_t * npdata_frame_buffer_get(void)
+static inline uint8_t npdata_slot_next(uint8_t slot)
 {
-    return g_npdata_frame;
+    return (uint8_t) ((slot + 1U) % NPDATA_FRAME_SLOTS);
 }
 
 /**
- * Kicks off a frame transmission to the attached NeoPixels.
+ * Gets a pointer to the back frame buffer to render the next frame into.
+ * The back buffer is never transmitted so it may be written at any time; call @ref npdata_frame_commit once the
+ * frame is complete.
+ * @return Pointer to the back buffer of @ref npdata_pixel_count colors or NULL if @ref PIXELKEY_RENDER_AHEAD_FRAMES
+ *         frames are already waiting to be sent.
  */
-void npdata_frame_send(void)
+color_rgb_t * npdata_back_buffer_get(void)
 {
-#if CHECK_RENDER_UNDERFLOW
-    static uint32_t last_framecount = 0;
-    uint32_t current_framecount = pixelkey_keyframeproc_framecount_get();
-    if (current_framecount == last_framecount)
+    if (npdata_slot_next(npdata_frame_head) == npdata_frame_tail)
     {
-        LOG_SIGNAL(DIAG_SIGNAL_RENDER_UNDERFLOW);
+        return NULL;
     }
-#endif
 
-    // Check for a transmitting frame.
+    return npdata_frames[npdata_frame_head];
+}
+
+/**
+ * Gets the time the back buffer will be shown.
+ * Frames are timed by when they are sent rather than when they are rendered; if rendering falls behind, the skipped
+ * frame times are dropped instead of slowing the animations down.
+ * @return Time the frame rendered into @ref npdata_back_buffer_get will be sent.
+ */
+timestep_t npdata_back_buffer_time_get(void)
+{
+    FSP_CRITICAL_SECTION_DEFINE;
+
+    // The clock and tail are updated together by the frame timer interrupt.
+    FSP_CRITICAL_SECTION_ENTER;
+    const timestep_t clock = npdata_clock;
+    const uint32_t queued = (npdata_frame_head + NPDATA_FRAME_SLOTS - npdata_frame_tail) % NPDATA_FRAME_SLOTS;
+    FSP_CRITICAL_SECTION_EXIT;
+
+    return clock + (queued + 1U) * npdata_frame_period;
+}
+
+/**
+ * Drops the frames waiting to be sent which are shown at or after a time, so they are rendered again.
+ * The back buffer becomes the first dropped frame, still holding its earlier render; the frames before it are still
+ * sent.
+ * @param time Time of the earliest frame to drop.
+ */
+void npdata_frame_rewind(timestep_t time)
+{
+    FSP_CRITICAL_SECTION_DEFINE;
+
+    // The tail and clock must not move while the frames to keep are counted.
+    FSP_CRITICAL_SECTION_ENTER;
+    const uint8_t tail = npdata_frame_tail;
+    const uint32_t queued = (npdata_frame_head + NPDATA_FRAME_SLOTS - tail) % NPDATA_FRAME_SLOTS;
+    uint32_t keep = 0;
+    while (keep < queued && (int32_t) (npdata_clock + (keep + 1U) * npdata_frame_period - time) < 0)
+    {
+        keep++;
+    }
+    npdata_frame_head = (uint8_t) ((tail + keep) % NPDATA_FRAME_SLOTS);
+    FSP_CRITICAL_SECTION_EXIT;
+}
+
+/**
+ * Sets the time between frames; takes effect at the next frame timer tick.
+ * @param framerate The frame timer rate.
+ */
+void npdata_framerate_set(framerate_t framerate)
+{
+    npdata_frame_period = TIMESTEP_PER_SECOND / framerate;
+}
+
+/**
+ * Gets how long the last frame took to transmit.
+ * @return Number of core cycles from starting the last completed transmission to its end.
+ */
+uint32_t npdata_tx_cycles_get(void)
+{
+    return npdata_tx_cycles;
+}
+
+/**
+ * Gets the number of frames sent so far, counting each frame sent again when none were waiting.
+ * @return Number of transmissions started; this wraps back to zero.
+ */
+uint32_t npdata_tx_count_get(void)
+{
+    return npdata_tx_count;
+}
+
+/**
+ * Queues the back buffer to be transmitted after the frames already waiting.
+ * Must only be called after @ref npdata_back_buffer_get returned a buffer.
+ */
+void npdata_frame_commit(void)
+{
+    // Make sure the frame has been written before it is handed over.
+    __DMB();
+    npdata_frame_head = npdata_slot_next(npdata_frame_head);
+}
+
+/**
+ * Kicks off a frame transmission to the attached NeoPixels.
+ * This is called from the frame timer interrupt so frames keep going out while a long task is running.
+ */
+void npdata_frame_send(void)
+{
+    // Check for a transmitting frame. No frame is taken, so the clock stays with the frames waiting to be sent and
+    // they are shown one tick late rather than with the wrong times.
     if (npdata_status_get() == TRANSFER_STATUS_WORKING)
     {
         LOG_SIGNAL(DIAG_SIGNAL_NPDATA_OVERFLOW);
         return;
     }
 
+    // The frame sent now is shown one period after the last one, whether it was rendered or is sent again.
+    npdata_clock += npdata_frame_period;
+    npdata_tx_count++;
+
+    // Take the oldest rendered frame. When none are waiting the last frame is sent again.
+    const uint8_t tail = npdata_frame_tail;
+    if (tail != npdata_frame_head)
+    {
+        g_npdata_frame = npdata_frames[tail];
+        npdata_frame_tail = npdata_slot_next(tail);
+    }
+#if CHECK_RENDER_UNDERFLOW
+    else
+    {
+        LOG_SIGNAL(DIAG_SIGNAL_RENDER_UNDERFLOW);
+    }
+#endif
+
     // Initialize the buffers and state variables.
     npdata_frame_idx = NPDATA_FRAME_IDX_DEFAULT;
     npdata_color_bit = NPDATA_COLOR_BIT_DEFAULT;
-    npdata_frame_cnt = config_get_or_default()->num_neopixels;
+    npdata_frame_cnt = npdata_pixel_count;
     // NeoPixel data is transferred green-red-blue...
     // Copy it directly from the color_rgb_t struct.
     // color_rgb_t should be in the correct order unless the static_asserts were changed.
@@ -209,8 +366,7 @@ void npdata_frame_send(void)
 
     // Reconfigure the peripherals.
     // 1. Reset the DMAC source and block count.
-    const uint16_t num_blocks = (uint16_t)((config_get_or_default()->num_neopixels * NEOPIXEL_COLOR_BITS) / NPDATA_GPT_BUFFER_LENGTH);
-    g_npdata_transfer.p_api->reset(&g_npdata_transfer_ctrl, (void *) npdata_gpt_buffer[0], NULL, num_blocks);
+    g_npdata_transfer.p_api->reset(&g_npdata_transfer_ctrl, (void *) npdata_gpt_buffer[0], NULL, npdata_num_blocks);
 
     // Manually pre-fill the first two timings into the GPT buffers.
     // The source address will reload based on the high-word of the count register.
@@ -221,27 +377,49 @@ void npdata_frame_send(void)
     // Prefill the capture registers to zero, and start the timer to transfer the data.
     R_GPT5->GTCNT = 0;
     R_GPT5->GTCCR[3] = npdata_gpt_buffer[0][0];
+    npdata_tx_start = HAL_CYCLES_GET();
     LOG_TIME_START(DIAG_TIMING_FRAME_TX);
     LOG_TIME_START(DIAG_TIMING_FRAME_BLOCK_TX);
     g_npdata_timer.p_api->start(&g_npdata_timer_ctrl);
 
-    // Queue the task to render the next frame.
+    // Queue the task to render the frame which replaces this one in the ring.
     tasks_queue(TASK_FRAME_RENDER);
 }
 
 /**
  * Opens the peripherals needed for data transmission to the NeoPixels.
+ * @param[in] p_arena Pointer to the arena to allocate the frame buffer ring from.
+ * @param     count   Number of NeoPixels in a frame.
+ * @retval PIXELKEY_ERROR_NONE          The peripherals were opened.
+ * @retval PIXELKEY_ERROR_OUT_OF_MEMORY The arena does not have enough space for the frame buffers.
 */
-void npdata_open(void)
+pixelkey_error_t npdata_open(arena_t * p_arena, uint32_t count)
 {
+    for (size_t i = 0; i < NPDATA_FRAME_SLOTS; i++)
+    {
+        npdata_frames[i] = arena_alloc(p_arena, count * sizeof(color_rgb_t));
+        if (npdata_frames[i] == NULL)
+        {
+            return PIXELKEY_ERROR_OUT_OF_MEMORY;
+        }
+    }
+    npdata_pixel_count = count;
+
+    // Until the first frame is rendered the last slot, which is zeroed, is sent.
+    npdata_frame_head = 0;
+    npdata_frame_tail = 0;
+    g_npdata_frame = npdata_frames[NPDATA_FRAME_SLOTS - 1U];
+
     // Grab the PHY configuration.
     config_neopixel_phy_t const * const p_phy_settings = &config_get_or_default()->neopixel_phy;
 
-    // Update the transfer info with the macro values
+    // Update the transfer info with the frame size.
+    // The final block is padded when the frame does not fill it.
     extern transfer_info_t g_npdata_transfer_info;
-    const uint16_t num_blocks = (uint16_t)((config_get_or_default()->num_neopixels * NEOPIXEL_COLOR_BITS) / NPDATA_GPT_BUFFER_LENGTH);
+    const uint32_t frame_bits = count * NEOPIXEL_COLOR_BITS;
+    npdata_num_blocks = (uint16_t)((frame_bits + NPDATA_GPT_BUFFER_LENGTH - 1U) / NPDATA_GPT_BUFFER_LENGTH);
     g_npdata_transfer_info.length = NPDATA_GPT_BUFFER_LENGTH;
-    g_npdata_transfer_info.num_blocks = num_blocks;
+    g_npdata_transfer_info.num_blocks = npdata_num_blocks;
 
     g_npdata_timer.p_api->open(&g_npdata_timer_ctrl, &g_npdata_timer_cfg);
     g_npdata_transfer.p_api->open(&g_npdata_transfer_ctrl, &g_npdata_transfer_cfg);
@@ -255,21 +433,27 @@ void npdata_open(void)
     // Save the bit timings.
     npdata_b0_counts = (period * p_phy_settings->duty_cycle_b0 + 50U) / 100U;   // Convert from percentage to counts, rounding to nearest count.
     npdata_b1_counts = (period * p_phy_settings->duty_cycle_b1 + 50U) / 100U;
+
+    return PIXELKEY_ERROR_NONE;
 }
 
 /**
- * Copies a color to the specified index of the frame buffer.
+ * Copies a color to the specified index of the back frame buffer.
  * @param     index   The index to write.
  * @param[in] p_color Pointer to the color to copy.
  */
 void npdata_color_set(uint32_t index, color_rgb_t const * const p_color)
 {
-    if (index > PIXELKEY_NEOPIXEL_COUNT)
+    if (index >= npdata_pixel_count)
     {
         return;
     }
 
-    g_npdata_frame[index] = *p_color;
+    color_rgb_t * const p_frame = npdata_back_buffer_get();
+    if (p_frame != NULL)
+    {
+        p_frame[index] = *p_color;
+    }
 }
 
 /**
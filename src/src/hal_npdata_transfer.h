@@ -13,9 +13,7 @@
 
 #include "hal_device.h"
 #include "pixelkey.h"
-
-/** Size of the frame buffer in bytes. */
-#define NPDATA_FRAME_BUFFER_SIZE    (PIXELKEY_NEOPIXEL_COUNT * sizeof(color_rgb_t))
+#include "arena.h"
 
 /**
  * Status of the NeoPixel data transfer.
@@ -26,12 +24,18 @@ typedef enum e_transfer_status
     TRANSFER_STATUS_WORKING ///< A transfer is currently active.
 } transfer_status_t;
 
-void npdata_open(void);
+pixelkey_error_t npdata_open(arena_t * p_arena, uint32_t count);
 void npdata_frame_send(void);
+void npdata_frame_commit(void);
+void npdata_frame_rewind(timestep_t time);
+void npdata_framerate_set(framerate_t framerate);
+timestep_t npdata_back_buffer_time_get(void);
+uint32_t npdata_tx_cycles_get(void);
+uint32_t npdata_tx_count_get(void);
 void npdata_color_set(uint32_t index, color_rgb_t const * const p_color);
 transfer_status_t npdata_status_get(void);
 
-volatile color_rgb_t * npdata_frame_buffer_get(void);
+color_rgb_t * npdata_back_buffer_get(void);
 
 /** @} */
 
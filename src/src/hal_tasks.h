@@ -16,7 +16,6 @@
  */
 #define TASK_LIST \
     XTASK(REBOOT, pixelkey_reboot, Triggers a software reset.) \
-    XTASK(FRAME_TX, npdata_frame_send, Transmits the last rendered frame.) \
     XTASK(FRAME_RENDER, pixelkey_task_do_frame, Calculates the next frame.) \
     XTASK(TERMINAL_CONNECTED, pixelkey_task_terminal_connected, Sends strings for newly connected terminals.) \
     XTASK(CMD_RX, pixelkey_task_command_rx, Command string reception and parsing.) \
@@ -0,0 +1,68 @@
+/**
+ * @file
+ * @defgroup arena__internals Arena Internals
+ * @ingroup arena
+ * @{
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "arena.h"
+
+/**
+ * Initialize an arena over a memory region.
+ * @param[in] p_arena Pointer to the arena control struct.
+ * @param[in] p_mem   Pointer to the memory region; should be aligned to @ref ARENA_ALIGNMENT.
+ * @param     size    Size of the memory region in bytes.
+ */
+void arena_init(arena_t * p_arena, void * p_mem, size_t size)
+{
+    p_arena->p_base = p_mem;
+    p_arena->size = size;
+    p_arena->used = 0;
+}
+
+/**
+ * Allocates zeroed memory from an arena.
+ * @param[in] p_arena Pointer to the arena control struct.
+ * @param     size    Number of bytes to allocate.
+ * @return Pointer to the memory or NULL if the arena does not have enough space left.
+ */
+void * arena_alloc(arena_t * p_arena, size_t size)
+{
+    const size_t start = (p_arena->used + ARENA_ALIGNMENT - 1U) & ~(ARENA_ALIGNMENT - 1U);
+    if (start > p_arena->size || size > p_arena->size - start)
+    {
+        return NULL;
+    }
+
+    p_arena->used = start + size;
+
+    void * p_mem = &p_arena->p_base[start];
+    memset(p_mem, 0, size);
+    return p_mem;
+}
+
+/**
+ * Releases every allocation made from an arena.
+ * @param[in] p_arena Pointer to the arena control struct.
+ */
+void arena_reset(arena_t * p_arena)
+{
+    p_arena->used = 0;
+}
+
+/**
+ * Gets the number of bytes allocated from an arena, including alignment padding.
+ * @param[in] p_arena Pointer to the arena control struct.
+ * @return Bytes used.
+ */
+size_t arena_used(arena_t const * p_arena)
+{
+    return p_arena->used;
+}
+
+/** @} */
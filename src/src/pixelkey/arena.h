@@ -0,0 +1,33 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @file
+ * @defgroup arena Arena
+ * Bump allocator for state that is sized once at startup and lives until reboot.
+ * @{
+ */
+
+/** Alignment of every allocation; large enough for any element type. */
+#define ARENA_ALIGNMENT     (_Alignof(max_align_t))
+
+/** Arena control struct. */
+typedef struct st_arena
+{
+    uint8_t * p_base; ///< Pointer to the underlying memory region.
+    size_t    size;   ///< Size of the memory region in bytes.
+    size_t    used;   ///< Number of bytes allocated so far.
+} arena_t;
+
+void arena_init(arena_t * p_arena, void * p_mem, size_t size);
+void * arena_alloc(arena_t * p_arena, size_t size);
+void arena_reset(arena_t * p_arena);
+size_t arena_used(arena_t const * p_arena);
+
+/** @} */
+
+#endif // ARENA_H
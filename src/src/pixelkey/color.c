@@ -11,11 +11,29 @@
 #include <string.h>
 
 #include "color.h"
+#include "palette.h"
 
 /** Number of degrees in each sector of the hue component. */
 #define HUE_SECTOR_SIZE     (60U)
 /** Number of degrees in each sector of the hue component as a float-32. */
 #define HUE_SECTOR_SIZE_F32 (60.0f)
+/** Size of each sector of the hue component in the fixed-point representation. */
+#define HUE_SECTOR_SIZE_FP  (HUE_SECTOR_SIZE << HUE_FP_BITS)
+/** Number of sectors in the hue circle. */
+#define HUE_SECTOR_COUNT    (HUE_RANGE / HUE_SECTOR_SIZE)
+/** Total range of hue values in the fixed-point representation. */
+#define HUE_RANGE_FP        (HUE_RANGE << HUE_FP_BITS)
+
+/** Number of fractional bits used for the position of a hue within its sector. */
+#define COLOR_FP_FRAC_BITS  (9U)
+/** Fixed-point representation of 1.0 for the position of a hue within its sector. */
+#define COLOR_FP_ONE        (1U << COLOR_FP_FRAC_BITS)
+/** Full-scale value of the fixed-point HSV components: 100% x 100% x 1.0. */
+#define COLOR_FP_HSV_SCALE  ((VALUE_MAX * SATURATION_MAX) << COLOR_FP_FRAC_BITS)
+/** Full-scale value of the fixed-point HSL components: 2 x 100% x 100% x 1.0. */
+#define COLOR_FP_HSL_SCALE  ((2U * LIGHTNESS_MAX * SATURATION_MAX) << COLOR_FP_FRAC_BITS)
+/** Converts a fixed-point color component to an RGB value, rounding to the nearest value. */
+#define COLOR_FP_TO_RGB(x, scale) ((uint8_t) (((x) * RGB_MAX + (scale) / 2U) / (scale)))
 
 #ifndef max
 /** Maximum of two values. */
@@ -27,8 +45,11 @@
 #define min(a,b)    ((a) < (b) ? (a) : (b))
 #endif
 
-/** Maximum expected length of a hexadecimal color. */
-#define COLOR_RGB_HEX_STR_LENGTH    (7U)
+/** Number of hexadecimal digits in an RGB color, excluding the indicator. */
+#define COLOR_RGB_HEX_DIGITS        (6U)
+
+/** Maximum number of fractional hue digits used; further digits are consumed but ignored. */
+#define HUE_FRAC_DIGITS_MAX         (4U)
 
 /** Red: #FF0000. */
 const color_t color_red         = { .color_space = COLOR_SPACE_HSV, .hsv = { HUE(  0), 100, 100 } };
@@ -99,20 +120,21 @@ static const struct named_color
     { NULL, NULL }
 }; /**< List of named colors. Pointers are NULL terminated at end of the list. */
 
-/** Lookup table for gamma correction values. */
-static uint8_t gamma_table[RGB_MAX + 1] = {0};
+/** Lookup table mapping rendered RGB components to output components; see @ref color_output_build. */
+static uint8_t output_table[RGB_RANGE] = {0};
 
-static int parse_next_hex_byte(char ** p_str);
-static int parse_next_uint(char * p_str, int min, int max);
-static float parse_next_f32(char * p_str, float min, float max);
+static size_t scan_hex_byte(char const * p_str, size_t len, uint8_t * p_value);
+static size_t scan_uint(char const * p_str, size_t len, uint32_t max, uint32_t * p_value);
+static size_t scan_hue(char const * p_str, size_t len, uint16_t * p_hue);
+static size_t scan_separator(char const * p_str, size_t len);
 
 /**
- * Converts a color to the RGB color space.
+ * Converts a color to the RGB color space using floating-point math.
  * @param[in]  from  Color space to convert from.
  * @param[in]  p_in  Pointer to the color to convert from.
  * @param[out] p_out Pointer to the color converted to RGB.
  */
-static void color_convert_rgb(color_space_t from, color_kind_t const * p_in, color_rgb_t * p_out)
+static void color_convert_rgb_f32(color_space_t from, color_kind_t const * p_in, color_rgb_t * p_out)
 {
     switch (from)
     {
@@ -215,12 +237,12 @@ static void color_convert_rgb(color_space_t from, color_kind_t const * p_in, col
 }
 
 /**
- * Converts a color to the HSV color space.
+ * Converts a color to the HSV color space using floating-point math.
  * @param[in]  from  Color space to convert from.
  * @param[in]  p_in  Pointer to the color to convert from.
  * @param[out] p_out Pointer to the color converted to HSV.
  */
-static void color_convert_hsv(color_space_t from, color_kind_t const * p_in, color_hsv_t * p_out)
+static void color_convert_hsv_f32(color_space_t from, color_kind_t const * p_in, color_hsv_t * p_out)
 {
     switch (from)
     {
@@ -294,12 +316,12 @@ static void color_convert_hsv(color_space_t from, color_kind_t const * p_in, col
 }
 
 /**
- * Converts a color to the HSL color space.
+ * Converts a color to the HSL color space using floating-point math.
  * @param[in]  from  Color space to convert from.
  * @param[in]  p_in  Pointer to the color to convert from.
  * @param[out] p_out Pointer to the color converted to HSL.
  */
-static void color_convert_hsl(color_space_t from, color_kind_t const * p_in, color_hsl_t * p_out)
+static void color_convert_hsl_f32(color_space_t from, color_kind_t const * p_in, color_hsl_t * p_out)
 {
     switch (from)
     {
@@ -377,6 +399,330 @@ static void color_convert_hsl(color_space_t from, color_kind_t const * p_in, col
     }
 }
 
+/**
+ * Byte offsets within @ref color_rgb_t of the largest, middle, and smallest components for each hue sector.
+ * Using a table keeps the HSV/HSL -> RGB kernels free of a per-sector switch.
+ */
+static const uint8_t sector_layout[HUE_SECTOR_COUNT][3] =
+{
+    { offsetof(color_rgb_t, red),   offsetof(color_rgb_t, green), offsetof(color_rgb_t, blue)  },
+    { offsetof(color_rgb_t, green), offsetof(color_rgb_t, red),   offsetof(color_rgb_t, blue)  },
+    { offsetof(color_rgb_t, green), offsetof(color_rgb_t, blue),  offsetof(color_rgb_t, red)   },
+    { offsetof(color_rgb_t, blue),  offsetof(color_rgb_t, green), offsetof(color_rgb_t, red)   },
+    { offsetof(color_rgb_t, blue),  offsetof(color_rgb_t, red),   offsetof(color_rgb_t, green) },
+    { offsetof(color_rgb_t, red),   offsetof(color_rgb_t, blue),  offsetof(color_rgb_t, green) },
+};
+
+/**
+ * Writes the RGB components for a hue sector from the largest, middle, and smallest color components.
+ * @param      sector Hue sector, 0-5; values larger than 5 are treated as sector 5.
+ * @param      c_max  Largest color component.
+ * @param      c_mid  Middle color component.
+ * @param      c_min  Smallest color component.
+ * @param[out] p_out  Pointer to store the RGB color.
+ */
+static inline void rgb_from_sector(uint32_t sector, uint8_t c_max, uint8_t c_mid, uint8_t c_min, color_rgb_t * p_out)
+{
+    uint8_t const * const p_layout = sector_layout[min(sector, HUE_SECTOR_COUNT - 1U)];
+    uint8_t * const p_rgb = (uint8_t *) p_out;
+
+    p_rgb[p_layout[0]] = c_max;
+    p_rgb[p_layout[1]] = c_mid;
+    p_rgb[p_layout[2]] = c_min;
+}
+
+/**
+ * Gets the position of a hue within its sector.
+ * @param hue    Fixed-point hue.
+ * @param sector Hue sector of hue.
+ * @return Position within the sector from the smallest to the largest component, 0 to @ref COLOR_FP_ONE.
+ */
+static inline uint32_t sector_position(uint32_t hue, uint32_t sector)
+{
+    const uint32_t frac = ((hue % HUE_SECTOR_SIZE_FP) << COLOR_FP_FRAC_BITS) / HUE_SECTOR_SIZE_FP;
+
+    // Odd sectors fade the middle component down instead of up.
+    return (sector & 1U) ? (COLOR_FP_ONE - frac) : frac;
+}
+
+/**
+ * Calculates the fixed-point hue of an RGB color.
+ * @param rgb    The RGB color.
+ * @param c_max  Largest RGB component.
+ * @param chroma Difference between the largest and smallest RGB components.
+ * @return Fixed-point hue; see @ref HUE_FP_BITS.
+ */
+static inline uint16_t hue_from_rgb(color_rgb_t rgb, uint32_t c_max, uint32_t chroma)
+{
+    if (chroma == 0)
+    {
+        return 0;
+    }
+
+    uint32_t base;
+    uint32_t rising;
+    uint32_t falling;
+    if (c_max == rgb.red)
+    {
+        base = 0;
+        rising = rgb.green;
+        falling = rgb.blue;
+    }
+    else if (c_max == rgb.green)
+    {
+        base = 2U * HUE_SECTOR_SIZE_FP;
+        rising = rgb.blue;
+        falling = rgb.red;
+    }
+    else
+    {
+        base = 4U * HUE_SECTOR_SIZE_FP;
+        rising = rgb.red;
+        falling = rgb.green;
+    }
+
+    uint32_t hue;
+    if (rising >= falling)
+    {
+        hue = base + (HUE_SECTOR_SIZE_FP * (rising - falling) + chroma / 2U) / chroma;
+    }
+    else
+    {
+        // Wrap negative hues back around the circle.
+        hue = base + HUE_RANGE_FP - (HUE_SECTOR_SIZE_FP * (falling - rising) + chroma / 2U) / chroma;
+    }
+
+    if (hue >= HUE_RANGE_FP)
+    {
+        hue -= HUE_RANGE_FP;
+    }
+
+    return (uint16_t) hue;
+}
+
+/**
+ * Converts an HSV color to RGB using integer fixed-point math.
+ * @param[in]  p_in  Pointer to the HSV color.
+ * @param[out] p_out Pointer to store the RGB color.
+ */
+static inline void hsv_to_rgb_fp(color_hsv_t const * p_in, color_rgb_t * p_out)
+{
+    const uint32_t sector = (uint32_t) p_in->hue / HUE_SECTOR_SIZE_FP;
+    const uint32_t frac = sector_position(p_in->hue, sector);
+
+    // Components are scaled to 1/10000.
+    const uint32_t s = p_in->saturation;
+    const uint32_t v = p_in->value;
+    const uint32_t chroma = v * s;
+
+    const uint32_t c_max = (v * VALUE_MAX) << COLOR_FP_FRAC_BITS;
+    const uint32_t c_min = (v * VALUE_MAX - chroma) << COLOR_FP_FRAC_BITS;
+    const uint32_t c_mid = c_min + chroma * frac;
+
+    rgb_from_sector(sector,
+                    COLOR_FP_TO_RGB(c_max, COLOR_FP_HSV_SCALE),
+                    COLOR_FP_TO_RGB(c_mid, COLOR_FP_HSV_SCALE),
+                    COLOR_FP_TO_RGB(c_min, COLOR_FP_HSV_SCALE),
+                    p_out);
+}
+
+/**
+ * Converts an HSL color to RGB using integer fixed-point math.
+ * @param[in]  p_in  Pointer to the HSL color.
+ * @param[out] p_out Pointer to store the RGB color.
+ */
+static inline void hsl_to_rgb_fp(color_hsl_t const * p_in, color_rgb_t * p_out)
+{
+    const uint32_t sector = (uint32_t) p_in->hue / HUE_SECTOR_SIZE_FP;
+    const uint32_t frac = sector_position(p_in->hue, sector);
+
+    // Components are scaled to 1/20000 so the half-chroma offset stays an integer.
+    const uint32_t s = p_in->saturation;
+    const uint32_t l = p_in->lightness;
+    const uint32_t l2 = 2U * l;
+    const uint32_t chroma = s * (l2 > LIGHTNESS_MAX ? 2U * LIGHTNESS_MAX - l2 : l2);
+    const uint32_t center = 2U * LIGHTNESS_MAX * l;
+
+    const uint32_t c_max = (center + chroma) << COLOR_FP_FRAC_BITS;
+    const uint32_t c_min = (center - chroma) << COLOR_FP_FRAC_BITS;
+    const uint32_t c_mid = c_min + 2U * chroma * frac;
+
+    rgb_from_sector(sector,
+                    COLOR_FP_TO_RGB(c_max, COLOR_FP_HSL_SCALE),
+                    COLOR_FP_TO_RGB(c_mid, COLOR_FP_HSL_SCALE),
+                    COLOR_FP_TO_RGB(c_min, COLOR_FP_HSL_SCALE),
+                    p_out);
+}
+
+/**
+ * Converts an RGB color to HSV using integer fixed-point math.
+ * @param[in]  p_in  Pointer to the RGB color.
+ * @param[out] p_out Pointer to store the HSV color.
+ */
+static inline void rgb_to_hsv_fp(color_rgb_t const * p_in, color_hsv_t * p_out)
+{
+    const color_rgb_t rgb = *p_in;
+
+    const uint32_t M = max(max(rgb.green, rgb.blue), rgb.red);
+    const uint32_t m = min(min(rgb.green, rgb.blue), rgb.red);
+    const uint32_t chroma = M - m;
+
+    p_out->hue = hue_from_rgb(rgb, M, chroma);
+    p_out->value = (uint8_t) ((VALUE_MAX * M + RGB_MAX / 2U) / RGB_MAX);  // Convert 0-255 -> 0-100
+    if (M == 0) // Value == 0
+    {
+        p_out->saturation = 0;
+    }
+    else
+    {
+        p_out->saturation = (uint8_t) ((SATURATION_MAX * chroma + M / 2U) / M); // No need to convert 0-255 here.
+    }
+}
+
+/**
+ * Converts an RGB color to HSL using integer fixed-point math.
+ * @param[in]  p_in  Pointer to the RGB color.
+ * @param[out] p_out Pointer to store the HSL color.
+ */
+static inline void rgb_to_hsl_fp(color_rgb_t const * p_in, color_hsl_t * p_out)
+{
+    const color_rgb_t rgb = *p_in;
+
+    const uint32_t M = max(rgb.red, max(rgb.green, rgb.blue));
+    const uint32_t m = min(rgb.red, min(rgb.green, rgb.blue));
+    const uint32_t chroma = M - m;
+    const uint32_t sum = M + m;
+
+    p_out->hue = hue_from_rgb(rgb, M, chroma);
+    p_out->lightness = (uint8_t) ((LIGHTNESS_MAX * sum + RGB_MAX) / (2U * RGB_MAX));
+    if (chroma == 0)
+    {
+        p_out->saturation = 0;
+    }
+    else
+    {
+        const uint32_t l_range = (sum > RGB_MAX) ? (2U * RGB_MAX - sum) : sum;
+        p_out->saturation = (uint8_t) ((SATURATION_MAX * chroma + l_range / 2U) / l_range);
+    }
+}
+
+/**
+ * Converts an HSL color to HSV using integer fixed-point math.
+ * @param[in]  p_in  Pointer to the HSL color.
+ * @param[out] p_out Pointer to store the HSV color.
+ */
+static inline void hsl_to_hsv_fp(color_hsl_t const * p_in, color_hsv_t * p_out)
+{
+    const uint32_t s = p_in->saturation;
+    const uint32_t l = p_in->lightness;
+
+    // Value scaled to 1/10000.
+    const uint32_t v = l * LIGHTNESS_MAX + s * min(l, LIGHTNESS_MAX - l);
+
+    p_out->hue = p_in->hue; // Hue is the same in both HSV and HSL.
+    p_out->value = (uint8_t) ((v + VALUE_MAX / 2U) / VALUE_MAX);
+    if (v == 0)
+    {
+        p_out->saturation = 0;
+    }
+    else
+    {
+        p_out->saturation = (uint8_t) ((2U * SATURATION_MAX * (v - l * LIGHTNESS_MAX) + v / 2U) / v);
+    }
+}
+
+/**
+ * Converts an HSV color to HSL using integer fixed-point math.
+ * @param[in]  p_in  Pointer to the HSV color.
+ * @param[out] p_out Pointer to store the HSL color.
+ */
+static inline void hsv_to_hsl_fp(color_hsv_t const * p_in, color_hsl_t * p_out)
+{
+    const uint32_t s = p_in->saturation;
+    const uint32_t v = p_in->value;
+
+    // Lightness scaled to 1/20000.
+    const uint32_t l = v * (2U * SATURATION_MAX - s);
+    const uint32_t l_range = min(l, 2U * LIGHTNESS_MAX * LIGHTNESS_MAX - l);
+
+    p_out->hue = p_in->hue; // Hue is the same in both HSV and HSL.
+    p_out->lightness = (uint8_t) ((l + LIGHTNESS_MAX) / (2U * LIGHTNESS_MAX));
+    if (l_range == 0)
+    {
+        p_out->saturation = 0;
+    }
+    else
+    {
+        p_out->saturation = (uint8_t) ((SATURATION_MAX * v * s + l_range / 2U) / l_range);
+    }
+}
+
+/**
+ * Converts a color to the RGB color space using integer fixed-point math.
+ * @param[in]  from  Color space to convert from.
+ * @param[in]  p_in  Pointer to the color to convert from.
+ * @param[out] p_out Pointer to the color converted to RGB.
+ */
+static void color_convert_rgb_fp(color_space_t from, color_kind_t const * p_in, color_rgb_t * p_out)
+{
+    switch (from)
+    {
+        case COLOR_SPACE_HSL:
+            hsl_to_rgb_fp(&p_in->hsl, p_out);
+            break;
+        case COLOR_SPACE_HSV:
+            hsv_to_rgb_fp(&p_in->hsv, p_out);
+            break;
+        default:
+            *p_out = p_in->rgb;
+            break;
+    }
+}
+
+/**
+ * Converts a color to the HSV color space using integer fixed-point math.
+ * @param[in]  from  Color space to convert from.
+ * @param[in]  p_in  Pointer to the color to convert from.
+ * @param[out] p_out Pointer to the color converted to HSV.
+ */
+static void color_convert_hsv_fp(color_space_t from, color_kind_t const * p_in, color_hsv_t * p_out)
+{
+    switch (from)
+    {
+        case COLOR_SPACE_HSL:
+            hsl_to_hsv_fp(&p_in->hsl, p_out);
+            break;
+        case COLOR_SPACE_RGB:
+            rgb_to_hsv_fp(&p_in->rgb, p_out);
+            break;
+        default:
+            *p_out = p_in->hsv;
+            break;
+    }
+}
+
+/**
+ * Converts a color to the HSL color space using integer fixed-point math.
+ * @param[in]  from  Color space to convert from.
+ * @param[in]  p_in  Pointer to the color to convert from.
+ * @param[out] p_out Pointer to the color converted to HSL.
+ */
+static void color_convert_hsl_fp(color_space_t from, color_kind_t const * p_in, color_hsl_t * p_out)
+{
+    switch (from)
+    {
+        case COLOR_SPACE_HSV:
+            hsv_to_hsl_fp(&p_in->hsv, p_out);
+            break;
+        case COLOR_SPACE_RGB:
+            rgb_to_hsl_fp(&p_in->rgb, p_out);
+            break;
+        default:
+            *p_out = p_in->hsl;
+            break;
+    }
+}
+
 /**
  * Convert a color to a different color space.
  * @param      to    Desired color space to convert to.
@@ -385,302 +731,633 @@ static void color_convert_hsl(color_space_t from, color_kind_t const * p_in, col
  */
 void color_convert(color_space_t to, color_t const * p_in, color_t * p_out)
 {
+    const color_space_t from = p_in->color_space;
+    color_convert2(from, to, (color_kind_t const *)p_in, (color_kind_t *)p_out);
     p_out->color_space = to;
+}
+
+/**
+ * Convert a color to a different color space.
+ * Uses the floating-point or fixed-point conversions based on @ref COLOR_CONVERT_USE_F32.
+ * @param      from  Color space to convert from.
+ * @param      to    Desired color space to convert to.
+ * @param[in]  p_in  Pointer to the color in the original color space.
+ * @param[out] p_out Pointer to the color for the desired color space.
+ */
+void color_convert2(color_space_t from, color_space_t to, color_kind_t const * p_in, color_kind_t * p_out)
+{
+#if COLOR_CONVERT_USE_F32
+    color_convert2_f32(from, to, p_in, p_out);
+#else
+    color_convert2_fp(from, to, p_in, p_out);
+#endif
+}
 
+/**
+ * Convert a color to a different color space using floating-point math.
+ * @param      from  Color space to convert from.
+ * @param      to    Desired color space to convert to.
+ * @param[in]  p_in  Pointer to the color in the original color space.
+ * @param[out] p_out Pointer to the color for the desired color space.
+ */
+void color_convert2_f32(color_space_t from, color_space_t to, color_kind_t const * p_in, color_kind_t * p_out)
+{
     switch (to)
     {
         case COLOR_SPACE_RGB:
-            color_convert_rgb(p_in->color_space, (color_kind_t const *)p_in, &p_out->rgb);
+            color_convert_rgb_f32(from, p_in, &p_out->rgb);
             break;
         case COLOR_SPACE_HSV:
-            color_convert_hsv(p_in->color_space, (color_kind_t const *)p_in, &p_out->hsv);
+            color_convert_hsv_f32(from, p_in, &p_out->hsv);
             break;
         case COLOR_SPACE_HSL:
-            color_convert_hsl(p_in->color_space, (color_kind_t const *)p_in, &p_out->hsl);
+            color_convert_hsl_f32(from, p_in, &p_out->hsl);
             break;
     }
 }
 
 /**
- * Convert a color to a different color space.
+ * Convert a color to a different color space using integer fixed-point math.
  * @param      from  Color space to convert from.
  * @param      to    Desired color space to convert to.
  * @param[in]  p_in  Pointer to the color in the original color space.
  * @param[out] p_out Pointer to the color for the desired color space.
  */
-void color_convert2(color_space_t from, color_space_t to, color_kind_t const * p_in, color_kind_t * p_out)
+void color_convert2_fp(color_space_t from, color_space_t to, color_kind_t const * p_in, color_kind_t * p_out)
 {
     switch (to)
     {
         case COLOR_SPACE_RGB:
-            color_convert_rgb(from, p_in, &p_out->rgb);
+            color_convert_rgb_fp(from, p_in, &p_out->rgb);
             break;
         case COLOR_SPACE_HSV:
-            color_convert_hsv(from, p_in, &p_out->hsv);
+            color_convert_hsv_fp(from, p_in, &p_out->hsv);
             break;
         case COLOR_SPACE_HSL:
-            color_convert_hsl(from, p_in, &p_out->hsl);
+            color_convert_hsl_fp(from, p_in, &p_out->hsl);
             break;
     }
 }
 
+#if COLOR_CONVERT_USE_F32
+/** @internal Span kernel for HSV -> RGB. */
+#define HSV_TO_RGB(p_in, p_out) color_convert_rgb_f32(COLOR_SPACE_HSV, (color_kind_t const *) (p_in), (p_out))
+/** @internal Span kernel for HSL -> RGB. */
+#define HSL_TO_RGB(p_in, p_out) color_convert_rgb_f32(COLOR_SPACE_HSL, (color_kind_t const *) (p_in), (p_out))
+/** @internal Span kernel for RGB -> HSV. */
+#define RGB_TO_HSV(p_in, p_out) color_convert_hsv_f32(COLOR_SPACE_RGB, (color_kind_t const *) (p_in), (p_out))
+/** @internal Span kernel for RGB -> HSL. */
+#define RGB_TO_HSL(p_in, p_out) color_convert_hsl_f32(COLOR_SPACE_RGB, (color_kind_t const *) (p_in), (p_out))
+#else
+/** @internal Span kernel for HSV -> RGB. */
+#define HSV_TO_RGB(p_in, p_out) hsv_to_rgb_fp((p_in), (p_out))
+/** @internal Span kernel for HSL -> RGB. */
+#define HSL_TO_RGB(p_in, p_out) hsl_to_rgb_fp((p_in), (p_out))
+/** @internal Span kernel for RGB -> HSV. */
+#define RGB_TO_HSV(p_in, p_out) rgb_to_hsv_fp((p_in), (p_out))
+/** @internal Span kernel for RGB -> HSL. */
+#define RGB_TO_HSL(p_in, p_out) rgb_to_hsl_fp((p_in), (p_out))
+#endif
+
+/**
+ * Converts a span of HSV colors to RGB.
+ * @param[in]  p_in  Pointer to the first HSV color.
+ * @param[out] p_out Pointer to the first RGB color to write; must not overlap p_in.
+ * @param      n     Number of colors to convert.
+ */
+void color_convert_hsv_to_rgb_n(color_hsv_t const * restrict p_in, color_rgb_t * restrict p_out, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        HSV_TO_RGB(&p_in[i], &p_out[i]);
+    }
+}
+
+/**
+ * Converts a span of HSL colors to RGB.
+ * @param[in]  p_in  Pointer to the first HSL color.
+ * @param[out] p_out Pointer to the first RGB color to write; must not overlap p_in.
+ * @param      n     Number of colors to convert.
+ */
+void color_convert_hsl_to_rgb_n(color_hsl_t const * restrict p_in, color_rgb_t * restrict p_out, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        HSL_TO_RGB(&p_in[i], &p_out[i]);
+    }
+}
+
 /**
- * Parses the next hexadecimal byte from p_str and increments p_str.
- * @param[in,out] p_str Pointer to a string pointer to parse.
- * @return The next hexadecimal value parsed from p_str.
+ * Converts a span of RGB colors to HSV.
+ * @param[in]  p_in  Pointer to the first RGB color.
+ * @param[out] p_out Pointer to the first HSV color to write; must not overlap p_in.
+ * @param      n     Number of colors to convert.
  */
-static int parse_next_hex_byte(char ** p_str)
+void color_convert_rgb_to_hsv_n(color_rgb_t const * restrict p_in, color_hsv_t * restrict p_out, size_t n)
 {
-    if (p_str == NULL) { return 0; }
+    for (size_t i = 0; i < n; i++)
+    {
+        RGB_TO_HSV(&p_in[i], &p_out[i]);
+    }
+}
 
-    char hex_str[] = { 0, 0, 0 };
-    memcpy(hex_str, *p_str, 2);
-    (*p_str)++;
-    (*p_str)++;
-    return (int) strtoul(hex_str, NULL, 16);
+/**
+ * Converts a span of RGB colors to HSL.
+ * @param[in]  p_in  Pointer to the first RGB color.
+ * @param[out] p_out Pointer to the first HSL color to write; must not overlap p_in.
+ * @param      n     Number of colors to convert.
+ */
+void color_convert_rgb_to_hsl_n(color_rgb_t const * restrict p_in, color_hsl_t * restrict p_out, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        RGB_TO_HSL(&p_in[i], &p_out[i]);
+    }
 }
 
 /**
- * Parses the next integer in a list separated by commas.
- * @param[in,out] p_str Pointer to the string to parse, or NULL to continue from the last string.
- * @param         min   Minumum accepted value (inclusive).
- * @param         max   Maximum accepted value (exclusive).
- * @return the parsed integer or -1 on error or out of range.
+ * Gets the value of a hexadecimal digit.
+ * @param c Character to convert.
+ * @return The value of the digit, 0-15, or -1 if c is not a hexadecimal digit.
  */
-static int parse_next_uint(char * p_str, int min, int max)
+static inline int hex_digit_value(char c)
 {
-    char * p_tok = strtok(p_str, ",");
-    if (p_tok == NULL)
+    if (c >= '0' && c <= '9')
     {
-        return -1;
+        return c - '0';
     }
-    int value = atoi(p_tok);
-    if (value < min || value >= max)
+    if (c >= 'a' && c <= 'f')
     {
-        return -1;
+        return c - 'a' + 10;
     }
-    return value;
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
 }
 
 /**
- * Parses the next float in a list separated by commas.
- * @param[in,out] p_str Pointer to the string to parse, or NULL to continue from the last string.
- * @param         min   Minimum accepted value (inclusive).
- * @param         max   Maximum accepted value (exclusive).
- * @return the parsed float or NaN on error or out of range.
-*/
-static float parse_next_f32(char * p_str, float min, float max)
+ * Scans a two digit hexadecimal byte.
+ * @param[in]  p_str   Pointer to the characters to scan.
+ * @param      len     Number of characters available.
+ * @param[out] p_value Pointer to store the scanned byte.
+ * @return Number of characters consumed or 0 on error.
+ */
+static size_t scan_hex_byte(char const * p_str, size_t len, uint8_t * p_value)
 {
-    char * p_tok = strtok(p_str, ",");
-    if (p_tok == NULL)
+    if (len < 2)
     {
-        return -1;
+        return 0;
     }
-    float value = strtof(p_tok, NULL);
-    if (value < min || value >= max)
+
+    const int upper = hex_digit_value(p_str[0]);
+    const int lower = hex_digit_value(p_str[1]);
+    if (upper < 0 || lower < 0)
     {
-        return NAN;
+        return 0;
     }
-    return value;
+
+    *p_value = (uint8_t) ((upper << 4) | lower);
+    return 2;
 }
 
 /**
- * Parses a color from a string; must be NULL-terminated.
- * @param[in]  p_str       Pointer to the color string to parse; may be modified.
- * @param[out] p_color_out Pointer to store the parsed color.
- * @return true on success, false on failure.
+ * Scans an unsigned decimal integer.
+ * @param[in]  p_str   Pointer to the characters to scan.
+ * @param      len     Number of characters available.
+ * @param      max     Maximum accepted value (inclusive).
+ * @param[out] p_value Pointer to store the scanned integer.
+ * @return Number of characters consumed or 0 on error or out of range.
  */
-bool color_parse(char * p_str, color_t * p_color_out)
+static size_t scan_uint(char const * p_str, size_t len, uint32_t max, uint32_t * p_value)
 {
-    if (p_str == NULL)
+    uint32_t value = 0;
+    size_t i = 0;
+
+    while (i < len && p_str[i] >= '0' && p_str[i] <= '9')
     {
-        return false;
+        value = value * 10U + (uint32_t) (p_str[i] - '0');
+        if (value > max)
+        {
+            return 0;
+        }
+        i++;
     }
 
-    switch (*p_str)
+    if (i > 0)
     {
-        case '#':
+        *p_value = value;
+    }
+    return i;
+}
+
+/**
+ * Scans a decimal hue in degrees, with an optional fractional part, into the fixed-point representation.
+ * @param[in]  p_str Pointer to the characters to scan.
+ * @param      len   Number of characters available.
+ * @param[out] p_hue Pointer to store the scanned fixed-point hue.
+ * @return Number of characters consumed or 0 on error or out of range.
+ */
+static size_t scan_hue(char const * p_str, size_t len, uint16_t * p_hue)
+{
+    uint32_t degrees;
+    size_t i = scan_uint(p_str, len, HUE_MAX, &degrees);
+    if (i == 0)
+    {
+        return 0;
+    }
+
+    uint32_t hue = degrees << HUE_FP_BITS;
+    if (i < len && p_str[i] == '.')
+    {
+        i++;
+
+        uint32_t num = 0;
+        uint32_t den = 1;
+        size_t digits = 0;
+        while (i < len && p_str[i] >= '0' && p_str[i] <= '9')
         {
-            if (strlen(p_str) < COLOR_RGB_HEX_STR_LENGTH)
+            if (digits < HUE_FRAC_DIGITS_MAX)
             {
-                return false;
+                num = num * 10U + (uint32_t) (p_str[i] - '0');
+                den *= 10U;
             }
+            digits++;
+            i++;
+        }
 
-            p_color_out->color_space = COLOR_SPACE_RGB;
-            p_str++;    // Skip the indicator.
+        if (digits == 0)
+        {
+            // A decimal point must be followed by a digit.
+            return 0;
+        }
 
-            p_color_out->rgb.red = (uint8_t) parse_next_hex_byte(&p_str);
-            p_color_out->rgb.green = (uint8_t) parse_next_hex_byte(&p_str);
-            p_color_out->rgb.blue = (uint8_t) parse_next_hex_byte(&p_str);
+        hue += ((num << HUE_FP_BITS) + den / 2U) / den;
+        if (hue >= HUE_RANGE_FP)
+        {
+            // Rounded up to 360 degrees.
+            hue -= HUE_RANGE_FP;
         }
-        break;
-        case '%':
+    }
+
+    *p_hue = (uint16_t) hue;
+    return i;
+}
+
+/**
+ * Scans the separator between color components.
+ * @param[in] p_str Pointer to the characters to scan.
+ * @param     len   Number of characters available.
+ * @return 1 if a separator is next, otherwise 0.
+ */
+static size_t scan_separator(char const * p_str, size_t len)
+{
+    return (len > 0 && *p_str == ',') ? 1U : 0U;
+}
+
+/**
+ * Finds a built-in named color.
+ * @param[in] p_name Pointer to the name; does not need to be NULL-terminated.
+ * @param     len    Length of the name.
+ * @return Pointer to the named color or NULL if it does not exist.
+ */
+color_t const * color_named_find(char const * p_name, size_t len)
+{
+    for (size_t i = 0; named_colors[i].name != NULL; i++ )
+    {
+        if (len > 0 && named_colors[i].name[0] == p_name[0] &&
+            strncmp(p_name, named_colors[i].name, len) == 0 && named_colors[i].name[len] == '\0')
         {
-            p_color_out->color_space = COLOR_SPACE_RGB;
-            p_str++;    // Skip the indicator.
+            return named_colors[i].color;
+        }
+    }
+
+    return NULL;
+}
 
-            int pct_value = 0;
+/**
+ * Parses a color from the start of a string view without modifying it.
+ * 
+ * Supported forms are `#RRGGBB`, `%R,G,B` (percentages), `!H[,S[,V]]` (HSV), `!!H,S,L` (HSL),
+ * named colors, and user palette entries (see @ref pixelkey__palette). Parsing stops at the first character which is not part of the color,
+ * so the caller decides which characters may follow it.
+ * 
+ * @param[in]  p_str       Pointer to the characters to parse; does not need to be NULL-terminated.
+ * @param      len         Number of characters available.
+ * @param[out] p_color_out Pointer to store the parsed color.
+ * @return Number of characters consumed or 0 on failure.
+ */
+size_t color_parse_n(char const * p_str, size_t len, color_t * p_color_out)
+{
+    if (p_str == NULL || len == 0)
+    {
+        return 0;
+    }
 
-            pct_value = parse_next_uint(p_str, 0, 100);
-            if (pct_value < 0) { return false; }
-            p_color_out->rgb.red = (uint8_t) (UINT8_MAX * pct_value / 100);
+    size_t pos = 0;
+    size_t n;
+    switch (*p_str)
+    {
+        case '#':
+        {
+            pos++;  // Skip the indicator.
 
-            pct_value = parse_next_uint(NULL, 0, 100);
-            if (pct_value < 0) { return false; }
-            p_color_out->rgb.green = (uint8_t) (UINT8_MAX * pct_value / 100);
+            color_rgb_t rgb;
+            if ((n = scan_hex_byte(&p_str[pos], len - pos, &rgb.red)) == 0) { return 0; }
+            pos += n;
+            if ((n = scan_hex_byte(&p_str[pos], len - pos, &rgb.green)) == 0) { return 0; }
+            pos += n;
+            if ((n = scan_hex_byte(&p_str[pos], len - pos, &rgb.blue)) == 0) { return 0; }
+            pos += n;
 
-            pct_value = parse_next_uint(NULL, 0, 100);
-            if (pct_value < 0) { return false; }
-            p_color_out->rgb.blue = (uint8_t) (UINT8_MAX * pct_value / 100);
+            p_color_out->color_space = COLOR_SPACE_RGB;
+            p_color_out->rgb = rgb;
+        }
+        break;
+        case '%':
+        {
+            pos++;  // Skip the indicator.
 
-            if (strtok(NULL, ",") != NULL)
+            uint32_t pct[3];
+            for (size_t i = 0; i < 3; i++)
             {
-                // Too many color parts.
-                return false;
+                if (i > 0)
+                {
+                    if ((n = scan_separator(&p_str[pos], len - pos)) == 0) { return 0; }
+                    pos += n;
+                }
+                if ((n = scan_uint(&p_str[pos], len - pos, 100, &pct[i])) == 0) { return 0; }
+                pos += n;
             }
+
+            p_color_out->color_space = COLOR_SPACE_RGB;
+            p_color_out->rgb.red = (uint8_t) (UINT8_MAX * pct[0] / 100);
+            p_color_out->rgb.green = (uint8_t) (UINT8_MAX * pct[1] / 100);
+            p_color_out->rgb.blue = (uint8_t) (UINT8_MAX * pct[2] / 100);
         }
         break;
         case '!':
         {
-            bool is_hsl = false;
+            pos++;  // Skip the first indicator.
 
-            p_str++; // Skip the first indicator.
-            if (*p_str == '!')
-            {
-                // This is an HSL color.
-                p_color_out->color_space = COLOR_SPACE_HSL;
-                p_str++; // Skip the second indicator.
-                is_hsl = true;
-            }
-            else
-            {
-                // This is an HSV color.
-                p_color_out->color_space = COLOR_SPACE_HSV;
-            }
-
-            float parsed_value_f32 = parse_next_f32(p_str, 0.0, HUE_RANGE_F32);
-            if (isnan(parsed_value_f32)) { return false; }
+            const bool is_hsl = (pos < len && p_str[pos] == '!');
             if (is_hsl)
             {
-                p_color_out->hsl.hue = HUE_F32(parsed_value_f32);
-            }
-            else
-            {
-                p_color_out->hsv.hue = HUE_F32(parsed_value_f32);
+                pos++;  // Skip the second indicator.
             }
 
-            int32_t parsed_value = parse_next_uint(NULL, 0, 100);
-            if (is_hsl)
+            uint16_t hue;
+            if ((n = scan_hue(&p_str[pos], len - pos, &hue)) == 0) { return 0; }
+            pos += n;
+
+            // Saturation and value/lightness are optional; count how many were provided.
+            uint32_t parts[2] = { SATURATION_MAX, VALUE_MAX };
+            size_t parts_len = 0;
+            while (parts_len < 2 && (n = scan_separator(&p_str[pos], len - pos)) != 0)
             {
-                if (parsed_value < 0)
-                {
-                    p_color_out->hsl.saturation = SATURATION_MAX;
-                    p_color_out->hsl.lightness = LIGHTNESS_MAX;
-                    return true;
-                }
-                else
-                {
-                    p_color_out->hsl.saturation = (uint8_t) parsed_value;
-                }
-            }
-            else
-            {if (parsed_value < 0)
-                {
-                    p_color_out->hsv.saturation = SATURATION_MAX;
-                    p_color_out->hsv.value = VALUE_MAX;
-                    return true;
-                }
-                else
-                {
-                    p_color_out->hsv.saturation = (uint8_t) parsed_value;
-                }
+                size_t m = scan_uint(&p_str[pos + n], len - pos - n, 100, &parts[parts_len]);
+                if (m == 0) { return 0; }
+                pos += n + m;
+                parts_len++;
             }
 
-            parsed_value = parse_next_uint(NULL, 0, 100);
             if (is_hsl)
             {
-                if (parsed_value < 0)
-                {
-                    return false;
-                }
-                else
+                if (parts_len == 1)
                 {
-                    p_color_out->hsl.lightness = (uint8_t) parsed_value;
+                    // Lightness is required when saturation is provided.
+                    return 0;
                 }
+
+                p_color_out->color_space = COLOR_SPACE_HSL;
+                p_color_out->hsl = (color_hsl_t) { hue, (uint8_t) parts[0], (uint8_t) parts[1] };
             }
             else
             {
-                if (parsed_value < 0)
+                if (parts_len == 1)
                 {
-                    // Allow shortcut to value. The saturation is actually the value to use and assume 100% saturation.
-                    p_color_out->hsv.value = p_color_out->hsv.saturation;
-                    p_color_out->hsv.saturation = SATURATION_MAX;
+                    // Allow shortcut to value. The only part is the value to use and assume 100% saturation.
+                    parts[1] = parts[0];
+                    parts[0] = SATURATION_MAX;
                 }
-                else
-                {
-                    p_color_out->hsv.value = (uint8_t) parsed_value;
-                }
-            }
 
-            if (strtok(NULL, ",") != NULL)
-            {
-                // Too many color parts.
-                return false;
+                p_color_out->color_space = COLOR_SPACE_HSV;
+                p_color_out->hsv = (color_hsv_t) { hue, (uint8_t) parts[0], (uint8_t) parts[1] };
             }
         }
         break;
         default:
         {
-            // Assume this is a named color.
-            for (size_t i = 0; named_colors[i].name != NULL; i++ )
+            // Assume this is a built-in named color; names are made of lowercase letters.
+            while (pos < len && p_str[pos] >= 'a' && p_str[pos] <= 'z')
             {
-                if (strcmp(p_str, named_colors[i].name) == 0)
-                {
-                    *p_color_out = *named_colors[i].color;
-                    return true;
-                }
+                pos++;
+            }
+
+            color_t const * p_named = color_named_find(p_str, pos);
+            if (p_named != NULL && (pos == len || p_str[pos] != '.'))
+            {
+                *p_color_out = *p_named;
+                return pos;
             }
 
-            // The color isn't in the named color list.
-            return false;
+            // Otherwise it must be a user palette entry.
+            palette_entry_t const * p_entry;
+            if ((pos = palette_parse_n(p_str, len, &p_entry)) == 0)
+            {
+                return 0;
+            }
+            p_color_out->color_space = COLOR_SPACE_RGB;
+            p_color_out->rgb = p_entry->rgb;
         }
         break;
     }
 
-    return true;
+    return pos;
 }
 
 /**
- * Applies gamma correction to an RGB color.
- * @param[in,out] p_in  The color to correct.
- * @param[out]    p_out Pointer to write the corrected color, if NULL p_in is edited in place.
+ * Parses a color from a string; must be NULL-terminated.
+ * @param[in]  p_str       Pointer to the color string to parse.
+ * @param[out] p_color_out Pointer to store the parsed color.
+ * @return true on success, false on failure or if characters remain after the color.
  */
-void color_gamma_correct(color_rgb_t * p_in, color_rgb_t * p_out)
+bool color_parse(char const * p_str, color_t * p_color_out)
 {
-    if (p_out == NULL)
+    if (p_str == NULL)
     {
-        p_out = p_in;
+        return false;
     }
 
-    p_out->red = gamma_table[p_in->red];
-    p_out->green = gamma_table[p_in->green];
-    p_out->blue = gamma_table[p_in->blue];
+    const size_t len = strlen(p_str);
+    return len > 0 && color_parse_n(p_str, len, p_color_out) == len;
 }
 
 /**
- * Updates the gamma table with the provided correction factor.
- * @param gamma The gamma correction factor to use.
+ * Maps a span of rendered RGB colors through the output table built by @ref color_output_build.
+ * @param[in]  p_in  Pointer to the first rendered color.
+ * @param[out] p_out Pointer to the first output color to write; may be the same as p_in.
+ * @param      n     Number of colors to map.
+ */
+void color_output_apply_n(color_rgb_t const * p_in, color_rgb_t * p_out, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        p_out[i].blue = output_table[p_in[i].blue];
+        p_out[i].red = output_table[p_in[i].red];
+        p_out[i].green = output_table[p_in[i].green];
+    }
+}
+
+/**
+ * Blends one component of a color with the component beneath it.
+ * @param blend Blend mode; a constant when inlined so each mode gets its own loop.
+ * @param below Component beneath.
+ * @param above Component above.
+ * @return The blended component.
+ */
+static inline uint8_t blend_component(color_blend_t blend, uint8_t below, uint8_t above)
+{
+    switch (blend)
+    {
+        case COLOR_BLEND_ADD:
+        {
+            const uint16_t sum = (uint16_t) (below + above);
+            return (uint8_t) (sum > UINT8_MAX ? UINT8_MAX : sum);
+        }
+        case COLOR_BLEND_MULTIPLY:
+            return (uint8_t) (((uint16_t) below * above + UINT8_MAX) >> 8);
+        case COLOR_BLEND_MAX:
+            return below > above ? below : above;
+        case COLOR_BLEND_REPLACE:
+        default:
+            return above;
+    }
+}
+
+/**
+ * Mixes a blended component over the component beneath it.
+ * @param below   Component beneath.
+ * @param blended Blended component.
+ * @param opacity Amount of the blended component to show, 0 to 255.
+ * @return The mixed component, rounded to nearest.
+ */
+static inline uint8_t blend_mix(uint8_t below, uint8_t blended, uint8_t opacity)
+{
+    const uint32_t mix = (uint32_t) blended * opacity + (uint32_t) below * (UINT8_MAX - opacity) + UINT8_MAX / 2U;
+    return (uint8_t) (mix / UINT8_MAX);
+}
+
+/**
+ * Blends a span of colors in one mode; the loop has no branches once inlined for a constant mode.
+ * @see color_blend_n
+ */
+static inline void blend_span(color_blend_t blend, color_rgb_t const * restrict p_src,
+                              uint8_t const * restrict p_opacity, color_rgb_t * restrict p_dst, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        const color_rgb_t below = p_dst[i];
+        const color_rgb_t above = p_src[i];
+        const uint8_t opacity = p_opacity[i];
+        p_dst[i].blue = blend_mix(below.blue, blend_component(blend, below.blue, above.blue), opacity);
+        p_dst[i].red = blend_mix(below.red, blend_component(blend, below.red, above.red), opacity);
+        p_dst[i].green = blend_mix(below.green, blend_component(blend, below.green, above.green), opacity);
+    }
+}
+
+/**
+ * Blends a span of colors over the colors beneath them.
+ * Each output component is the blended component mixed with the one beneath by its opacity, so an opacity of 0
+ * leaves the color beneath unchanged and 255 gives the blended color.
+ * @param      blend     How the colors are combined.
+ * @param[in]  p_src     Pointer to the first color above.
+ * @param[in]  p_opacity Pointer to the opacity of the first color above, 0 to 255.
+ * @param[in,out] p_dst  Pointer to the first color beneath; receives the result.
+ * @param      n         Number of colors to blend.
+ */
+void color_blend_n(color_blend_t blend, color_rgb_t const * restrict p_src, uint8_t const * restrict p_opacity,
+                   color_rgb_t * restrict p_dst, size_t n)
+{
+    switch (blend)
+    {
+        case COLOR_BLEND_ADD:
+            blend_span(COLOR_BLEND_ADD, p_src, p_opacity, p_dst, n);
+            break;
+        case COLOR_BLEND_MULTIPLY:
+            blend_span(COLOR_BLEND_MULTIPLY, p_src, p_opacity, p_dst, n);
+            break;
+        case COLOR_BLEND_MAX:
+            blend_span(COLOR_BLEND_MAX, p_src, p_opacity, p_dst, n);
+            break;
+        case COLOR_BLEND_REPLACE:
+        default:
+            blend_span(COLOR_BLEND_REPLACE, p_src, p_opacity, p_dst, n);
+            break;
+    }
+}
+
+/**
+ * Linearly interpolates between two components.
+ * @param from Component at weight 0.
+ * @param to   Component at weight @ref COLOR_LERP_WEIGHT_MAX.
+ * @param w0   Weight of from.
+ * @param w1   Weight of to; w0 + w1 must be @ref COLOR_LERP_WEIGHT_MAX.
+ * @return The interpolated component, rounded to nearest.
+ */
+static inline uint8_t lerp_component(uint8_t from, uint8_t to, uint32_t w0, uint32_t w1)
+{
+    return (uint8_t) ((from * w0 + to * w1 + COLOR_LERP_WEIGHT_MAX / 2U) >> COLOR_LERP_WEIGHT_BITS);
+}
+
+/**
+ * Linearly interpolates between two spans of colors with one weight.
+ * @param[in]  p_from Pointer to the first color at weight 0.
+ * @param[in]  p_to   Pointer to the first color at weight @ref COLOR_LERP_WEIGHT_MAX.
+ * @param      weight Amount of p_to in the result, from 0 to @ref COLOR_LERP_WEIGHT_MAX.
+ * @param[out] p_out  Pointer to the first output color; may be the same as p_from or p_to.
+ * @param      n      Number of colors to interpolate.
+ */
+void color_lerp_n(color_rgb_t const * p_from, color_rgb_t const * p_to, uint16_t weight, color_rgb_t * p_out, size_t n)
+{
+    const uint32_t w1 = (weight < COLOR_LERP_WEIGHT_MAX) ? weight : COLOR_LERP_WEIGHT_MAX;
+    const uint32_t w0 = COLOR_LERP_WEIGHT_MAX - w1;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        const color_rgb_t from = p_from[i];
+        const color_rgb_t to = p_to[i];
+        p_out[i].blue = lerp_component(from.blue, to.blue, w0, w1);
+        p_out[i].red = lerp_component(from.red, to.red, w0, w1);
+        p_out[i].green = lerp_component(from.green, to.green, w0, w1);
+    }
+}
+
+/**
+ * Rebuilds the output table from the gamma correction and brightness settings.
+ * @param gamma_enabled true to apply gamma correction.
+ * @param gamma         The gamma correction factor to use.
+ * @param max_value     Maximum output value of any RGB component.
  * 
- * Builds the gamma table using the equation 
+ * Gamma and brightness are folded into a single table using the equation
  * @f[
- *  C_\gamma = 255 * \left( \frac{C}{255} \right)^\gamma + \frac{1}{2}
+ *  C_{out} = M * \left( \frac{C}{255} \right)^\gamma + \frac{1}{2}
  * @f]
+ * where @f$ M @f$ is max_value and @f$ \gamma @f$ is 1 when gamma correction is disabled.
  */
-void color_gamma_build(float gamma)
+void color_output_build(bool gamma_enabled, float gamma, uint8_t max_value)
 {
-    for (size_t i = 0; i < sizeof(gamma_table)/sizeof(gamma_table[0]); i++)
+    const float scale = (float) max_value;
+
+    for (size_t i = 0; i < RGB_RANGE; i++)
     {
-        gamma_table[i] = (uint8_t)(RGB_MAX_F32 * powf(((float) i) / RGB_MAX_F32, gamma) + 0.5);
+        float c = ((float) i) / RGB_MAX_F32;
+        if (gamma_enabled)
+        {
+            c = powf(c, gamma);
+        }
+        output_table[i] = (uint8_t) (scale * c + 0.5f);
     }
 }
 
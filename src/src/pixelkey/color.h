@@ -12,6 +12,14 @@
  * @{
  */
 
+#ifndef COLOR_CONVERT_USE_F32
+/**
+ * Selects the floating-point color conversions for @ref color_convert and @ref color_convert2 when set to 1.
+ * The integer fixed-point conversions are used by default.
+ */
+#define COLOR_CONVERT_USE_F32  (0)
+#endif
+
 /** Maximum value of an RGB color component. */
 #define RGB_MAX            (255U)
 /** Maximum value of an RGB color component as a float-32. */
@@ -129,6 +137,22 @@ static_assert(offsetof(color_t, hsv) == offsetof(color_kind_t, hsv), "The layout
 static_assert(offsetof(color_t, hsl) == offsetof(color_kind_t, hsl), "The layout of color_kind_t must match that of color_t.");
 static_assert(offsetof(color_t, rgb) == 0, "The color representations must be at the top of the color_t struct.");
 
+/** Ways of combining a color with the color beneath it; see @ref color_blend_n. */
+typedef enum e_color_blend
+{
+    COLOR_BLEND_REPLACE,  ///< The color above replaces the color beneath.
+    COLOR_BLEND_ADD,      ///< The colors are added, saturating at 255.
+    COLOR_BLEND_MULTIPLY, ///< The colors are multiplied as fractions of 255.
+    COLOR_BLEND_MAX,      ///< The larger of each component is kept.
+    COLOR_BLEND_COUNT,    ///< Number of blend modes.
+} color_blend_t;
+
+/** Fractional bits of the weights given to @ref color_lerp_n. */
+#define COLOR_LERP_WEIGHT_BITS  (8U)
+
+/** Weight at which @ref color_lerp_n gives the second color. */
+#define COLOR_LERP_WEIGHT_MAX   (1U << COLOR_LERP_WEIGHT_BITS)
+
 /**
  * @defgroup named_colors Named Colors
  * @{
@@ -154,12 +178,25 @@ extern const color_t color_off;
 void color_convert(color_space_t to, color_t const * p_in, color_t * p_out);
 
 void color_convert2(color_space_t from, color_space_t to, color_kind_t const * p_in, color_kind_t * p_out);
+void color_convert2_f32(color_space_t from, color_space_t to, color_kind_t const * p_in, color_kind_t * p_out);
+void color_convert2_fp(color_space_t from, color_space_t to, color_kind_t const * p_in, color_kind_t * p_out);
+
+void color_convert_hsv_to_rgb_n(color_hsv_t const * restrict p_in, color_rgb_t * restrict p_out, size_t n);
+void color_convert_hsl_to_rgb_n(color_hsl_t const * restrict p_in, color_rgb_t * restrict p_out, size_t n);
+void color_convert_rgb_to_hsv_n(color_rgb_t const * restrict p_in, color_hsv_t * restrict p_out, size_t n);
+void color_convert_rgb_to_hsl_n(color_rgb_t const * restrict p_in, color_hsl_t * restrict p_out, size_t n);
+
+color_t const * color_named_find(char const * p_name, size_t len);
+size_t color_parse_n(char const * p_str, size_t len, color_t * p_color_out);
+bool color_parse(char const * p_str, color_t * p_color_out);
 
-bool color_parse(char * p_str, color_t * p_color_out);
+void color_output_apply_n(color_rgb_t const * p_in, color_rgb_t * p_out, size_t n);
 
-void color_gamma_correct(color_rgb_t * p_in, color_rgb_t * p_out);
+void color_blend_n(color_blend_t blend, color_rgb_t const * restrict p_src, uint8_t const * restrict p_opacity,
+                   color_rgb_t * restrict p_dst, size_t n);
+void color_lerp_n(color_rgb_t const * p_from, color_rgb_t const * p_to, uint16_t weight, color_rgb_t * p_out, size_t n);
 
-void color_gamma_build(float gamma);
+void color_output_build(bool gamma_enabled, float gamma, uint8_t max_value);
 
 /** @} */
 
@@ -16,6 +16,7 @@
 
 #include "pixelkey_errors.h"
 #include "pixelkey_commands.h"
+#include "keyframe_pool.h"
 
 static char * trim(char * str);
 static void lower(char * str);
@@ -24,10 +25,15 @@ static pixelkey_error_t parse_no_args(cmd_type_t type, char * arg_ctx, cmd_t * p
 static pixelkey_error_t parse_config_get(char * arg_ctx, cmd_t * p_cmd);
 static pixelkey_error_t parse_config_set(char * arg_ctx, cmd_t * p_cmd);
 static pixelkey_error_t parse_time_set(char * arg_ctx, cmd_t * p_cmd);
+static pixelkey_error_t parse_palette_set(char * arg_ctx, cmd_t * p_cmd);
+static pixelkey_error_t parse_segment_set(char * arg_ctx, cmd_t * p_cmd);
+static pixelkey_error_t parse_layer_mod(char * arg_ctx, cmd_t * p_cmd);
 static pixelkey_error_t parse_keyframe(char * cmd_tok, cmd_t * p_cmd);
 
 /**
  * Parses a command string.
+ * A string may hold at most @ref PIXELKEY_COMMAND_BUFFER_LENGTH commands, as many as the command queue holds, which
+ * bounds the heap used by parsed commands.
  * @param[in]  command_str Pointer to the command string to parse.
  * @param[out] p_cmd_list  Pointer to store the command list. 
  */
@@ -53,6 +59,7 @@ pixelkey_error_t pixelkey_command_parse(char * command_str, cmd_list_t ** p_cmd_
 
     // Current command list node 
     cmd_list_t * p_list = *p_cmd_list;
+    size_t cmd_count = 1;
 
     do
     {
@@ -120,6 +127,26 @@ pixelkey_error_t pixelkey_command_parse(char * command_str, cmd_list_t ** p_cmd_
             {
                 parse_error = parse_no_args(CMD_TYPE_REBOOT, arg_ctx, p_cmd);
             }
+            else if (!strcmp(cmd_name, "$palette-set"))
+            {
+                parse_error = parse_palette_set(arg_ctx, p_cmd);
+            }
+            else if (!strcmp(cmd_name, "$palette-clear"))
+            {
+                parse_error = parse_no_args(CMD_TYPE_PALETTE_CLEAR, arg_ctx, p_cmd);
+            }
+            else if (!strcmp(cmd_name, "$palette-save"))
+            {
+                parse_error = parse_no_args(CMD_TYPE_PALETTE_SAVE, arg_ctx, p_cmd);
+            }
+            else if (!strcmp(cmd_name, "$segment-set"))
+            {
+                parse_error = parse_segment_set(arg_ctx, p_cmd);
+            }
+            else if (!strcmp(cmd_name, "$segment-clear"))
+            {
+                parse_error = parse_no_args(CMD_TYPE_SEGMENT_CLEAR, arg_ctx, p_cmd);
+            }
             else
             {
                 parse_error = PIXELKEY_ERROR_UNKNOWN_COMMAND;
@@ -150,6 +177,16 @@ pixelkey_error_t pixelkey_command_parse(char * command_str, cmd_list_t ** p_cmd_
                 }
             }
         }
+        else if (*cmd_tok == CMD_BROADCAST_MOD_PREFIX)
+        {
+            cmd_tok++;  // Move forward past the prefix.
+            parse_error = parse_no_args(CMD_TYPE_KEYFRAME_MOD_BROADCAST, cmd_tok, p_cmd);
+        }
+        else if (*cmd_tok == CMD_LAYER_MOD_PREFIX)
+        {
+            cmd_tok++;  // Move forward past the prefix.
+            parse_error = parse_layer_mod(cmd_tok, p_cmd);
+        }
         else if (*cmd_tok == CMD_SCHEDULE_MOD_PREFIX)
         {
             // Not supported yet
@@ -174,6 +211,13 @@ pixelkey_error_t pixelkey_command_parse(char * command_str, cmd_list_t ** p_cmd_
         cmd_tok = strtok_r(NULL, ";", &cmd_tok_ctx);
         if (cmd_tok != NULL && parse_error == PIXELKEY_ERROR_NONE)
         {
+            if (cmd_count++ == PIXELKEY_COMMAND_BUFFER_LENGTH)
+            {
+                // More commands than the queue can hold.
+                parse_error = PIXELKEY_ERROR_BUFFER_FULL;
+                break;
+            }
+
             p_list->p_next = (cmd_list_t *)malloc(sizeof(cmd_list_t));
             if (p_list->p_next == NULL)
             {
@@ -426,6 +470,252 @@ static pixelkey_error_t parse_config_set(char * arg_ctx, cmd_t * p_cmd)
     }
 }
 
+/**
+ * Parses palette-set command arguments; `<name> [index] <color>`.
+ * @param[in]     arg_ctx Argument tokenizer context.
+ * @param[in,out] p_cmd   Pointer to the command structure to populate.
+ * @retval PIXELKEY_ERROR_NOT_ENOUGH_ARGUMENTS Name or color was not provided.
+ * @retval PIXELKEY_ERROR_INVALID_ARGUMENT     Name, index, or color is invalid.
+ * @retval PIXELKEY_ERROR_TOO_MANY_ARGUMENTS   Additional, unexpected arguments were specified.
+ * @retval PIXELKEY_ERROR_OUT_OF_MEMORY        Failed to malloc argument structure.
+ * @retval PIXELKEY_ERROR_NONE                 Parsing was successful.
+ */
+static pixelkey_error_t parse_palette_set(char * arg_ctx, cmd_t * p_cmd)
+{
+    char * name = strtok_r(NULL, " ", &arg_ctx);
+    char * next_arg = strtok_r(NULL, " ", &arg_ctx);
+
+    p_cmd->type = CMD_TYPE_PALETTE_SET;
+    if (name == NULL || next_arg == NULL)
+    {
+        return PIXELKEY_ERROR_NOT_ENOUGH_ARGUMENTS;
+    }
+    if (!palette_name_valid(name, strlen(name)))
+    {
+        return PIXELKEY_ERROR_INVALID_ARGUMENT;
+    }
+
+    p_cmd->p_args = malloc(sizeof(cmd_args_palette_set_t));
+    if (p_cmd->p_args == NULL)
+    {
+        return PIXELKEY_ERROR_OUT_OF_MEMORY;
+    }
+    cmd_args_palette_set_t * p_args = p_cmd->p_args;
+    strcpy(p_args->name, name);
+    p_args->index = PALETTE_INDEX_NONE;
+
+    pixelkey_error_t err = PIXELKEY_ERROR_NONE;
+    do
+    {
+        // An index is only present when a color follows it.
+        char * color_arg = strtok_r(NULL, " ", &arg_ctx);
+        if (color_arg != NULL)
+        {
+            char * end_ptr = NULL;
+            long index = strtol(next_arg, &end_ptr, 10);
+            if (end_ptr == next_arg || *end_ptr != '\0' || index < 0 || index > PALETTE_INDEX_MAX)
+            {
+                err = PIXELKEY_ERROR_INVALID_ARGUMENT;
+                break;
+            }
+            p_args->index = (uint8_t) index;
+            next_arg = color_arg;
+        }
+
+        if (!color_parse(next_arg, &p_args->color))
+        {
+            err = PIXELKEY_ERROR_INVALID_ARGUMENT;
+            break;
+        }
+
+        if (strtok_r(NULL, " ", &arg_ctx) != NULL)
+        {
+            // Extra args; bad command.
+            err = PIXELKEY_ERROR_TOO_MANY_ARGUMENTS;
+            break;
+        }
+    } while (0);
+
+    if (err != PIXELKEY_ERROR_NONE)
+    {
+        free(p_cmd->p_args);
+        p_cmd->p_args = NULL;
+    }
+
+    return err;
+}
+
+/**
+ * Parses segment-set command arguments: a name, a 1-based channel or channel range, and a framerate.
+ * @param[in]     arg_ctx Argument tokenizer context.
+ * @param[in,out] p_cmd   Pointer to the command structure to populate.
+ * @retval PIXELKEY_ERROR_NOT_ENOUGH_ARGUMENTS The name, channels, or framerate was not provided.
+ * @retval PIXELKEY_ERROR_INVALID_ARGUMENT     The name, channels, or framerate is invalid.
+ * @retval PIXELKEY_ERROR_TOO_MANY_ARGUMENTS   Extra arguments follow the framerate.
+ */
+static pixelkey_error_t parse_segment_set(char * arg_ctx, cmd_t * p_cmd)
+{
+    char * name = strtok_r(NULL, " ", &arg_ctx);
+    char * channels = strtok_r(NULL, " ", &arg_ctx);
+    char * framerate = strtok_r(NULL, " ", &arg_ctx);
+
+    p_cmd->type = CMD_TYPE_SEGMENT_SET;
+    if (name == NULL || channels == NULL || framerate == NULL)
+    {
+        return PIXELKEY_ERROR_NOT_ENOUGH_ARGUMENTS;
+    }
+    if (strtok_r(NULL, " ", &arg_ctx) != NULL)
+    {
+        return PIXELKEY_ERROR_TOO_MANY_ARGUMENTS;
+    }
+    if (!segment_name_valid(name, strlen(name)))
+    {
+        return PIXELKEY_ERROR_INVALID_ARGUMENT;
+    }
+
+    // Channels are 1-based, as for keyframes.
+    char * end_ptr = NULL;
+    const long first = strtol(channels, &end_ptr, 10);
+    long last = first;
+    if (end_ptr != channels && *end_ptr == '-')
+    {
+        char * const last_str = end_ptr + 1;
+        last = strtol(last_str, &end_ptr, 10);
+        if (end_ptr == last_str)
+        {
+            return PIXELKEY_ERROR_INVALID_ARGUMENT;
+        }
+    }
+    if (end_ptr == channels || *end_ptr != '\0' || first < 1 || last < first || last > CMD_KEYFRAME_MAX_CHANNEL_NUMBER)
+    {
+        return PIXELKEY_ERROR_INVALID_ARGUMENT;
+    }
+
+    const long rate = strtol(framerate, &end_ptr, 10);
+    if (end_ptr == framerate || *end_ptr != '\0' || rate < FRAMERATE_MIN || rate > FRAMERATE_MAX)
+    {
+        return PIXELKEY_ERROR_INVALID_ARGUMENT;
+    }
+
+    p_cmd->p_args = malloc(sizeof(cmd_args_segment_set_t));
+    if (p_cmd->p_args == NULL)
+    {
+        return PIXELKEY_ERROR_OUT_OF_MEMORY;
+    }
+    cmd_args_segment_set_t * p_args = p_cmd->p_args;
+    strcpy(p_args->name, name);
+    p_args->first = (uint16_t) (first - 1);
+    p_args->count = (uint16_t) (last - first + 1);
+    p_args->framerate = (framerate_t) rate;
+
+    return PIXELKEY_ERROR_NONE;
+}
+
+/**
+ * Parses layer keyframe modifier arguments: a layer, then optionally a blend mode and an opacity percentage.
+ * @param[in]     arg_ctx Arguments following the prefix.
+ * @param[in,out] p_cmd   Pointer to the command structure to populate.
+ * @retval PIXELKEY_ERROR_NOT_ENOUGH_ARGUMENTS The layer was not provided.
+ * @retval PIXELKEY_ERROR_INVALID_ARGUMENT     The layer, blend mode, or opacity is invalid.
+ * @retval PIXELKEY_ERROR_TOO_MANY_ARGUMENTS   Extra arguments follow the opacity.
+ */
+static pixelkey_error_t parse_layer_mod(char * arg_ctx, cmd_t * p_cmd)
+{
+    /** Blend modes by name; alpha blending is a replace with less than full opacity. */
+    static const struct
+    {
+        char const *  name;
+        color_blend_t blend;
+    } blend_names[] =
+    {
+        { "replace", COLOR_BLEND_REPLACE },
+        { "alpha", COLOR_BLEND_REPLACE },
+        { "add", COLOR_BLEND_ADD },
+        { "multiply", COLOR_BLEND_MULTIPLY },
+        { "max", COLOR_BLEND_MAX },
+    };
+
+    p_cmd->type = CMD_TYPE_KEYFRAME_MOD_LAYER;
+
+    char * layer_arg = strtok_r(arg_ctx, " ", &arg_ctx);
+    if (layer_arg == NULL)
+    {
+        return PIXELKEY_ERROR_NOT_ENOUGH_ARGUMENTS;
+    }
+
+    char * end_ptr = NULL;
+    const long layer = strtol(layer_arg, &end_ptr, 10);
+    if (!isdigit((unsigned char) *layer_arg) || *end_ptr != '\0' || layer >= (long) PIXELKEY_LAYER_COUNT)
+    {
+        return PIXELKEY_ERROR_INVALID_ARGUMENT;
+    }
+
+    p_cmd->p_args = malloc(sizeof(cmd_args_keyframe_mod_layer_t));
+    if (p_cmd->p_args == NULL)
+    {
+        return PIXELKEY_ERROR_OUT_OF_MEMORY;
+    }
+    cmd_args_keyframe_mod_layer_t * p_args = p_cmd->p_args;
+    *p_args = (cmd_args_keyframe_mod_layer_t)
+    {
+        .layer = (uint8_t) layer,
+        .blend = COLOR_BLEND_REPLACE,
+        .opacity = UINT8_MAX,
+    };
+
+    pixelkey_error_t err = PIXELKEY_ERROR_NONE;
+    do
+    {
+        char * blend_arg = strtok_r(NULL, " ", &arg_ctx);
+        if (blend_arg == NULL)
+        {
+            break;
+        }
+
+        size_t i = 0;
+        while (i < sizeof(blend_names) / sizeof(blend_names[0]) && strcmp(blend_arg, blend_names[i].name))
+        {
+            i++;
+        }
+        if (i == sizeof(blend_names) / sizeof(blend_names[0]))
+        {
+            err = PIXELKEY_ERROR_INVALID_ARGUMENT;
+            break;
+        }
+        p_args->blend = blend_names[i].blend;
+        p_args->blend_provided = true;
+
+        char * opacity_arg = strtok_r(NULL, " ", &arg_ctx);
+        if (opacity_arg == NULL)
+        {
+            break;
+        }
+
+        const long percent = strtol(opacity_arg, &end_ptr, 10);
+        if (!isdigit((unsigned char) *opacity_arg) || *end_ptr != '\0' || percent > 100)
+        {
+            err = PIXELKEY_ERROR_INVALID_ARGUMENT;
+            break;
+        }
+        p_args->opacity = (uint8_t) ((percent * UINT8_MAX + 50) / 100);
+
+        if (strtok_r(NULL, " ", &arg_ctx) != NULL)
+        {
+            // Extra args; bad command.
+            err = PIXELKEY_ERROR_TOO_MANY_ARGUMENTS;
+            break;
+        }
+    } while (0);
+
+    if (err != PIXELKEY_ERROR_NONE)
+    {
+        free(p_cmd->p_args);
+        p_cmd->p_args = NULL;
+    }
+
+    return err;
+}
+
 /**
  * Parses time-set command arguments.
  * @param[in]     arg_ctx Argument tokenizer context.
@@ -730,7 +1020,7 @@ static pixelkey_error_t parse_keyframe(char * cmd_tok, cmd_t * p_cmd)
                 }
 
                 // Mark the MSB so the handler knows this is a range.
-                p_wrapper->channels[i++] = (uint16_t)(start | 0x8000);
+                p_wrapper->channels[i++] = (uint16_t)((uint32_t)start | CMD_KEYFRAME_CHANNEL_RANGE_FLAG);
                 p_wrapper->channels[i++] = (uint16_t)(end);
             }
             else
@@ -804,7 +1094,7 @@ void pixelkey_cmd_free(cmd_t * p_cmd)
         if (p_cmd->type == CMD_TYPE_KEYFRAME_WRAPPER)
         {
             cmd_args_keyframe_wrapper_t * p_wrapper = (cmd_args_keyframe_wrapper_t *)p_cmd->p_args;
-            free(p_wrapper->p_keyframe);
+            keyframe_destroy(p_wrapper->p_keyframe);
             p_wrapper->p_keyframe = NULL;
         }
         free(p_cmd->p_args);
@@ -23,12 +23,17 @@
 #include "pixelkey_errors.h"
 #include "pixelkey_commands.h"
 #include "pixelkey_hal.h"
+#include "keyframe_pool.h"
+#include "framerate_governor.h"
+#include "segment.h"
 
 #define CMDPROC_PROMPT_STR    "> "
 
 typedef void (*handler_fn_t)(void * p_cmd_args);
 
 static void send_trailer(bool is_nak, pixelkey_error_t error);
+static pixelkey_error_t framerate_apply(config_data_t const * p_config);
+static pixel_map_flag_t matrix_flag_find(char const * p_key);
 
 static void handler_undefined(void * p_cmd_args);
 static void handler_config_get(void * p_cmd_args);
@@ -41,10 +46,17 @@ static void handler_version(void * p_cmd_args);
 static void handler_time_get(void * p_cmd_args);
 static void handler_time_set(void * p_cmd_args);
 static void handler_reboot(void * p_cmd_args);
+static void handler_palette_set(void * p_cmd_args);
+static void handler_palette_clear(void * p_cmd_args);
+static void handler_palette_save(void * p_cmd_args);
+static void handler_segment_set(void * p_cmd_args);
+static void handler_segment_clear(void * p_cmd_args);
 static void handler_keyframe_wrapper(void * p_cmd_args);
 static void handler_keyframe_mod_repeat(void * p_cmd_args);
+static void handler_keyframe_mod_broadcast(void * p_cmd_args);
 static void handler_keyframe_mod_schedule(void * p_cmd_args);
 static void handler_keyframe_mod_group(void * p_cmd_args);
+static void handler_keyframe_mod_layer(void * p_cmd_args);
 
 static cmd_t * cmd_buffer_data[PIXELKEY_COMMAND_BUFFER_LENGTH] = {0};
 
@@ -66,6 +78,13 @@ static handler_fn_t cmd_handlers[CMD_TYPE_COUNT] =
     [CMD_TYPE_KEYFRAME_MOD_GROUP]    = handler_keyframe_mod_group,
     [CMD_TYPE_HELP]                  = handler_help,
     [CMD_TYPE_REBOOT]                = handler_reboot,
+    [CMD_TYPE_PALETTE_SET]           = handler_palette_set,
+    [CMD_TYPE_PALETTE_CLEAR]         = handler_palette_clear,
+    [CMD_TYPE_KEYFRAME_MOD_BROADCAST] = handler_keyframe_mod_broadcast,
+    [CMD_TYPE_KEYFRAME_MOD_LAYER]    = handler_keyframe_mod_layer,
+    [CMD_TYPE_SEGMENT_SET]           = handler_segment_set,
+    [CMD_TYPE_SEGMENT_CLEAR]         = handler_segment_clear,
+    [CMD_TYPE_PALETTE_SAVE]          = handler_palette_save,
 };
 
 // Make sure neither of these strings exceed 64 bytes!
@@ -78,8 +97,13 @@ static struct st_cmd_help
     { "$config-get", "Gets a configuration value." },
     { "$config-set", "Sets a configuration value." },
     { "$help, help, ?", "Displays a help message." },
+    { "$palette-clear", "Removes all user palette colors." },
+    { "$palette-save", "Saves user palette colors." },
+    { "$palette-set", "Sets a user palette color." },
     { "$reboot", "Reboots the PixelKey."},
     { "$resume", "Resume keyframe processing and rendering." },
+    { "$segment-clear", "Removes all strip segments." },
+    { "$segment-set", "Renders NeoPixels at their own framerate." },
     { "$status", "Shows device status and info." },
     { "$stop", "Stops keyframe processing and rendering." },
     { "$time-get", "Gets current system time." },
@@ -88,15 +112,37 @@ static struct st_cmd_help
     { "blink", "Keyframe to blink between two colors." },
     { "fade", "Keyframe to fade between colors." },
     { "set", "Keyframe to set the color of NeoPixels." },
+    { "*", "Broadcast keyframe modifier." },
     { "^<repeat>", "Repeat keyframe modifier." },
     { "@<schedule>", "Schedule keyframe modifier." },
     { "{[name], }", "Keyframe group modifier." },
+    { "|<layer>", "Layer keyframe modifier." },
 };
 #define CMD_HELP_COUNT  (sizeof(cmd_help)/sizeof(cmd_help[0]))
 
+/** Configuration keys of the matrix layout flags. */
+static struct st_matrix_flag_key
+{
+    char const * const     key;
+    pixel_map_flag_t const flag;
+} const matrix_flag_keys[] =
+{
+    { "matrix.serpentine", PIXEL_MAP_FLAG_SERPENTINE },
+    { "matrix.flip_x", PIXEL_MAP_FLAG_FLIP_X },
+    { "matrix.flip_y", PIXEL_MAP_FLAG_FLIP_Y },
+    { "matrix.mirror_x", PIXEL_MAP_FLAG_MIRROR_X },
+    { "matrix.mirror_y", PIXEL_MAP_FLAG_MIRROR_Y },
+};
+#define MATRIX_FLAG_KEY_COUNT   (sizeof(matrix_flag_keys)/sizeof(matrix_flag_keys[0]))
+
 static bool has_repeat_modifier = false;
 static int32_t repeat_modifier = 0;
 
+static bool has_broadcast_modifier = false;
+
+static bool has_layer_modifier = false;
+static uint8_t layer_modifier = 0;
+
 static bool has_schedule_modifier = false;
 static bool is_schedule_repeating = false;
 static keyframe_schedule_t schedule_modifier = {0};
@@ -202,6 +248,37 @@ static void send_trailer(bool is_nak, pixelkey_error_t error)
     serial()->flush();
 }
 
+/**
+ * Restarts the framerate governor from a configuration and updates the frame timer to its framerate.
+ * @param[in] p_config Pointer to the configuration.
+ * @return Error from updating the frame timer.
+ */
+static pixelkey_error_t framerate_apply(config_data_t const * p_config)
+{
+    framerate_governor_init(p_config->flags_b.governor_enabled, (framerate_t) p_config->framerate,
+                            p_config->framerate_min, p_config->framerate_max);
+
+    return pixelkey_hal_frame_timer_update(framerate_governor_framerate_get());
+}
+
+/**
+ * Finds the matrix layout flag set by a configuration key.
+ * @param[in] p_key Pointer to the key stringZ.
+ * @return The flag, or @ref PIXEL_MAP_FLAG_NONE if the key is not a matrix flag.
+ */
+static pixel_map_flag_t matrix_flag_find(char const * p_key)
+{
+    for (size_t i = 0; i < MATRIX_FLAG_KEY_COUNT; i++)
+    {
+        if (!strcmp(matrix_flag_keys[i].key, p_key))
+        {
+            return matrix_flag_keys[i].flag;
+        }
+    }
+
+    return PIXEL_MAP_FLAG_NONE;
+}
+
 static void handler_undefined(void * p_cmd_args)
 {
     ARG_NOT_USED(p_cmd_args);
@@ -295,6 +372,22 @@ static void handler_config_get(void * p_cmd_args)
     {
         len = sprintf(msg, "%"PRIu32"\n", p_config->framerate);
     }
+    else if (!strcmp("governor_enabled", p_args->key))
+    {
+        len = sprintf(msg, "%s\n", (p_config->flags_b.governor_enabled ? "true" : "false"));
+    }
+    else if (!strcmp("framerate_min", p_args->key))
+    {
+        len = sprintf(msg, "%"PRIu16"\n", p_config->framerate_min);
+    }
+    else if (!strcmp("framerate_max", p_args->key))
+    {
+        len = sprintf(msg, "%"PRIu16"\n", p_config->framerate_max);
+    }
+    else if (!strcmp("eval_rate", p_args->key))
+    {
+        len = sprintf(msg, "%"PRIu16"\n", p_config->eval_rate);
+    }
     else if (!strcmp("num_neopixels", p_args->key))
     {
         len = sprintf(msg, "%"PRIu32"\n", p_config->num_neopixels);
@@ -315,6 +408,22 @@ static void handler_config_get(void * p_cmd_args)
     {
         len = sprintf(msg, "%"PRIu16"\n", p_config->neopixel_phy.duty_cycle_b1);
     }
+    else if (!strcmp("matrix.width", p_args->key))
+    {
+        len = sprintf(msg, "%"PRIu16"\n", p_config->matrix.width);
+    }
+    else if (!strcmp("matrix.height", p_args->key))
+    {
+        len = sprintf(msg, "%"PRIu16"\n", p_config->matrix.height);
+    }
+    else if (!strcmp("matrix.rotation", p_args->key))
+    {
+        len = sprintf(msg, "%"PRIu16"\n", p_config->matrix.rotation);
+    }
+    else if (matrix_flag_find(p_args->key) != PIXEL_MAP_FLAG_NONE)
+    {
+        len = sprintf(msg, "%s\n", ((p_config->matrix.flags & matrix_flag_find(p_args->key)) ? "true" : "false"));
+    }
     else
     {
         send_trailer(true, PIXELKEY_ERROR_KEY_NOT_FOUND);
@@ -361,6 +470,11 @@ static void handler_config_set(void * p_cmd_args)
 
         new_config.flags_b.gamma_enabled = p_args->value.b;
         config_error = config()->write(&new_config);
+
+        if (config_error == PIXELKEY_ERROR_NONE)
+        {
+            pixelkey_keyframeproc_output_update();
+        }
     }
     else if (!strcmp("gamma_factor", p_args->key))
     {
@@ -375,7 +489,7 @@ static void handler_config_set(void * p_cmd_args)
 
         if (config_error == PIXELKEY_ERROR_NONE)
         {
-            color_gamma_build(new_config.gamma_factor);
+            pixelkey_keyframeproc_output_update();
         }
     }
     else if (!strcmp("framerate", p_args->key))
@@ -391,16 +505,91 @@ static void handler_config_set(void * p_cmd_args)
 
         if (config_error == PIXELKEY_ERROR_NONE)
         {
-            pixelkey_keyframeproc_framerate_set((framerate_t)new_config.framerate);
-            config_error = pixelkey_hal_frame_timer_update((framerate_t)new_config.framerate);
+            // Keyframes are timed independently of the framerate so they carry on at the new rate.
+            config_error = framerate_apply(&new_config);
+        }
+    }
+    else if (!strcmp("governor_enabled", p_args->key))
+    {
+        if (p_args->value_type != VALUE_TYPE_BOOLEAN)
+        {
+            send_trailer(true, PIXELKEY_ERROR_INVALID_ARGUMENT);
+            return;
+        }
+
+        new_config.flags_b.governor_enabled = p_args->value.b;
+        config_error = config()->write(&new_config);
+
+        if (config_error == PIXELKEY_ERROR_NONE)
+        {
+            config_error = framerate_apply(&new_config);
+        }
+    }
+    else if (!strcmp("framerate_min", p_args->key) || !strcmp("framerate_max", p_args->key))
+    {
+        if (p_args->value_type != VALUE_TYPE_INTEGER)
+        {
+            send_trailer(true, PIXELKEY_ERROR_INVALID_ARGUMENT);
+            return;
+        }
+
+        if (p_args->value.i32 < (int32_t) FRAMERATE_MIN || p_args->value.i32 > (int32_t) FRAMERATE_MAX)
+        {
+            send_trailer(true, PIXELKEY_ERROR_INVALID_ARGUMENT);
+            return;
+        }
+
+        if (!strcmp("framerate_min", p_args->key))
+        {
+            new_config.framerate_min = (uint8_t) p_args->value.i32;
+        }
+        else
+        {
+            new_config.framerate_max = (uint8_t) p_args->value.i32;
+        }
+        config_error = config()->write(&new_config);
+
+        if (config_error == PIXELKEY_ERROR_NONE)
+        {
+            config_error = framerate_apply(&new_config);
         }
     }
+    else if (!strcmp("eval_rate", p_args->key))
+    {
+        if (p_args->value_type != VALUE_TYPE_INTEGER)
+        {
+            send_trailer(true, PIXELKEY_ERROR_INVALID_ARGUMENT);
+            return;
+        }
+
+        if (p_args->value.i32 != 0 &&
+            (p_args->value.i32 < (int32_t) FRAMERATE_MIN || p_args->value.i32 > (int32_t) FRAMERATE_MAX))
+        {
+            send_trailer(true, PIXELKEY_ERROR_INVALID_ARGUMENT);
+            return;
+        }
+
+        // The frames interpolated between are allocated at startup; the rate takes effect after a reboot.
+        new_config.eval_rate = (uint8_t) p_args->value.i32;
+        config_error = config()->write(&new_config);
+    }
     else if (!strcmp("num_neopixels", p_args->key))
     {
-        // For the time being, don't allow this to be changed.
-        /// @todo Add support to set number of neopixels.
-        send_trailer(true, PIXELKEY_ERROR_KEY_NOT_FOUND);
-        return;
+        if (p_args->value_type != VALUE_TYPE_INTEGER)
+        {
+            send_trailer(true, PIXELKEY_ERROR_INVALID_ARGUMENT);
+            return;
+        }
+
+        if (p_args->value.i32 < 1 || p_args->value.i32 > (int32_t) PIXELKEY_NEOPIXEL_COUNT_MAX)
+        {
+            send_trailer(true, PIXELKEY_ERROR_INVALID_ARGUMENT);
+            return;
+        }
+
+        // Per-pixel state is allocated once at startup; the new count takes effect after a reboot.
+        new_config.num_neopixels = (uint32_t) p_args->value.i32;
+        config_error = config()->write(&new_config);
     }
     else if (!strcmp("max_rgb_value", p_args->key))
     {
@@ -418,6 +607,11 @@ static void handler_config_set(void * p_cmd_args)
 
         new_config.max_rgb_value = (uint8_t) p_args->value.i32;
         config_error = config()->write(&new_config);
+
+        if (config_error == PIXELKEY_ERROR_NONE)
+        {
+            pixelkey_keyframeproc_output_update();
+        }
     }
     else if (!strcmp("phy.frequency", p_args->key))
     {
@@ -470,6 +664,68 @@ static void handler_config_set(void * p_cmd_args)
         new_config.neopixel_phy.duty_cycle_b1 = (uint8_t) p_args->value.i32;
         config_error = config()->write(&new_config);
     }
+    else if (!strcmp("matrix.width", p_args->key) || !strcmp("matrix.height", p_args->key))
+    {
+        if (p_args->value_type != VALUE_TYPE_INTEGER)
+        {
+            send_trailer(true, PIXELKEY_ERROR_INVALID_ARGUMENT);
+            return;
+        }
+
+        if (p_args->value.i32 < 0 || p_args->value.i32 > (int32_t) PIXELKEY_NEOPIXEL_COUNT_MAX ||
+            p_args->value.i32 > UINT8_MAX)
+        {
+            send_trailer(true, PIXELKEY_ERROR_INVALID_ARGUMENT);
+            return;
+        }
+
+        // The mapping table is built once at startup; the layout takes effect after a reboot.
+        if (!strcmp("matrix.width", p_args->key))
+        {
+            new_config.matrix.width = (uint8_t) p_args->value.i32;
+        }
+        else
+        {
+            new_config.matrix.height = (uint8_t) p_args->value.i32;
+        }
+        config_error = config()->write(&new_config);
+    }
+    else if (!strcmp("matrix.rotation", p_args->key))
+    {
+        if (p_args->value_type != VALUE_TYPE_INTEGER)
+        {
+            send_trailer(true, PIXELKEY_ERROR_INVALID_ARGUMENT);
+            return;
+        }
+
+        if (p_args->value.i32 < 0 || p_args->value.i32 >= (int32_t) PIXEL_MAP_ROTATIONS)
+        {
+            send_trailer(true, PIXELKEY_ERROR_INVALID_ARGUMENT);
+            return;
+        }
+
+        new_config.matrix.rotation = (uint8_t) p_args->value.i32;
+        config_error = config()->write(&new_config);
+    }
+    else if (matrix_flag_find(p_args->key) != PIXEL_MAP_FLAG_NONE)
+    {
+        if (p_args->value_type != VALUE_TYPE_BOOLEAN)
+        {
+            send_trailer(true, PIXELKEY_ERROR_INVALID_ARGUMENT);
+            return;
+        }
+
+        const pixel_map_flag_t flag = matrix_flag_find(p_args->key);
+        if (p_args->value.b)
+        {
+            new_config.matrix.flags |= (uint8_t) flag;
+        }
+        else
+        {
+            new_config.matrix.flags &= (uint8_t) ~flag;
+        }
+        config_error = config()->write(&new_config);
+    }
     else
     {
         send_trailer(true, PIXELKEY_ERROR_KEY_NOT_FOUND);
@@ -502,6 +758,21 @@ static void handler_status(void * p_cmd_args)
     serial()->write((uint8_t *)msg, (size_t)len);
     serial()->flush();
 
+    len = snprintf(msg, sizeof(msg), "Framerate: %"PRIu16" fps, %"PRIu32"%% load\n",
+                   framerate_governor_framerate_get(), framerate_governor_load_get());
+    serial()->write((uint8_t *)msg, (size_t)len);
+    serial()->flush();
+
+    for (size_t i = 0; i < KEYFRAME_POOL_COUNT; i++)
+    {
+        keyframe_pool_stats_t stats;
+        keyframe_pool_stats_get((keyframe_pool_t) i, &stats);
+        len = snprintf(msg, sizeof(msg), "Pool %s: %"PRIu16"/%"PRIu16" used, %"PRIu16" peak, %"PRIu32" failed\n",
+                       stats.name, stats.in_use, stats.block_count, stats.high_water, stats.failures);
+        serial()->write((uint8_t *)msg, (size_t)len);
+        serial()->flush();
+    }
+
     send_trailer(false, PIXELKEY_ERROR_NONE);
 }
 
@@ -538,34 +809,129 @@ static void handler_reboot(void * p_cmd_args)
     send_trailer(false, PIXELKEY_ERROR_NONE);
 }
 
+static void handler_palette_set(void * p_cmd_args)
+{
+    cmd_args_palette_set_t * p_args = (cmd_args_palette_set_t *)p_cmd_args;
+
+    pixelkey_error_t err = palette_set(p_args->name, p_args->index, &p_args->color);
+    send_trailer((err != PIXELKEY_ERROR_NONE), err);
+}
+
+static void handler_palette_clear(void * p_cmd_args)
+{
+    ARG_NOT_USED(p_cmd_args);
+
+    palette_clear();
+    send_trailer(false, PIXELKEY_ERROR_NONE);
+}
+
+static void handler_palette_save(void * p_cmd_args)
+{
+    ARG_NOT_USED(p_cmd_args);
+
+    pixelkey_error_t err = palette_save();
+    send_trailer((err != PIXELKEY_ERROR_NONE), err);
+}
+
+static void handler_segment_set(void * p_cmd_args)
+{
+    cmd_args_segment_set_t * p_args = (cmd_args_segment_set_t *)p_cmd_args;
+
+    pixelkey_error_t err = segment_set(p_args->name, p_args->first, p_args->count, p_args->framerate);
+    send_trailer((err != PIXELKEY_ERROR_NONE), err);
+}
+
+static void handler_segment_clear(void * p_cmd_args)
+{
+    ARG_NOT_USED(p_cmd_args);
+
+    segment_clear();
+    send_trailer(false, PIXELKEY_ERROR_NONE);
+}
+
+/**
+ * Applies the pending keyframe modifiers to a keyframe.
+ * @param[in] p_keyframe Pointer to the keyframe to modify.
+ */
+static void apply_modifiers(keyframe_base_t * p_keyframe)
+{
+    if (has_repeat_modifier)
+    {
+        p_keyframe->modifiers.repeat_count = repeat_modifier;
+    }
+
+    if (has_layer_modifier)
+    {
+        p_keyframe->modifiers.layer = layer_modifier;
+    }
+}
+
+/**
+ * Pushes a keyframe to a NeoPixel, applying the pending modifiers.
+ * @param     index      Index of the NeoPixel.
+ * @param[in] p_template Pointer to the parsed keyframe to clone.
+ * @param[in] p_shared   Pointer to the broadcast keyframe to push instead of a clone, or NULL.
+ * @retval PIXELKEY_ERROR_NONE          The keyframe was pushed or the NeoPixel queue rejected it.
+ * @retval PIXELKEY_ERROR_OUT_OF_MEMORY The keyframe could not be cloned.
+ */
+static pixelkey_error_t keyframe_push(uint16_t index, keyframe_base_t const * p_template, keyframe_base_t * p_shared)
+{
+    if (p_shared != NULL)
+    {
+        pixelkey_keyframeproc_push(index, p_shared);
+        return PIXELKEY_ERROR_NONE;
+    }
+
+    keyframe_base_t * p_keyframe = p_template->p_api->clone(p_template);
+    if (p_keyframe == NULL)
+    {
+        return PIXELKEY_ERROR_OUT_OF_MEMORY;
+    }
+
+    apply_modifiers(p_keyframe);
+
+    if (pixelkey_keyframeproc_push(index, p_keyframe) != PIXELKEY_ERROR_NONE)
+    {
+        keyframe_destroy(p_keyframe);
+    }
+
+    return PIXELKEY_ERROR_NONE;
+}
+
 static void handler_keyframe_wrapper(void * p_cmd_args)
 {
     cmd_args_keyframe_wrapper_t * p_args = (cmd_args_keyframe_wrapper_t *)p_cmd_args;
-    if (p_args->channels[0] == 0)
+    pixelkey_error_t err = PIXELKEY_ERROR_NONE;
+
+    // A broadcast keyframe is a single instance, with the modifiers applied, shared by all the channels.
+    // This command holds a reference until every channel has been pushed.
+    keyframe_base_t * p_shared = NULL;
+    if (has_broadcast_modifier)
     {
-        // No channels specified.
-        for (uint8_t i = 0; i < config_get_or_default()->num_neopixels; i++)
+        p_shared = p_args->p_keyframe->p_api->clone(p_args->p_keyframe);
+        if (p_shared == NULL)
         {
-            keyframe_base_t * p_keyframe = p_args->p_keyframe->p_api->clone(p_args->p_keyframe);
-            if (p_keyframe == NULL)
-            {
-                send_trailer(true, PIXELKEY_ERROR_OUT_OF_MEMORY);
-                return;
-            }
-
-            // Apply modifiers.
-            if (has_repeat_modifier)
-            {
-                p_keyframe->modifiers.repeat_count = repeat_modifier;
-            }
-
-            if (has_schedule_modifier)
-            {
-                p_keyframe->modifiers.schedule = schedule_modifier;
-                p_keyframe->modifiers.schedule_is_repeating = is_schedule_repeating;
-            }
+            err = PIXELKEY_ERROR_OUT_OF_MEMORY;
+        }
+        else
+        {
+            apply_modifiers(p_shared);
+            p_shared->flags |= KEYFRAME_FLAG_BROADCAST;
+            p_shared->broadcast.refs = 1;
+        }
+    }
 
-            pixelkey_keyframeproc_push(i, p_keyframe);
+    if (err != PIXELKEY_ERROR_NONE)
+    {
+        // Nothing to push.
+    }
+    else if (p_args->channels[0] == 0)
+    {
+        // No channels specified.
+        const uint16_t count = pixelkey_keyframeproc_pixel_count_get();
+        for (uint16_t i = 0; i < count && err == PIXELKEY_ERROR_NONE; i++)
+        {
+            err = keyframe_push(i, p_args->p_keyframe, p_shared);
         }
     }
     else
@@ -573,31 +939,28 @@ static void handler_keyframe_wrapper(void * p_cmd_args)
         // Loop through the channels.
         // Values in p_args->channels are 1-based instead of 0-based like the actual indexes.
         // Use 0 as a flag for the end of the channel list.
-        for (size_t i = 0; p_args->channels[i] != 0 && i < CMD_KEYFRAME_WRAPPER_CHANNELS_MAX_LENGTH; i++)
+        for (size_t i = 0; i < CMD_KEYFRAME_WRAPPER_CHANNELS_MAX_LENGTH && p_args->channels[i] != 0 && err == PIXELKEY_ERROR_NONE; i++)
         {
-            keyframe_base_t * p_keyframe = p_args->p_keyframe->p_api->clone(p_args->p_keyframe);
-            if (p_keyframe == NULL)
-            {
-                send_trailer(true, PIXELKEY_ERROR_OUT_OF_MEMORY);
-                return;
-            }
-
-            // Apply modifiers.
-            if (has_repeat_modifier)
+            // A range is stored as its first channel, marked with CMD_KEYFRAME_CHANNEL_RANGE_FLAG, followed by its last.
+            uint32_t first = p_args->channels[i] & ~CMD_KEYFRAME_CHANNEL_RANGE_FLAG;
+            uint32_t last = first;
+            if ((p_args->channels[i] & CMD_KEYFRAME_CHANNEL_RANGE_FLAG) && i + 1U < CMD_KEYFRAME_WRAPPER_CHANNELS_MAX_LENGTH)
             {
-                p_keyframe->modifiers.repeat_count = repeat_modifier;
+                last = p_args->channels[++i];
             }
 
-            if (has_schedule_modifier)
+            for (uint32_t ch = first; ch <= last && err == PIXELKEY_ERROR_NONE; ch++)
             {
-                p_keyframe->modifiers.schedule = schedule_modifier;
-                p_keyframe->modifiers.schedule_is_repeating = is_schedule_repeating;
+                err = keyframe_push((uint16_t)(ch - 1U), p_args->p_keyframe, p_shared);
             }
-
-            pixelkey_keyframeproc_push((uint8_t)(p_args->channels[i] - 1U), p_keyframe);
         }
     }
 
+    if (p_shared != NULL)
+    {
+        pixelkey_keyframeproc_release(p_shared);
+    }
+
     // Clear the modifiers
     if (has_repeat_modifier)
     {
@@ -610,8 +973,14 @@ static void handler_keyframe_wrapper(void * p_cmd_args)
         schedule_modifier = (keyframe_schedule_t){0};
         is_schedule_repeating = false;
     }
+    has_broadcast_modifier = false;
+    if (has_layer_modifier)
+    {
+        has_layer_modifier = false;
+        layer_modifier = 0;
+    }
 
-    send_trailer(false, PIXELKEY_ERROR_NONE);
+    send_trailer((err != PIXELKEY_ERROR_NONE), err);
 }
 
 static void handler_keyframe_mod_repeat(void * p_cmd_args)
@@ -623,6 +992,34 @@ static void handler_keyframe_mod_repeat(void * p_cmd_args)
     send_trailer(false, PIXELKEY_ERROR_NONE);
 }
 
+static void handler_keyframe_mod_broadcast(void * p_cmd_args)
+{
+    ARG_NOT_USED(p_cmd_args);
+    has_broadcast_modifier = true;
+
+    send_trailer(false, PIXELKEY_ERROR_NONE);
+}
+
+static void handler_keyframe_mod_layer(void * p_cmd_args)
+{
+    cmd_args_keyframe_mod_layer_t * p_args = (cmd_args_keyframe_mod_layer_t *)p_cmd_args;
+    pixelkey_error_t err = PIXELKEY_ERROR_NONE;
+
+    // The blend mode belongs to the layer and stays set for later keyframes; the layer itself applies to the next one.
+    if (p_args->blend_provided)
+    {
+        err = pixelkey_keyframeproc_layer_set(p_args->layer, p_args->blend, p_args->opacity);
+    }
+
+    if (err == PIXELKEY_ERROR_NONE)
+    {
+        layer_modifier = p_args->layer;
+        has_layer_modifier = true;
+    }
+
+    send_trailer((err != PIXELKEY_ERROR_NONE), err);
+}
+
 static void handler_keyframe_mod_schedule(void * p_cmd_args)
 {
     send_trailer(true, PIXELKEY_ERROR_NONE);
@@ -33,6 +33,7 @@ static config_data_t const config_data_default =
     {
         .echo_enabled = PIXELKEY_DEFAULT_COM_ECHO,
         .gamma_enabled = !PIXELKEY_DISABLE_GAMMA_CORRECTION,
+        .governor_enabled = PIXELKEY_DEFAULT_GOVERNOR,
     },
     .gamma_factor = NEOPIXEL_GAMMA_CORRECTION_DEFAULT,
     .framerate = PIXELKEY_DEFAULT_FRAMERATE,
@@ -44,6 +45,16 @@ static config_data_t const config_data_default =
         .duty_cycle_b0 = PIXELKEY_DEFAULT_PHY_B0,
         .duty_cycle_b1 = PIXELKEY_DEFAULT_PHY_B1,
     },
+    .framerate_min = PIXELKEY_DEFAULT_FRAMERATE_MIN,
+    .framerate_max = PIXELKEY_DEFAULT_FRAMERATE_MAX,
+    .matrix =
+    {
+        .width = 0,
+        .height = 0,
+        .rotation = 0,
+        .flags = PIXEL_MAP_FLAG_NONE,
+    },
+    .eval_rate = PIXELKEY_DEFAULT_EVAL_RATE,
 };
 
 /**
@@ -7,6 +7,7 @@
 #include <stddef.h>
 
 #include "pixelkey_errors.h"
+#include "pixel_map.h"
 
 /**
  * @file
@@ -53,9 +54,10 @@ typedef struct st_config_data
     {
         struct
         {
-            uint32_t echo_enabled   :  1; ///< COM echo is enabled.
-            uint32_t gamma_enabled  :  1; ///< Gamma correction is enabled. 
-            uint32_t                : 30;
+            uint32_t echo_enabled     :  1; ///< COM echo is enabled.
+            uint32_t gamma_enabled    :  1; ///< Gamma correction is enabled. 
+            uint32_t governor_enabled :  1; ///< The framerate governor may change the framerate.
+            uint32_t                  : 29;
         } flags_b;                        ///< Configuration flags bit-field.
         uint32_t flags;                   ///< Configuration flags as a word.
     };
@@ -64,6 +66,10 @@ typedef struct st_config_data
     uint32_t num_neopixels;               ///< Number of attached neopixels.
     uint8_t  max_rgb_value;               ///< Maximum brightness allowed for any RGB channel.
     config_neopixel_phy_t neopixel_phy;   ///< PHY configuration.
+    uint8_t  framerate_min;               ///< Lowest frame rate the framerate governor may select.
+    uint8_t  framerate_max;               ///< Highest frame rate the framerate governor may select.
+    pixel_map_layout_t matrix;            ///< Layout of the NeoPixels when they form a matrix.
+    uint8_t  eval_rate;                   ///< Rate keyframes are evaluated at and interpolated between; 0 for every frame.
 } config_data_t;
 #pragma pack(pop)
 
@@ -0,0 +1,166 @@
+/**
+ * @file
+ * @defgroup pixelkey__governor__internals Framerate Governor Internals
+ * @ingroup pixelkey__governor
+ * @{
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "keyframes.h"
+#include "framerate_governor.h"
+
+/** Fixed point scale of the load; loads are kept in 1/256ths of a percent. */
+#define LOAD_FRACTION_BITS  (8U)
+
+/** Converts a whole percent to a fixed point load. */
+#define LOAD_FROM_PERCENT(p)    ((uint32_t) (p) << LOAD_FRACTION_BITS)
+
+/** Largest load sampled, 10 times the period; keeps a single stall from swamping the average. */
+#define LOAD_MAX    LOAD_FROM_PERCENT(1000U)
+
+/** Governor state. */
+static struct
+{
+    bool        enabled;   ///< true if the framerate may be changed.
+    framerate_t framerate; ///< Current framerate.
+    framerate_t min;       ///< Lowest framerate allowed.
+    framerate_t max;       ///< Highest framerate allowed.
+    uint32_t    load;      ///< Average load in fixed point percent of the frame period.
+    uint32_t    headroom;  ///< Consecutive samples with the load below @ref FRAMERATE_GOVERNOR_LOAD_LOW.
+} governor =
+{
+    .enabled = false,
+    .framerate = FRAMERATE_MIN,
+    .min = FRAMERATE_MIN,
+    .max = FRAMERATE_MAX,
+};
+
+/**
+ * Gets the framerate which would run at the target load.
+ * @return The framerate; not clamped.
+ */
+static uint32_t governor_target_framerate(void)
+{
+    return (uint32_t) (((uint64_t) governor.framerate * LOAD_FROM_PERCENT(FRAMERATE_GOVERNOR_LOAD_TARGET)) /
+                       governor.load);
+}
+
+/**
+ * Changes the framerate and rescales the average load to match.
+ * @param framerate The new framerate.
+ */
+static void governor_framerate_change(framerate_t framerate)
+{
+    // The cost per frame does not depend on the rate so the load scales with it.
+    governor.load = (uint32_t) (((uint64_t) governor.load * framerate) / governor.framerate);
+    governor.framerate = framerate;
+    governor.headroom = 0;
+}
+
+/**
+ * Initializes the governor.
+ * @param enabled   true to let the governor change the framerate, false to only measure the load.
+ * @param framerate The starting framerate.
+ * @param min       Lowest framerate the governor may select.
+ * @param max       Highest framerate the governor may select; raised to min if it is lower.
+ */
+void framerate_governor_init(bool enabled, framerate_t framerate, framerate_t min, framerate_t max)
+{
+    min = (min < FRAMERATE_MIN) ? FRAMERATE_MIN : min;
+    max = (max > FRAMERATE_MAX) ? FRAMERATE_MAX : max;
+    max = (max < min) ? min : max;
+
+    governor.enabled = enabled;
+    governor.min = min;
+    governor.max = max;
+    governor.load = 0;
+    governor.headroom = 0;
+
+    if (enabled)
+    {
+        framerate = (framerate < min) ? min : framerate;
+        framerate = (framerate > max) ? max : framerate;
+    }
+    governor.framerate = (framerate < FRAMERATE_MIN) ? FRAMERATE_MIN : framerate;
+}
+
+/**
+ * Adds the cost of a frame to the average load and adjusts the framerate if it is out of bounds.
+ * @param      cost        Time taken to render and transmit the frame.
+ * @param[out] p_framerate Pointer to store the new framerate; only written when it changes.
+ * @return true if the framerate has changed and the frame timer should be updated, false otherwise.
+ */
+bool framerate_governor_sample(timestep_t cost, framerate_t * p_framerate)
+{
+    const timestep_t period = TIMESTEP_PER_SECOND / governor.framerate;
+    uint64_t load = ((uint64_t) cost * LOAD_FROM_PERCENT(100U)) / period;
+    load = (load > LOAD_MAX) ? LOAD_MAX : load;
+
+    // Exponential moving average; the difference is signed.
+    const int32_t delta = (int32_t) load - (int32_t) governor.load;
+    governor.load = (uint32_t) ((int32_t) governor.load + (delta / (1 << FRAMERATE_GOVERNOR_AVERAGE_SHIFT)));
+
+    if (!governor.enabled)
+    {
+        return false;
+    }
+
+    uint32_t framerate = governor.framerate;
+    if (governor.load > LOAD_FROM_PERCENT(FRAMERATE_GOVERNOR_LOAD_HIGH))
+    {
+        // Over budget; drop straight to the target rather than stepping so frames stop being missed quickly.
+        const uint32_t target = governor_target_framerate();
+        framerate = (target < framerate) ? target : framerate - 1U;
+        framerate = (framerate < governor.min) ? governor.min : framerate;
+    }
+    else if (governor.load < LOAD_FROM_PERCENT(FRAMERATE_GOVERNOR_LOAD_LOW))
+    {
+        governor.headroom++;
+        if (governor.headroom >= FRAMERATE_GOVERNOR_RAISE_SAMPLES)
+        {
+            // Step up gradually; never past the target so the next samples do not push it straight back down.
+            const uint32_t step = (framerate / 8U) > 1U ? (framerate / 8U) : 1U;
+            const uint32_t target = (governor.load > 0U) ? governor_target_framerate() : UINT32_MAX;
+            framerate = (framerate + step < target) ? framerate + step : target;
+            framerate = (framerate > governor.max) ? governor.max : framerate;
+            framerate = (framerate < governor.framerate) ? governor.framerate : framerate;
+            governor.headroom = 0;
+        }
+    }
+    else
+    {
+        governor.headroom = 0;
+    }
+
+    if (framerate == governor.framerate)
+    {
+        return false;
+    }
+
+    governor_framerate_change((framerate_t) framerate);
+    *p_framerate = governor.framerate;
+    return true;
+}
+
+/**
+ * Gets the framerate selected by the governor.
+ * @return The current framerate.
+ */
+framerate_t framerate_governor_framerate_get(void)
+{
+    return governor.framerate;
+}
+
+/**
+ * Gets the average cost of a frame.
+ * @return The average load in percent of the frame period.
+ */
+uint32_t framerate_governor_load_get(void)
+{
+    return (governor.load + LOAD_FROM_PERCENT(1U) / 2U) >> LOAD_FRACTION_BITS;
+}
+
+/** @} */
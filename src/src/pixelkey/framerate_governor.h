@@ -0,0 +1,61 @@
+#ifndef FRAMERATE_GOVERNOR_H
+#define FRAMERATE_GOVERNOR_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include "keyframes.h"
+
+/**
+ * @file
+ * @defgroup pixelkey__governor Framerate Governor
+ * @ingroup pixelkey
+ * Adapts the framerate to the cost of producing each frame.
+ *
+ * The cost of rendering and transmitting every frame is sampled and averaged against the frame period. When the
+ * average load goes over @ref FRAMERATE_GOVERNOR_LOAD_HIGH the framerate is lowered straight to the rate that would
+ * bring it back to @ref FRAMERATE_GOVERNOR_LOAD_TARGET. When it stays under @ref FRAMERATE_GOVERNOR_LOAD_LOW for
+ * @ref FRAMERATE_GOVERNOR_RAISE_SAMPLES frames the framerate is raised a step at a time. The framerate is always kept
+ * between the configured minimum and maximum.
+ * @{
+ */
+
+/** Average load, in percent of the frame period, above which the framerate is lowered. */
+#ifndef FRAMERATE_GOVERNOR_LOAD_HIGH
+#define FRAMERATE_GOVERNOR_LOAD_HIGH        (90U)
+#endif
+
+/** Average load, in percent of the frame period, below which the framerate may be raised. */
+#ifndef FRAMERATE_GOVERNOR_LOAD_LOW
+#define FRAMERATE_GOVERNOR_LOAD_LOW         (60U)
+#endif
+
+/** Load, in percent of the frame period, aimed for when the framerate changes. */
+#ifndef FRAMERATE_GOVERNOR_LOAD_TARGET
+#define FRAMERATE_GOVERNOR_LOAD_TARGET      (75U)
+#endif
+
+/** Number of consecutive frames under @ref FRAMERATE_GOVERNOR_LOAD_LOW before the framerate is raised. */
+#ifndef FRAMERATE_GOVERNOR_RAISE_SAMPLES
+#define FRAMERATE_GOVERNOR_RAISE_SAMPLES    (64U)
+#endif
+
+/** Weight of a new sample in the average load, as a power of 2; 3 weights each sample by 1/8. */
+#ifndef FRAMERATE_GOVERNOR_AVERAGE_SHIFT
+#define FRAMERATE_GOVERNOR_AVERAGE_SHIFT    (3U)
+#endif
+
+static_assert(FRAMERATE_GOVERNOR_LOAD_LOW < FRAMERATE_GOVERNOR_LOAD_TARGET &&
+              FRAMERATE_GOVERNOR_LOAD_TARGET < FRAMERATE_GOVERNOR_LOAD_HIGH,
+              "Governor load thresholds must be ordered LOW < TARGET < HIGH.");
+
+void framerate_governor_init(bool enabled, framerate_t framerate, framerate_t min, framerate_t max);
+bool framerate_governor_sample(timestep_t cost, framerate_t * p_framerate);
+framerate_t framerate_governor_framerate_get(void);
+uint32_t framerate_governor_load_get(void);
+
+/** @} */
+
+#endif // FRAMERATE_GOVERNOR_H
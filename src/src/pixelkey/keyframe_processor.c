@@ -9,25 +9,135 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "hal_device.h"
 #include "pixelkey.h"
 #include "neopixel.h"
 #include "config.h"
 
-#include "ring_buffer.h"
+#include "arena.h"
+#include "keyframe_pool.h"
+#include "keyframe_timeline.h"
+#include "segment.h"
+#include "pixel_map.h"
 
-static color_rgb_t       current_color[PIXELKEY_NEOPIXEL_COUNT] = {0};
+static_assert(PIXELKEY_LAYER_COUNT > 0U && PIXELKEY_LAYER_COUNT <= UINT8_MAX, "There must be 1 to 255 layers.");
+static_assert(PIXELKEY_NEOPIXEL_COUNT_MAX * PIXELKEY_LAYER_COUNT <= UINT16_MAX,
+              "Layer slots of every NeoPixel must fit in a uint16_t.");
 
-keyframe_base_t *        keyframe_queue_buffer[PIXELKEY_NEOPIXEL_COUNT][PIXELKEY_KEYFRAME_QUEUE_LENGTH];
-ring_buffer_t            keyframe_queue[PIXELKEY_NEOPIXEL_COUNT] = {0};
+/**
+ * A layer of keyframes composited over the layers beneath it.
+ * Each array holds @ref pixel_count elements and is allocated from the pixel arena by @ref pixelkey_frameproc_init.
+ */
+typedef struct st_layer
+{
+    color_rgb_t *      p_colors;      ///< Last rendered color of each NeoPixel.
+    keyframe_base_t ** pp_keyframes;  ///< Current keyframe of each NeoPixel, or NULL.
+    timestep_t *       p_start_times; ///< Frame time at which each current keyframe started.
+    bool *             p_finished;    ///< true if the current keyframe completed in the last render.
+    uint16_t           active;        ///< Number of NeoPixels with a current keyframe.
+    color_blend_t      blend;         ///< How the layer is combined with the layers beneath it.
+    uint8_t            opacity;       ///< Amount of the blended color shown, 0 to 255.
+} layer_t;
+
+static layer_t layers[PIXELKEY_LAYER_COUNT];
+
+/**
+ * @name Per-pixel state
+ * Each array holds @ref pixel_count elements and is allocated from the pixel arena by @ref pixelkey_frameproc_init.
+ * The first four are views of the layer being processed, set by @ref layer_select; the rest are shared scratch space.
+ * @{
+ */
+static layer_t *           current_layer = NULL;
+static color_rgb_t *       current_color = NULL;
+static keyframe_base_t **  current_keyframe = NULL;
+static timestep_t *        start_time = NULL;         ///< Frame time at which the current keyframe started.
+static bool *              finished = NULL;
+
+/** Keyframes which render in HSV are gathered here and converted to RGB together. */
+static color_hsv_t *       hsv_colors = NULL;
+static color_rgb_t *       hsv_rgb_colors = NULL;
+static uint16_t *          hsv_pixels = NULL;
+
+/** Opacity of each NeoPixel of the layer being composited; 0 where the layer has no keyframe. */
+static uint8_t *           layer_opacity = NULL;
+
+/**
+ * NeoPixels given a keyframe which starts at or before the last rendered frame, and the earliest such start of each.
+ * Only these NeoPixels change when the frames rendered ahead are rendered again; see @ref replay_frame.
+ */
+static bool *              stale_pixels = NULL;
+static timestep_t *        stale_starts = NULL;
+/** @} */
+
+/** Number of NeoPixels rendered; virtual NeoPixels when @ref pixel_map is used. */
+static uint16_t          pixel_count = 0;
+
+/** Number of NeoPixels in the frame buffer. */
+static uint16_t          physical_count = 0;
+
+/**
+ * Virtual NeoPixel shown by each NeoPixel in the frame buffer, or NULL when they are the same.
+ * Holds @ref physical_count elements; see @ref pixel_map_build.
+ */
+static uint16_t *        pixel_map = NULL;
 
-static keyframe_base_t * current_keyframe[PIXELKEY_NEOPIXEL_COUNT] = {0};
-static timestep_t        current_framecount[PIXELKEY_NEOPIXEL_COUNT] = {0};
-static framerate_t       current_framerate = 0;
+/** Colors of the virtual NeoPixels; holds @ref pixel_count elements and is only used with @ref pixel_map. */
+static color_rgb_t *     virtual_frame = NULL;
+
+/** NeoPixels rendered this frame; the others keep their last rendered colors. */
+static segment_range_t   render_ranges[SEGMENT_RANGES_MAX];
+
+/** Number of entries in @ref render_ranges. */
+static size_t            render_range_count = 0;
 
 static uint32_t          framecount = 0;
 
+/** Number of times the keyframes have been evaluated; the same as @ref framecount unless evaluations are interpolated. */
+static uint32_t          evalcount = 0;
+
+/** Time the keyframes are being evaluated for. */
+static timestep_t        frame_time = 0;
+
+/** Time of the last frame rendered; the same as @ref frame_time unless evaluations are interpolated. */
+static timestep_t        render_time = 0;
+
+/**
+ * Earliest start time of the keyframes pushed since the last @ref pixelkey_keyframeproc_stale_get which change frames
+ * already rendered, if @ref stale.
+ */
+static timestep_t        stale_time = 0;
+static bool              stale = false;
+
+/** true if any of @ref stale_pixels are set. */
+static bool              stale_pixels_marked = false;
+
+/** Time between keyframe evaluations, or 0 to evaluate them for every frame. */
+static timestep_t        eval_period = 0;
+
+/**
+ * The last two evaluated frames when @ref eval_period is set; frames shown between them are interpolated.
+ * Each holds @ref pixel_count elements.
+ */
+static color_rgb_t *     eval_frames[2] = { NULL, NULL };
+
+/** Times of the frames in @ref eval_frames. */
+static timestep_t        eval_times[2] = { 0, 0 };
+
+/**
+ * Points the per-pixel views at a layer.
+ * @param layer Index of the layer; must be less than @ref PIXELKEY_LAYER_COUNT.
+ */
+static inline void layer_select(uint8_t layer)
+{
+    current_layer = &layers[layer];
+    current_color = current_layer->p_colors;
+    current_keyframe = current_layer->pp_keyframes;
+    start_time = current_layer->p_start_times;
+    finished = current_layer->p_finished;
+}
+
 /**
  * Initialize a keyframe or keyframe group.
  * @param[in] p_keyframe Pointer to the keyframe to initialize.
@@ -43,48 +153,228 @@ static void init_keyframe(keyframe_base_t * p_keyframe, color_rgb_t * p_color)
     }
     else
     {
-        p_keyframe->p_api->render_init(p_keyframe, current_framerate, *p_color);
+        p_keyframe->p_api->render_init(p_keyframe, *p_color);
     }
+    p_keyframe->broadcast.rendered = false;
     p_keyframe->flags |= KEYFRAME_FLAG_INITIALIZED;
 }
 
 /**
- * Performs a render of the current keyframes.
- * @retval PIXELKEY_ERROR_NONE Frame render was successful.
- * 
- * @todo Add support for scheduled keyframes.
+ * Restarts an initialized keyframe or keyframe group for a repeat without initializing it again.
+ * @param[in] p_keyframe Pointer to the keyframe to reset.
+ * @param[in] p_color    Pointer to the current rendered color; only used if the keyframe was never initialized.
  */
-pixelkey_error_t pixelkey_keyframeproc_render_frame(color_rgb_t * p_frame_buffer)
+static void reset_keyframe(keyframe_base_t * p_keyframe, color_rgb_t * p_color)
 {
-    // This should be called at the beginning of the frame period, directly after
-    // the frame has been written to the neopixels.
-    for (uint8_t i = 0; i < PIXELKEY_NEOPIXEL_COUNT; i++)
+    if (!(p_keyframe->flags & KEYFRAME_FLAG_INITIALIZED))
     {
-        keyframe_base_t * p_kf = (keyframe_base_t *) ring_buffer_peek(&keyframe_queue[i]);
-        if (p_kf != NULL)
-        {
-            ring_buffer_pop(&keyframe_queue[i], NULL);
-            current_keyframe[i] = p_kf;
-            current_framecount[i] = 1;
+        init_keyframe(p_keyframe, p_color);
+        return;
+    }
 
-            init_keyframe(p_kf, &current_color[i]);
-            p_kf->flags |= KEYFRAME_FLAG_INITIALIZED;
-        }
-        else
+    if (p_keyframe->flags & KEYFRAME_FLAG_GROUP)
+    {
+        keyframe_group_t * p_grp = (keyframe_group_t *)p_keyframe;
+        p_grp->current_child_idx = 0;
+        reset_keyframe(p_grp->children[0], p_color);
+    }
+    else if (p_keyframe->p_api->render_reset != NULL)
+    {
+        p_keyframe->p_api->render_reset(p_keyframe);
+    }
+    p_keyframe->broadcast.rendered = false;
+}
+
+/**
+ * Marks a broadcast keyframe as rendered for this frame, starting its clock on the first render.
+ * @param[in] p_bc Pointer to the broadcast state of the keyframe.
+ */
+static inline void broadcast_advance(keyframe_broadcast_t * p_bc)
+{
+    if (!p_bc->rendered)
+    {
+        p_bc->start = frame_time;
+        p_bc->rendered = true;
+    }
+    p_bc->frame = evalcount;
+}
+
+/**
+ * Renders a broadcast keyframe, once per frame no matter how many NeoPixels share it.
+ * @param[in]  p_keyframe  Pointer to the broadcast keyframe.
+ * @param[out] p_color_out Pointer to the rendered RGB color.
+ * @return true if the keyframe has completed, false if more frames remain.
+ */
+static bool render_broadcast(keyframe_base_t * p_keyframe, color_rgb_t * p_color_out)
+{
+    keyframe_broadcast_t * const p_bc = &p_keyframe->broadcast;
+    if (!p_bc->rendered || p_bc->frame != evalcount)
+    {
+        broadcast_advance(p_bc);
+        p_bc->finished = p_keyframe->p_api->render_frame(p_keyframe, frame_time - p_bc->start, &p_bc->color);
+    }
+
+    *p_color_out = p_bc->color;
+    return p_bc->finished;
+}
+
+/**
+ * Renders a keyframe which provides @ref keyframe_base_api_t::render_span into a range of NeoPixels.
+ * A broadcast keyframe uses its shared start time so every span rendered in a frame sees the same time.
+ * @param[in] p_keyframe Pointer to the keyframe.
+ * @param     first      Index of the first NeoPixel in the range.
+ * @param     count      Number of NeoPixels in the range; all must have p_keyframe as their current keyframe.
+ * @return true if the keyframe has completed, false if more frames remain.
+ */
+static bool render_span(keyframe_base_t * p_keyframe, uint16_t first, uint16_t count)
+{
+    timestep_t start = start_time[first];
+    if (p_keyframe->flags & KEYFRAME_FLAG_BROADCAST)
+    {
+        broadcast_advance(&p_keyframe->broadcast);
+        start = p_keyframe->broadcast.start;
+    }
+
+    return p_keyframe->p_api->render_span(p_keyframe, frame_time - start, first, count, &current_color[first]);
+}
+
+/**
+ * Makes a keyframe the current keyframe of a NeoPixel on the selected layer, releasing the one it replaces.
+ * @param     index      Index of the NeoPixel.
+ * @param[in] p_keyframe Pointer to the keyframe.
+ * @param     start      Time the keyframe started; at or before the current frame.
+ */
+static void activate_keyframe(uint16_t index, keyframe_base_t * p_keyframe, timestep_t start)
+{
+    if (current_keyframe[index] != NULL)
+    {
+        pixelkey_keyframeproc_release(current_keyframe[index]);
+    }
+    else
+    {
+        current_layer->active++;
+    }
+    current_keyframe[index] = p_keyframe;
+    start_time[index] = start;
+    finished[index] = false;
+
+    // Broadcast keyframes are initialized once, by the first NeoPixel to start them.
+    if (!(p_keyframe->flags & KEYFRAME_FLAG_BROADCAST) || !(p_keyframe->flags & KEYFRAME_FLAG_INITIALIZED))
+    {
+        init_keyframe(p_keyframe, &current_color[index]);
+    }
+}
+
+/**
+ * Combines the selected layer with the layers beneath it in the frame buffer.
+ * The bottom layer is copied as-is; a layer above it only covers the NeoPixels it has a keyframe for.
+ * @param         layer          Index of the selected layer.
+ * @param[in,out] p_frame_buffer Pointer to the frame buffer holding the layers beneath.
+ */
+static void composite_layer(uint8_t layer, color_rgb_t * p_frame_buffer)
+{
+    if (layer == 0U)
+    {
+        memcpy(p_frame_buffer, current_color, pixel_count * sizeof(*p_frame_buffer));
+        return;
+    }
+
+    for (uint16_t i = 0; i < pixel_count; i++)
+    {
+        layer_opacity[i] = (current_keyframe[i] != NULL) ? current_layer->opacity : 0U;
+    }
+    color_blend_n(current_layer->blend, current_color, layer_opacity, p_frame_buffer, pixel_count);
+}
+
+/**
+ * Renders the current keyframes of the selected layer and composites it into the frame buffer.
+ * @param         layer          Index of the selected layer.
+ * @param[in,out] p_frame_buffer Pointer to the frame buffer holding the layers beneath.
+ */
+static void render_layer(uint8_t layer, color_rgb_t * p_frame_buffer)
+{
+    uint16_t hsv_count = 0;
+
+    // Render a frame for every NeoPixel with a keyframe in the ranges due this frame; all current keyframes are known
+    // so spans can be found.
+    for (size_t r = 0; r < render_range_count; r++)
+    {
+        segment_range_t const * const p_range = &render_ranges[r];
+        const uint16_t end = (uint16_t) (p_range->first + p_range->count);
+        for (uint16_t i = p_range->first; i < end; i++)
         {
-            p_kf = current_keyframe[i];
-            current_framecount[i]++;
+            keyframe_base_t * const p_kf = current_keyframe[i];
+            if (p_kf != NULL)
+            {
+                // A keyframe which finished last frame and is still current is repeating; restart its clock.
+                if (finished[i])
+                {
+                    start_time[i] = frame_time;
+                }
+
+                if (p_kf->p_api->render_span != NULL)
+                {
+                    // Only broadcast keyframes can be current for more than one NeoPixel.
+                    uint16_t count = 1;
+                    if (p_kf->flags & KEYFRAME_FLAG_BROADCAST)
+                    {
+                        while (i + count < end && current_keyframe[i + count] == p_kf)
+                        {
+                            count++;
+                        }
+                    }
+
+                    const bool done = render_span(p_kf, i, count);
+                    for (uint16_t j = 0; j < count; j++)
+                    {
+                        finished[i + j] = done;
+                    }
+                    i = (uint16_t) (i + count - 1U);
+                }
+                else if (p_kf->flags & KEYFRAME_FLAG_BROADCAST)
+                {
+                    finished[i] = render_broadcast(p_kf, &current_color[i]);
+                }
+                else if (p_kf->p_api->render_frame_hsv != NULL)
+                {
+                    finished[i] = p_kf->p_api->render_frame_hsv(p_kf, frame_time - start_time[i], &hsv_colors[hsv_count]);
+                    hsv_pixels[hsv_count++] = i;
+                }
+                else
+                {
+                    finished[i] = p_kf->p_api->render_frame(p_kf, frame_time - start_time[i], &current_color[i]);
+                }
+            }
         }
+    }
+
+    // Convert all of the HSV renders in one pass and scatter them back to their pixels.
+    color_convert_hsv_to_rgb_n(hsv_colors, hsv_rgb_colors, hsv_count);
+    for (uint16_t i = 0; i < hsv_count; i++)
+    {
+        current_color[hsv_pixels[i]] = hsv_rgb_colors[i];
+    }
 
-        // Render a frame if a keyframe is available.
-        if (p_kf != NULL)
+    composite_layer(layer, p_frame_buffer);
+
+    // Finished keyframes are handled once every NeoPixel has been rendered, converted, and composited, so their last
+    // frame is shown before an upper layer uncovers the layers beneath. Only NeoPixels rendered this frame are visited.
+    for (size_t r = 0; r < render_range_count; r++)
+    {
+        segment_range_t const * const p_range = &render_ranges[r];
+        const uint16_t end = (uint16_t) (p_range->first + p_range->count);
+        for (uint16_t i = p_range->first; i < end; i++)
         {
-            bool finished = p_kf->p_api->render_frame(p_kf, current_framecount[i], &current_color[i]);
-            if (finished)
+            if (finished[i])
             {
+                keyframe_base_t * p_kf = current_keyframe[i];
+
+                // A broadcast keyframe counts its repeat once per frame; NeoPixels after the first see it restarted.
+                const bool repeat_counted = (p_kf->flags & KEYFRAME_FLAG_BROADCAST) && !p_kf->broadcast.rendered;
+
                 // Decrement the repeat count only if positive.
                 // This will allow for indefinite (negative) repeats and "0 is 1 repeat" behavior.
-                if (p_kf->modifiers.repeat_count > 0)
+                if (p_kf->modifiers.repeat_count > 0 && !repeat_counted)
                 {
                     p_kf->modifiers.repeat_count--;
                 }
@@ -92,83 +382,393 @@ pixelkey_error_t pixelkey_keyframeproc_render_frame(color_rgb_t * p_frame_buffer
                 if (p_kf->modifiers.repeat_count == 0)
                 {
                     current_keyframe[i] = NULL;
-                    free(p_kf);
+                    finished[i] = false;
+                    current_layer->active--;
+                    pixelkey_keyframeproc_release(p_kf);
                 }
-                else
+                else if (!repeat_counted)
                 {
-                    // The keyframe is repeating. Prepare for a new render next frame.
-                    current_framecount[i] = 0;
-                    init_keyframe(p_kf, &current_color[i]);
+                    // The keyframe is repeating. Prepare for a new render next frame; its clock restarts then.
+                    reset_keyframe(p_kf, &current_color[i]);
                 }
             }
         }
     }
+}
+
+/**
+ * Evaluates the current keyframes of every layer and composites them.
+ * @param[out] p_colors Pointer to write the composited color of every rendered NeoPixel to.
+ * @param      time     Time to evaluate the keyframes at; see @ref pixelkey_keyframeproc_render_frame.
+ */
+static void evaluate_frame(color_rgb_t * p_colors, timestep_t time)
+{
+    // The clock is not known until the first frame; activations pushed before it are timed from 0.
+    if (evalcount == 0)
+    {
+        keyframe_timeline_shift(time - frame_time);
+    }
+    const timestep_t last_frame_time = frame_time;
+    frame_time = time;
+
+    // Start the activations which are due; only the NeoPixels they target are touched.
+    // When several are due for the same NeoPixel the last one pushed is kept.
+    keyframe_activation_t activation;
+    while (keyframe_timeline_pop_due(frame_time, &activation))
+    {
+        // An activation which became due since the last frame starts now. One which was already due then was
+        // scheduled in the past; keyframes can render any time so it starts partway through, in step with its schedule.
+        const bool overdue = (evalcount > 0U) && (int32_t) (activation.start - last_frame_time) < 0;
+        const timestep_t start = overdue ? activation.start : frame_time;
+
+        // Each slot is a NeoPixel on a layer; see pixelkey_keyframeproc_push_at.
+        const uint32_t end = (uint32_t) activation.first + activation.count;
+        for (uint32_t slot = activation.first; slot < end && slot < (uint32_t) pixel_count * PIXELKEY_LAYER_COUNT; slot++)
+        {
+            const uint8_t layer = (uint8_t) (slot / pixel_count);
+            layer_select(layer);
+            activate_keyframe((uint16_t) (slot - (uint32_t) layer * pixel_count), activation.p_keyframe, start);
+        }
+    }
 
-    // Write the colors to the frame buffer
-    for (uint8_t i = 0; i < PIXELKEY_NEOPIXEL_COUNT; i++)
+    // Segments only render on their own ticks. Ticks due within half a frame are rendered now, as the next frame would
+    // be later than this one.
+    const timestep_t slack = (evalcount > 0U) ? (frame_time - last_frame_time) / 2U : 0U;
+    render_range_count = segment_schedule(frame_time, slack, pixel_count, render_ranges);
+
+    // Layers are rendered and composited bottom up; an upper layer without keyframes covers nothing.
+    for (uint8_t layer = 0; layer < PIXELKEY_LAYER_COUNT; layer++)
     {
-        if (config_get_or_default()->flags_b.gamma_enabled)
+        layer_select(layer);
+        if (layer == 0U || current_layer->active > 0U)
         {
-            // This will also move the color into the buffer.
-            color_gamma_correct(&current_color[i], &p_frame_buffer[i]);
+            render_layer(layer, p_colors);
+        }
+    }
+
+    evalcount++;
+}
+
+/**
+ * Evaluates the current keyframes of one NeoPixel and composites its layers, without changing any keyframe state.
+ * Keyframes render the same for a time however often they are rendered, so this may be used for a time already
+ * rendered; a keyframe which has since restarted for a repeat is rendered from its start.
+ * @param      index       Index of the NeoPixel.
+ * @param      time        Time to evaluate the keyframes at.
+ * @param[out] p_color_out Pointer to the composited color, before the output stage.
+ */
+static void evaluate_pixel(uint16_t index, timestep_t time, color_rgb_t * p_color_out)
+{
+    // The bottom layer keeps its last color when it has no keyframe; upper layers then cover only where they have one.
+    *p_color_out = layers[0].p_colors[index];
+    for (uint8_t layer = 0; layer < PIXELKEY_LAYER_COUNT; layer++)
+    {
+        layer_t const * const p_layer = &layers[layer];
+        keyframe_base_t * const p_kf = p_layer->pp_keyframes[index];
+        if (p_kf == NULL)
+        {
+            continue;
+        }
+
+        timestep_t start = p_layer->p_start_times[index];
+        if ((p_kf->flags & KEYFRAME_FLAG_BROADCAST) && p_kf->broadcast.rendered)
+        {
+            start = p_kf->broadcast.start;
+        }
+
+        color_rgb_t rendered;
+        (void) p_kf->p_api->render_frame(p_kf, ((int32_t) (time - start) > 0) ? time - start : 0U, &rendered);
+        if (layer == 0U)
+        {
+            *p_color_out = rendered;
         }
         else
         {
-            p_frame_buffer[i] = current_color[i];
+            color_blend_n(p_layer->blend, &rendered, &p_layer->opacity, p_color_out, 1U);
+        }
+    }
+}
+
+/**
+ * Renders a frame already rendered again, changing only the @ref stale_pixels whose keyframes have started by then.
+ * No keyframe state advances, so the frames after it are rendered as they would have been.
+ * @param[in,out] p_frame_buffer Pointer to the frame buffer holding the earlier render of the frame.
+ * @param         time           Time the frame will be shown; at or before the last rendered frame.
+ */
+static void replay_frame(color_rgb_t * p_frame_buffer, timestep_t time)
+{
+    for (uint16_t i = 0; i < physical_count; i++)
+    {
+        const uint16_t index = (pixel_map != NULL) ? pixel_map[i] : i;
+        if (stale_pixels[index] && (int32_t) (time - stale_starts[index]) >= 0)
+        {
+            evaluate_pixel(index, time, &p_frame_buffer[i]);
+            color_output_apply_n(&p_frame_buffer[i], &p_frame_buffer[i], 1U);
+        }
+    }
+}
+
+/**
+ * Brings the evaluations interpolated between up to date with the @ref stale_pixels, then clears them.
+ * Called with the first frame after those rendered again; the evaluations ahead of it were made before the keyframes
+ * were pushed.
+ */
+static void stale_pixels_clear(void)
+{
+    if (eval_period != 0U && evalcount > 0U)
+    {
+        for (uint16_t i = 0; i < pixel_count; i++)
+        {
+            for (size_t e = 0; e < 2U && stale_pixels[i]; e++)
+            {
+                if ((int32_t) (eval_times[e] - stale_starts[i]) >= 0)
+                {
+                    evaluate_pixel(i, eval_times[e], &eval_frames[e][i]);
+                }
+            }
+        }
+    }
+
+    memset(stale_pixels, 0, pixel_count * sizeof(*stale_pixels));
+    stale_pixels_marked = false;
+}
+
+/**
+ * Performs a render of the current keyframes of every layer.
+ * When the NeoPixels form a matrix each virtual NeoPixel is rendered once, then copied to the NeoPixels that show it.
+ * When an evaluation rate is configured the keyframes are only evaluated on its ticks, one tick ahead of the frames
+ * shown, and every frame is interpolated between the last two evaluations.
+ * Keyframes scheduled with @ref pixelkey_keyframeproc_push_at become current with the first frame evaluated at or after
+ * their start.
+ * @param[out] p_frame_buffer Pointer to the frame buffer to write the colors of every attached NeoPixel to.
+ * @param      time           Time the frame will be shown. This must come from a monotonic clock; when it advances
+ *                            by more than one frame period the skipped frames are dropped from the animations. A time
+ *                            at or before the last rendered frame renders a stale frame again; see
+ *                            @ref pixelkey_keyframeproc_stale_get.
+ * @retval PIXELKEY_ERROR_NONE Frame render was successful.
+ */
+pixelkey_error_t pixelkey_keyframeproc_render_frame(color_rgb_t * p_frame_buffer, timestep_t time)
+{
+    // A frame rendered again after keyframes were pushed for its time only changes the NeoPixels they address; see
+    // pixelkey_keyframeproc_stale_get.
+    if (framecount > 0U && (int32_t) (time - render_time) <= 0)
+    {
+        replay_frame(p_frame_buffer, time);
+        return PIXELKEY_ERROR_NONE;
+    }
+
+    if (stale_pixels_marked)
+    {
+        stale_pixels_clear();
+    }
+
+    color_rgb_t * const p_render_buffer = (pixel_map != NULL) ? virtual_frame : p_frame_buffer;
+
+    if (eval_period == 0U)
+    {
+        evaluate_frame(p_render_buffer, time);
+    }
+    else
+    {
+        // Evaluations start over from the first frame, or when the frames fall behind by a whole evaluation period.
+        const bool restart = (evalcount == 0U) || (int32_t) (time - eval_times[1]) >= (int32_t) eval_period;
+        if (restart)
+        {
+            evaluate_frame(eval_frames[0], time);
+            eval_times[1] = time;
         }
 
-        if (config_get_or_default()->max_rgb_value < UINT8_MAX)
+        // Once the frames reach the later evaluation it becomes the earlier one and the next tick is evaluated.
+        if (restart || (int32_t) (time - eval_times[1]) >= 0)
+        {
+            if (!restart)
+            {
+                color_rgb_t * const p_earlier = eval_frames[1];
+                eval_frames[1] = eval_frames[0];
+                eval_frames[0] = p_earlier;
+            }
+            eval_times[0] = eval_times[1];
+            eval_times[1] = eval_times[0] + eval_period;
+            evaluate_frame(eval_frames[1], eval_times[1]);
+        }
+
+        const timestep_t elapsed = time - eval_times[0];
+        const uint16_t weight = (uint16_t) ((elapsed << COLOR_LERP_WEIGHT_BITS) / eval_period);
+        color_lerp_n(eval_frames[0], eval_frames[1], weight, p_render_buffer, pixel_count);
+    }
+
+    // Apply gamma correction and brightness to the composited colors.
+    color_output_apply_n(p_render_buffer, p_render_buffer, pixel_count);
+
+    if (pixel_map != NULL)
+    {
+        for (uint16_t i = 0; i < physical_count; i++)
         {
-            const uint16_t new_max = (uint16_t)config_get_or_default()->max_rgb_value;
-            // Scale the output by the programmed max value.
-            p_frame_buffer[i].blue = (uint8_t)((new_max * (uint16_t)p_frame_buffer[i].blue + UINT8_MAX / 2) / UINT8_MAX);
-            p_frame_buffer[i].red = (uint8_t)((new_max * (uint16_t)p_frame_buffer[i].red + UINT8_MAX / 2) / UINT8_MAX);
-            p_frame_buffer[i].green = (uint8_t)((new_max * (uint16_t)p_frame_buffer[i].green + UINT8_MAX / 2) / UINT8_MAX);
+            p_frame_buffer[i] = virtual_frame[pixel_map[i]];
         }
     }
 
+    render_time = time;
     framecount++;
 
     return PIXELKEY_ERROR_NONE;
 }
 
 /**
- * Pushes a keyframe into the queue for a given NeoPixel index.
+ * Pushes a keyframe for a given NeoPixel index; it becomes the current keyframe at the next frame.
+ * The keyframe starts with the first frame not rendered yet, so the frames rendered ahead are kept.
  * @param     index      Index of NeoPixel.
  * @param[in] p_keyframe Pointer to keyframe to push.
  * @retval PIXELKEY_ERROR_NONE               Push was successful
  * @retval PIXELKEY_ERROR_INDEX_OUT_OF_RANGE Index is higher than maximum available NeoPixel.
- * @retval PIXELKEY_ERROR_BUFFER_FULL        Buffer if full for the given NeoPixel queue.
+ * @retval PIXELKEY_ERROR_BUFFER_FULL        The keyframe timeline is full.
+ *
+ * @note A keyframe with @ref KEYFRAME_FLAG_BROADCAST may be pushed to several NeoPixels; each successful push takes
+ *       a reference which the processor releases when the NeoPixel is done with it.
+ */
+pixelkey_error_t pixelkey_keyframeproc_push(uint16_t index, keyframe_base_t * p_keyframe)
+{
+    // The time just after the last rendered or evaluated frame is due for the next frame without being overdue. Before
+    // the first frame the clock is not known; see evaluate_frame.
+    timestep_t start = frame_time;
+    if (framecount > 0U && (int32_t) (frame_time - render_time) <= 0)
+    {
+        start = render_time + 1U;
+    }
+    return pixelkey_keyframeproc_push_at(index, p_keyframe, start);
+}
+
+/**
+ * Pushes a keyframe for a given NeoPixel index to become the current keyframe at a frame time.
+ * The keyframe starts with the first frame at or after start; see @ref pixelkey_keyframeproc_push. If start is
+ * before the last rendered frame the keyframe is rendered from the time elapsed since start, as if it had been
+ * running, so NeoPixels and devices given the same start time stay in step. If start is not after the last rendered
+ * frame, the keyframe becomes current at once and the frames from start on are stale for this NeoPixel; see
+ * @ref pixelkey_keyframeproc_stale_get.
+ * @param     index      Index of NeoPixel.
+ * @param[in] p_keyframe Pointer to keyframe to push.
+ * @param     start      Frame time to start the keyframe; must be within 2^31 time steps of the current frame.
+ * @retval PIXELKEY_ERROR_NONE               Push was successful
+ * @retval PIXELKEY_ERROR_INDEX_OUT_OF_RANGE Index is higher than maximum available NeoPixel, or the layer modifier of
+ *                                           the keyframe is not below @ref PIXELKEY_LAYER_COUNT.
+ * @retval PIXELKEY_ERROR_BUFFER_FULL        The keyframe timeline is full.
+ *
+ * @note The keyframe is pushed to the layer in its modifiers. It starts from the last color rendered on that layer.
  */
-pixelkey_error_t pixelkey_keyframeproc_push(uint8_t index, keyframe_base_t * p_keyframe)
+pixelkey_error_t pixelkey_keyframeproc_push_at(uint16_t index, keyframe_base_t * p_keyframe, timestep_t start)
 {
-    if (index >= PIXELKEY_NEOPIXEL_COUNT)
+    const uint8_t layer = p_keyframe->modifiers.layer;
+    if (index >= pixel_count || layer >= PIXELKEY_LAYER_COUNT)
     {
         return PIXELKEY_ERROR_INDEX_OUT_OF_RANGE;
     }
-    if (!ring_buffer_push(&keyframe_queue[index], p_keyframe))
+
+    // A keyframe starting by the last rendered frame is already due; it becomes current now so the frames rendered
+    // ahead can show it. The others wait in the timeline, which addresses NeoPixels by slot so the NeoPixels of a layer
+    // stay consecutive for broadcasts.
+    const bool rendered = (framecount > 0U) && (int32_t) (start - render_time) <= 0;
+    const uint16_t slot = (uint16_t) (layer * pixel_count + index);
+    if (!rendered && !keyframe_timeline_insert(start, slot, p_keyframe))
     {
         return PIXELKEY_ERROR_BUFFER_FULL;
     }
 
+    // The reference is taken first, as the keyframe may replace itself on the NeoPixel.
+    if (p_keyframe->flags & KEYFRAME_FLAG_BROADCAST)
+    {
+        p_keyframe->broadcast.refs++;
+    }
+
+    if (rendered)
+    {
+        layer_select(layer);
+        activate_keyframe(index, p_keyframe, start);
+
+        // Frames already rendered from the start on do not show the keyframe; only this NeoPixel changes in them.
+        if (!stale_pixels[index] || (int32_t) (start - stale_starts[index]) < 0)
+        {
+            stale_starts[index] = start;
+        }
+        stale_pixels[index] = true;
+        stale_pixels_marked = true;
+
+        if (!stale || (int32_t) (start - stale_time) < 0)
+        {
+            stale_time = start;
+        }
+        stale = true;
+    }
+
     return PIXELKEY_ERROR_NONE;
 }
 
 /**
- * Sets the framerate used to render keyframes.
- * @param framerate The framerate to use.
+ * Gets the earliest frame time changed by the keyframes pushed since the last call.
+ * Frames rendered for this time or later are stale and should be rendered again, in order, starting with the first
+ * one at or after it, into the frame buffers holding their earlier renders; only the NeoPixels given the keyframes
+ * change.
+ * @param[out] p_time Pointer to store the time.
+ * @return true if rendered frames are stale, false if they are all up to date.
+ */
+bool pixelkey_keyframeproc_stale_get(timestep_t * p_time)
+{
+    if (!stale)
+    {
+        return false;
+    }
+
+    *p_time = stale_time;
+    stale = false;
+    return true;
+}
+
+/**
+ * Releases a reference to a keyframe, freeing it once it is no longer used.
+ * Keyframes without @ref KEYFRAME_FLAG_BROADCAST have a single owner and are always freed.
+ * The memory is reclaimed later by @ref keyframe_reclaim so this is safe to call while rendering.
+ * @param[in] p_keyframe Pointer to the keyframe to release.
  */
-void pixelkey_keyframeproc_framerate_set(framerate_t framerate)
+void pixelkey_keyframeproc_release(keyframe_base_t * p_keyframe)
 {
-    current_framerate = framerate;
+    if ((p_keyframe->flags & KEYFRAME_FLAG_BROADCAST) && p_keyframe->broadcast.refs > 1U)
+    {
+        p_keyframe->broadcast.refs--;
+        return;
+    }
+
+    keyframe_destroy_deferred(p_keyframe);
+}
 
-    // The keyframes need to be re-initialized with the new framerate.
-    // This will completely restart the keyframe, but it is either that or throw them out.
-    for (size_t i = 0; i < PIXELKEY_NEOPIXEL_COUNT; i++)
+/**
+ * Sets how a layer is composited over the layers beneath it.
+ * @param layer   Index of the layer; the bottom layer, 0, is always drawn as-is.
+ * @param blend   How the colors of the layer are combined with the colors beneath.
+ * @param opacity Amount of the blended color shown, from 0 for none to 255 for all of it.
+ * @retval PIXELKEY_ERROR_NONE               The layer was set.
+ * @retval PIXELKEY_ERROR_INDEX_OUT_OF_RANGE layer is not below @ref PIXELKEY_LAYER_COUNT or blend is invalid.
+ */
+pixelkey_error_t pixelkey_keyframeproc_layer_set(uint8_t layer, color_blend_t blend, uint8_t opacity)
+{
+    if (layer >= PIXELKEY_LAYER_COUNT || blend >= COLOR_BLEND_COUNT)
     {
-        current_framecount[i] = 0;
-        init_keyframe(current_keyframe[i], &current_color[i]);
+        return PIXELKEY_ERROR_INDEX_OUT_OF_RANGE;
     }
+
+    layers[layer].blend = blend;
+    layers[layer].opacity = opacity;
+
+    return PIXELKEY_ERROR_NONE;
+}
+
+/**
+ * Rebuilds the output stage from the gamma correction and brightness settings in the configuration.
+ * This must be called whenever gamma_enabled, gamma_factor, or max_rgb_value are changed.
+ */
+void pixelkey_keyframeproc_output_update(void)
+{
+    config_data_t const * const p_config = config_get_or_default();
+
+    color_output_build(p_config->flags_b.gamma_enabled, p_config->gamma_factor, p_config->max_rgb_value);
 }
 
 /**
@@ -182,19 +782,121 @@ uint32_t pixelkey_keyframeproc_framecount_get(void)
     return framecount;
 }
 
+/**
+ * Gets the number of NeoPixels rendered; keyframes are pushed to NeoPixels 0 to this count - 1.
+ * @return The pixel count set by @ref pixelkey_frameproc_init, or the number of virtual NeoPixels when the NeoPixels
+ *         form a matrix.
+ */
+uint16_t pixelkey_keyframeproc_pixel_count_get(void)
+{
+    return pixel_count;
+}
+
 /**
  * Initializes the keyframe processor.
- * @param framerate The initial framerate to use.
+ * The matrix layout is read from the configuration; a layout that does not fit count NeoPixels is ignored and the
+ * NeoPixels are rendered as a strip. So is the evaluation rate; the keyframes are evaluated for every frame if the
+ * arena does not have room for the frames to interpolate between.
+ * @param[in] p_arena   Pointer to the arena to allocate all per-pixel state from.
+ * @param     count     Number of NeoPixels attached; the frame buffers hold this many colors.
+ * @retval PIXELKEY_ERROR_NONE               The keyframe processor was initialized.
+ * @retval PIXELKEY_ERROR_INDEX_OUT_OF_RANGE count is 0 or larger than @ref PIXELKEY_NEOPIXEL_COUNT_MAX.
+ * @retval PIXELKEY_ERROR_OUT_OF_MEMORY      The arena does not have enough space for count NeoPixels.
+ *
+ * @note On error the keyframe processor renders no NeoPixels.
 */
-void pixelkey_frameproc_init(framerate_t framerate)
+pixelkey_error_t pixelkey_frameproc_init(arena_t * p_arena, uint32_t count)
 {
     framecount = 0;
-    current_framerate = framerate;
+    evalcount = 0;
+    frame_time = 0;
+    render_time = 0;
+    stale = false;
+    stale_pixels_marked = false;
+    eval_period = 0;
+    pixel_count = 0;
+    physical_count = 0;
+    pixel_map = NULL;
+    virtual_frame = NULL;
+
+    // Pending activations are for the previous NeoPixel state, and segment ticks for the previous clock.
+    keyframe_timeline_clear();
+    segment_restart();
+
+    pixelkey_keyframeproc_output_update();
+
+    if (count == 0 || count > PIXELKEY_NEOPIXEL_COUNT_MAX)
+    {
+        return PIXELKEY_ERROR_INDEX_OUT_OF_RANGE;
+    }
+
+    // The table is only built when a matrix changes the order of the NeoPixels.
+    pixel_map_layout_t const * const p_layout = &config_get_or_default()->matrix;
+    uint16_t virtual_count = (uint16_t) count;
+    const bool mapped = !pixel_map_is_identity(p_layout) &&
+                        pixel_map_virtual_count(p_layout, (uint16_t) count, &virtual_count) == PIXELKEY_ERROR_NONE;
+    if (mapped)
+    {
+        pixel_map = arena_alloc(p_arena, count * sizeof(*pixel_map));
+        virtual_frame = arena_alloc(p_arena, virtual_count * sizeof(*virtual_frame));
+        if (pixel_map == NULL || virtual_frame == NULL)
+        {
+            pixel_map = NULL;
+            return PIXELKEY_ERROR_OUT_OF_MEMORY;
+        }
+        pixel_map_build(p_layout, (uint16_t) count, pixel_map);
+    }
+    else
+    {
+        virtual_count = (uint16_t) count;
+    }
+
+    // Layers start empty and drawn as-is.
+    bool layers_allocated = true;
+    for (uint8_t l = 0; l < PIXELKEY_LAYER_COUNT; l++)
+    {
+        layer_t * const p_layer = &layers[l];
+        p_layer->p_colors = arena_alloc(p_arena, virtual_count * sizeof(*p_layer->p_colors));
+        p_layer->pp_keyframes = arena_alloc(p_arena, virtual_count * sizeof(*p_layer->pp_keyframes));
+        p_layer->p_start_times = arena_alloc(p_arena, virtual_count * sizeof(*p_layer->p_start_times));
+        p_layer->p_finished = arena_alloc(p_arena, virtual_count * sizeof(*p_layer->p_finished));
+        p_layer->active = 0;
+        p_layer->blend = COLOR_BLEND_REPLACE;
+        p_layer->opacity = UINT8_MAX;
+
+        layers_allocated = layers_allocated && p_layer->p_colors != NULL && p_layer->pp_keyframes != NULL &&
+                           p_layer->p_start_times != NULL && p_layer->p_finished != NULL;
+    }
+    hsv_colors = arena_alloc(p_arena, virtual_count * sizeof(*hsv_colors));
+    hsv_rgb_colors = arena_alloc(p_arena, virtual_count * sizeof(*hsv_rgb_colors));
+    hsv_pixels = arena_alloc(p_arena, virtual_count * sizeof(*hsv_pixels));
+    layer_opacity = arena_alloc(p_arena, virtual_count * sizeof(*layer_opacity));
+    stale_pixels = arena_alloc(p_arena, virtual_count * sizeof(*stale_pixels));
+    stale_starts = arena_alloc(p_arena, virtual_count * sizeof(*stale_starts));
 
-    for (size_t i = 0; i < PIXELKEY_NEOPIXEL_COUNT; i++)
+    if (!layers_allocated || hsv_colors == NULL || hsv_rgb_colors == NULL || hsv_pixels == NULL ||
+        layer_opacity == NULL || stale_pixels == NULL || stale_starts == NULL)
     {
-        ring_buffer_init(&keyframe_queue[i], &keyframe_queue_buffer[i], PIXELKEY_KEYFRAME_QUEUE_LENGTH);
+        return PIXELKEY_ERROR_OUT_OF_MEMORY;
     }
+    memset(stale_pixels, 0, virtual_count * sizeof(*stale_pixels));
+
+    // Interpolation is optional, so its frames are allocated after the state every NeoPixel needs.
+    const framerate_t eval_rate = config_get_or_default()->eval_rate;
+    if (eval_rate != 0U)
+    {
+        eval_frames[0] = arena_alloc(p_arena, virtual_count * sizeof(*eval_frames[0]));
+        eval_frames[1] = arena_alloc(p_arena, virtual_count * sizeof(*eval_frames[1]));
+        if (eval_frames[0] != NULL && eval_frames[1] != NULL)
+        {
+            eval_period = TIMESTEP_PER_SECOND / eval_rate;
+        }
+    }
+
+    pixel_count = virtual_count;
+    physical_count = (uint16_t) count;
+
+    return PIXELKEY_ERROR_NONE;
 }
 
 /** @} */
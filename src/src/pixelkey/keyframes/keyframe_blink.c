@@ -5,6 +5,7 @@
 
 #include "pixelkey.h"
 #include "keyframes.h"
+#include "keyframe_pool.h"
 
 /**
  * @addtogroup pixelkey__keyframes__blink
@@ -15,7 +16,8 @@
 #define DUTY_CYCLE_DEFAULT  (50U)
 
 static bool keyframe_blink_render_frame(keyframe_base_t * const p_keyframe, timestep_t time, color_rgb_t * p_color_out);
-static void keyframe_blink_render_init(keyframe_base_t * const p_keyframe, framerate_t framerate, color_rgb_t current_color);
+static bool keyframe_blink_render_span(keyframe_base_t * const p_keyframe, timestep_t time, uint16_t first_index, uint16_t count, color_rgb_t * p_colors_out);
+static void keyframe_blink_render_init(keyframe_base_t * const p_keyframe, color_rgb_t current_color);
 static keyframe_base_t * keyframe_blink_clone(keyframe_base_t const * const p_keyframe);
 
 /**
@@ -25,6 +27,7 @@ static keyframe_base_t * keyframe_blink_clone(keyframe_base_t const * const p_ke
 static const keyframe_base_api_t keyframe_blink_api =
 {
     .render_frame = keyframe_blink_render_frame,
+    .render_span = keyframe_blink_render_span,
     .render_init = keyframe_blink_render_init,
     .clone = keyframe_blink_clone,
 };
@@ -72,19 +75,31 @@ static bool keyframe_blink_render_frame(keyframe_base_t * const p_keyframe, time
 
 /**
  * @internal
- * Initialize the keyframe for rendering.
- * See @ref keyframe_base_api_t::render_init
+ * Renders the frame for a range of NeoPixels.
+ * See @ref keyframe_base_api_t::render_span
  */
-static void keyframe_blink_render_init(keyframe_base_t * const p_keyframe, framerate_t framerate, color_rgb_t current_color)
+static bool keyframe_blink_render_span(keyframe_base_t * const p_keyframe, timestep_t time, uint16_t first_index, uint16_t count, color_rgb_t * p_colors_out)
 {
-    keyframe_blink_t * const p_blink = (keyframe_blink_t * const) p_keyframe;
+    ARG_NOT_USED(first_index);
 
-    if (!p_blink->args.color1_provided)
+    color_rgb_t color;
+    const bool done = keyframe_blink_render_frame(p_keyframe, time, &color);
+    for (uint16_t i = 0; i < count; i++)
     {
-        p_blink->args.color1.color_space = COLOR_SPACE_RGB;
-        p_blink->args.color1.rgb = current_color;
+        p_colors_out[i] = color;
     }
-    else if (p_blink->args.color1.color_space != COLOR_SPACE_RGB)
+
+    return done;
+}
+
+/**
+ * @internal
+ * Lowers the arguments of a blink keyframe into render-ready form: RGB colors and times in time steps.
+ * @param[in,out] p_blink Pointer to the keyframe.
+ */
+static void keyframe_blink_lower(keyframe_blink_t * const p_blink)
+{
+    if (p_blink->args.color1_provided && p_blink->args.color1.color_space != COLOR_SPACE_RGB)
     {
         color_t c1 = {0};
         color_convert(COLOR_SPACE_RGB,
@@ -107,14 +122,37 @@ static void keyframe_blink_render_init(keyframe_base_t * const p_keyframe, frame
         p_blink->args.color2 = c2;
     }
 
-    p_blink->state.finish_time = (timestep_t) (p_blink->args.period * ((float) framerate));
-    p_blink->state.transition_time = (timestep_t) ((p_blink->state.finish_time * p_blink->args.duty_cycle) / 100);
+    p_blink->state.finish_time = TIMESTEP_FROM_SECONDS(p_blink->args.period);
+    p_blink->state.transition_time = TIMESTEP_FROM_SECONDS(p_blink->args.period * (float) p_blink->args.duty_cycle / 100.0f);
+
+    p_blink->base.flags |= KEYFRAME_FLAG_LOWERED;
+}
+
+/**
+ * @internal
+ * Initialize the keyframe for rendering.
+ * See @ref keyframe_base_api_t::render_init
+ */
+static void keyframe_blink_render_init(keyframe_base_t * const p_keyframe, color_rgb_t current_color)
+{
+    keyframe_blink_t * const p_blink = (keyframe_blink_t * const) p_keyframe;
+
+    if (!(p_blink->base.flags & KEYFRAME_FLAG_LOWERED))
+    {
+        keyframe_blink_lower(p_blink);
+    }
+
+    if (!p_blink->args.color1_provided)
+    {
+        p_blink->args.color1.color_space = COLOR_SPACE_RGB;
+        p_blink->args.color1.rgb = current_color;
+    }
 }
 
 static keyframe_base_t * keyframe_blink_clone(keyframe_base_t const * const p_keyframe)
 {
     // Allocate a new keyframe and copy the values.
-    keyframe_blink_t * p_blink = malloc(sizeof(keyframe_blink_t));
+    keyframe_blink_t * p_blink = keyframe_alloc(sizeof(keyframe_blink_t));
     if (p_blink == NULL)
     {
         return NULL;
@@ -138,6 +176,10 @@ keyframe_base_t * keyframe_blink_parse(char * p_str)
 
     // Allocate a new keyframe and copy the default values.
     keyframe_blink_t * p_blink = (keyframe_blink_t *) keyframe_blink_ctor(NULL);
+    if (p_blink == NULL)
+    {
+        return NULL;
+    }
 
     bool has_error = true;
     do
@@ -168,32 +210,34 @@ keyframe_base_t * keyframe_blink_parse(char * p_str)
         }
 
         // else: Parse the color list
-        char * p_color_context = NULL;
-        char * p_color_tok = strtok_r(p_tok, ":", &p_color_context);
-        if (!color_parse(p_color_tok, &p_blink->args.color1))
+        size_t colors_remaining = strlen(p_tok);
+        size_t consumed = color_parse_n(p_tok, colors_remaining, &p_blink->args.color1);
+        if (consumed == 0)
         {
             // Color parsing failed!
             break;
         }
         p_blink->args.color1_provided = true;
+        colors_remaining -= consumed;
 
         // See if a second color was provided.
-        p_color_tok = strtok_r(NULL, ":", &p_color_context);
-        if (p_color_tok != NULL)
+        if (colors_remaining > 0)
         {
-            if (!color_parse(p_color_tok, &p_blink->args.color2))
+            if (p_tok[consumed] != ':')
             {
-                // Color parsing failed!
+                // Unexpected characters after the color.
                 break;
             }
-            p_blink->args.color2_provided = true;
-        }
+            consumed++;
+            colors_remaining--;
 
-        // Make sure no additional colors are provided.
-        p_color_tok = strtok_r(NULL, ":", &p_color_context);
-        if (p_color_tok != NULL)
-        {
-            break;
+            // The second color must be the end of the list.
+            if (colors_remaining == 0 ||
+                color_parse_n(&p_tok[consumed], colors_remaining, &p_blink->args.color2) != colors_remaining)
+            {
+                break;
+            }
+            p_blink->args.color2_provided = true;
         }
 
         // Lastly check to see if a duty cycle was provided.
@@ -226,11 +270,13 @@ keyframe_base_t * keyframe_blink_parse(char * p_str)
     if (has_error)
     {
         // Cleanup on error.
-        free(p_blink);
+        keyframe_free(p_blink);
         return NULL;
     }
     else
     {
+        // Clones and repeats then render without converting anything.
+        keyframe_blink_lower(p_blink);
         return &p_blink->base;
     }
 }
@@ -245,7 +291,11 @@ keyframe_base_t * keyframe_blink_ctor(keyframe_blink_t * p_blink)
     // If NULL, allocate a new set keyframe.
     if (p_blink == NULL)
     {
-        p_blink = malloc(sizeof(keyframe_blink_t));
+        p_blink = keyframe_alloc(sizeof(keyframe_blink_t));
+        if (p_blink == NULL)
+        {
+            return NULL;
+        }
         memcpy(p_blink, &keyframe_blink_init, sizeof(*p_blink));
     }
     else
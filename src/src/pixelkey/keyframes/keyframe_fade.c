@@ -3,21 +3,37 @@
 #include <stdint.h>
 #include <string.h>
 #include <math.h>
+#include <assert.h>
 
 #include "pixelkey.h"
 #include "keyframes.h"
+#include "keyframe_pool.h"
+#include "palette.h"
 
 /**
  * @addtogroup pixelkey__keyframes__fade
  * @{
  */
 
+/** Largest error in x accepted when solving the bezier curve for the current time; well under one color step. */
+#define FADE_CURVE_EPSILON      (1.0f / 1024.0f)
+
+/** Newton-Raphson iterations tried when solving the bezier curve; enough for the standard curves. */
+#define FADE_CURVE_NEWTON_STEPS (4U)
+
+/** Bisection iterations used when Newton-Raphson does not converge; halves the error each time. */
+#define FADE_CURVE_BISECT_STEPS (12U)
+
 static bool keyframe_fade_render_frame(keyframe_base_t * const p_keyframe, timestep_t time, color_rgb_t * p_color_out);
-static void keyframe_fade_render_init(keyframe_base_t * const p_keyframe, framerate_t framerate, color_rgb_t current_color);
+static bool keyframe_fade_render_frame_hsv(keyframe_base_t * const p_keyframe, timestep_t time, color_hsv_t * p_color_out);
+static void keyframe_fade_render_init(keyframe_base_t * const p_keyframe, color_rgb_t current_color);
+static void keyframe_fade_release(keyframe_base_t * const p_keyframe, bool deferred);
 static keyframe_base_t * keyframe_fade_clone(keyframe_base_t const * const p_keyframe);
 
 static void blend_colors(color_hsv_t const * p_a, color_hsv_t const * p_b, fade_axis_t axis, float ratio, color_hsv_t * p_out);
-static void cubic_bezier_calc(cubic_bezier_t const * const p_curve, float t, point_t * p_point);
+static fade_axis_t fade_axis_diff(color_hsv_t const * p_a, color_hsv_t const * p_b);
+static void cubic_bezier_prepare(cubic_bezier_t const * const p_curve, cubic_coeffs_t * p_x, cubic_coeffs_t * p_y);
+static float cubic_bezier_solve(cubic_coeffs_t const * p_x, cubic_coeffs_t const * p_y, float x);
 
 /**
  * Fade keyframe API function pointers.
@@ -25,7 +41,9 @@ static void cubic_bezier_calc(cubic_bezier_t const * const p_curve, float t, poi
 static const keyframe_base_api_t keyframe_fade_api =
 {
     .render_frame = keyframe_fade_render_frame,
+    .render_frame_hsv = keyframe_fade_render_frame_hsv,
     .render_init = keyframe_fade_render_init,
+    .release = keyframe_fade_release,
     .clone = keyframe_fade_clone,
 };
 
@@ -35,14 +53,19 @@ static const keyframe_base_api_t keyframe_fade_api =
 static const keyframe_fade_t keyframe_fade_init = 
 {
     .base = { .p_api = &keyframe_fade_api },
-    .args =
-    {
-        .colors_len = 0,
-        .push_current = false,
-        .fade_type = FADE_TYPE_CUBIC,
-        .curve = { { 0.0f,  0.0f }, { 1.0f,  1.0f } },  // Linear fade
-        .period = 1
-    }
+};
+
+/**
+ * Default values for fade keyframe arguments; the owner holds the first reference.
+ */
+static const keyframe_fade_args_t keyframe_fade_args_init =
+{
+    .refs = 1,
+    .colors_len = 0,
+    .push_current = false,
+    .fade_type = FADE_TYPE_CUBIC,
+    .curve = { { 0.0f,  0.0f }, { 1.0f,  1.0f } },  // Linear fade
+    .period = 1
 };
 
 /** Control points for linear fade. Fades linearly, in equal steps, between the start and end values. */
@@ -58,115 +81,149 @@ const cubic_bezier_t cb_ease_in_out = { { 0.42f, 0.0f }, { 0.58f, 1.0f } };
 
 static bool keyframe_fade_render_frame(keyframe_base_t * const p_keyframe, timestep_t time, color_rgb_t * p_color_out)
 {
-    keyframe_fade_t * const p_fade = (keyframe_fade_t * const) p_keyframe;
+    color_hsv_t color;
+    bool finished = keyframe_fade_render_frame_hsv(p_keyframe, time, &color);
+    color_convert_hsv_to_rgb_n(&color, p_color_out, 1);
+    return finished;
+}
 
-    // Increment the pair index if we should be at a new one.
-    // This assumes time increases monotonically. If for some reason it doesn't, the fade will be broken anyway.
-    if (time == (p_fade->state.pair_index + 1) * p_fade->state.pair_period)
-    {
-        p_fade->state.pair_index += 1;
-        p_fade->state.curr_b_info = (point_t) { 0.0f, 0.0f };
-    }
-    
-    if (p_fade->args.fade_type == FADE_TYPE_STEP)
+static bool keyframe_fade_render_frame_hsv(keyframe_base_t * const p_keyframe, timestep_t time, color_hsv_t * p_color_out)
+{
+    keyframe_fade_t const * const p_fade = (keyframe_fade_t const *) p_keyframe;
+    keyframe_fade_args_t const * const p_args = p_fade->p_args;
+
+    // Find the pair for this time directly so any time can be rendered without the frames before it.
+    const uint8_t last_index = (uint8_t) (p_args->colors_len - 1U);
+    const timestep_t pair_index_t = (p_args->pair_period > 0U) ? time / p_args->pair_period : last_index;
+    const uint8_t pair_index = (pair_index_t < last_index) ? (uint8_t) pair_index_t : last_index;
+
+    // The first color of the shared list is a slot for each keyframe's own current color.
+    color_hsv_t const * const p_from = (pair_index == 0U && p_args->push_current) ?
+                                       &p_fade->state.current : &p_args->colors[pair_index];
+
+    if (p_args->fade_type == FADE_TYPE_STEP || pair_index >= last_index)
     {
-        // Just output the color. Nice and simple.
-        color_convert2(COLOR_SPACE_HSV, COLOR_SPACE_RGB,
-                        (color_kind_t *) &p_fade->args.colors[p_fade->state.pair_index],
-                        (color_kind_t *)p_color_out);
+        // Just output the color. Nice and simple. This is also the final color of a cubic fade.
+        *p_color_out = *p_from;
     }
-    else // p_fade->args.fade_type == FADE_TYPE_CUBIC
+    else // p_args->fade_type == FADE_TYPE_CUBIC
     {
         // Get the time relative to the start of this pair's transition.
-        // This is used to index the bezier curve.
-        float relative_time = ((float) time) /  ((float) p_fade->state.pair_period) - ((float) p_fade->state.pair_index);
+        // This is the x coordinate on the bezier curve; the y coordinate is the blend ratio.
+        const timestep_t pair_time = time - (timestep_t) pair_index * p_args->pair_period;
+        const float relative_time = (float) pair_time / (float) p_args->pair_period;
 
-        if (relative_time >= p_fade->state.curr_b_info.x)
-        {
-            float apparent_time = relative_time;
-            while (relative_time > p_fade->state.curr_b_info.x && apparent_time <= 1.0)
-            {
-                cubic_bezier_calc(&p_fade->args.curve, apparent_time, &p_fade->state.curr_b_info);
-                apparent_time += 1.0f / ((float) p_fade->state.framerate);
-            }
-        }
+        const float ratio = p_args->curve_linear ? relative_time :
+                            cubic_bezier_solve(&p_args->curve_x, &p_args->curve_y, relative_time);
 
-        color_hsv_t blended_color;
-        blend_colors(&p_fade->args.colors[p_fade->state.pair_index],
-                        &p_fade->args.colors[p_fade->state.pair_index + 1],
+        blend_colors(p_from,
+                        &p_args->colors[pair_index + 1],
                         p_fade->state.fade_axis,
-                        p_fade->state.curr_b_info.y,
-                        &blended_color);
-
-        // Convert and write the blended color to the output.
-        color_convert2(COLOR_SPACE_HSV, COLOR_SPACE_RGB, (color_kind_t *) &blended_color, (color_kind_t *)p_color_out);
+                        ratio,
+                        p_color_out);
     }
-    return time >= p_fade->state.finish_time;
+    return time >= p_args->finish_time;
 }
 
-static void keyframe_fade_render_init(keyframe_base_t * const p_keyframe, framerate_t framerate, color_rgb_t current_color)
+/**
+ * Lowers the arguments of a fade keyframe into render-ready form: the color list with room for the current color,
+ * times in time steps, and the curve prepared for solving.
+ * @param[in,out] p_args Pointer to the arguments.
+ */
+static void keyframe_fade_lower(keyframe_fade_args_t * const p_args)
 {
-    keyframe_fade_t * const p_fade = (keyframe_fade_t * const) p_keyframe;
-
     // Determine if the current color should be pushed onto the color list.
-    if (p_fade->args.colors_len == 1 || p_fade->args.push_current)
+    if (p_args->colors_len == 1 || p_args->push_current)
     {
-        // Move all the colors down one spot.
-        for (uint8_t i = p_fade->args.colors_len - 1; i >= 1; i--)
+        // Move all the colors down one spot; each keyframe renders its current color in the first.
+        for (uint8_t i = p_args->colors_len; i >= 1; i--)
         {
-            p_fade->args.colors[i] = p_fade->args.colors[i - 1];
+            p_args->colors[i] = p_args->colors[i - 1];
         }
-        p_fade->args.colors_len += 1;
-
-        // Insert the current color as HSV.
-        color_convert2(COLOR_SPACE_RGB, COLOR_SPACE_HSV, (color_kind_t *)&current_color, (color_kind_t *)&p_fade->args.colors[0]);
+        p_args->colors_len += 1;
+        p_args->push_current = true;
     }
 
-    // Determine which axis require fading. This allows for some optimization later.
+    // Determine which axis require fading between the known colors. This allows for some optimization later.
+    const uint8_t first = p_args->push_current ? 1U : 0U;
     fade_axis_t axis = FADE_AXIS_NONE;
-    for (uint8_t i = 1; i < p_fade->args.colors_len; i++)
+    for (uint8_t i = first + 1U; i < p_args->colors_len; i++)
     {
-        if (p_fade->args.colors[i].hue != p_fade->args.colors[0].hue)
-        {
-            axis |= FADE_AXIS_HUE;
-        }
+        axis |= fade_axis_diff(&p_args->colors[first], &p_args->colors[i]);
+    }
+    p_args->fade_axis = axis;
 
-        if (p_fade->args.colors[i].saturation != p_fade->args.colors[0].saturation)
-        {
-            axis |= FADE_AXIS_SAT;
-        }
+    // Calculate the total time for the keyframe.
+    p_args->finish_time = TIMESTEP_FROM_SECONDS(p_args->period);
 
-        if (p_fade->args.colors[i].value != p_fade->args.colors[0].value)
-        {
-            axis |= FADE_AXIS_VAL;
-        }
+    // Calculate the period between each pair of colors.
+    p_args->pair_period = (timestep_t) (p_args->finish_time / (p_args->colors_len - 1));
+
+    // A curve with control points on the line y = x is that line.
+    cubic_bezier_t const * const p_curve = &p_args->curve;
+    p_args->curve_linear = (p_curve->p1.x == p_curve->p1.y) && (p_curve->p2.x == p_curve->p2.y);
+    cubic_bezier_prepare(p_curve, &p_args->curve_x, &p_args->curve_y);
+
+    p_args->lowered = true;
+}
+
+static void keyframe_fade_render_init(keyframe_base_t * const p_keyframe, color_rgb_t current_color)
+{
+    keyframe_fade_t * const p_fade = (keyframe_fade_t * const) p_keyframe;
+    keyframe_fade_args_t * const p_args = p_fade->p_args;
+
+    if (!p_args->lowered)
+    {
+        keyframe_fade_lower(p_args);
     }
-    p_fade->state.fade_axis = axis;
 
-    // Save the framerate
-    p_fade->state.framerate = framerate;
+    p_fade->state.fade_axis = p_args->fade_axis;
+    if (p_args->push_current)
+    {
+        // Keep the current color as HSV.
+        color_convert2(COLOR_SPACE_RGB, COLOR_SPACE_HSV, (color_kind_t *)&current_color, (color_kind_t *)&p_fade->state.current);
 
-    // Calculate the total time for the keyframe.
-    p_fade->state.finish_time = (timestep_t) (p_fade->args.period * ((float) framerate));
+        // Every other color was compared to the first known color, so only that one needs comparing to it.
+        p_fade->state.fade_axis |= fade_axis_diff(&p_fade->state.current, &p_args->colors[1]);
+    }
+}
 
-    // Calculate the period between each pair of colors.
-    p_fade->state.pair_period = (timestep_t) (p_fade->state.finish_time / (p_fade->args.colors_len - 1)); 
+/**
+ * Drops the keyframe's reference to its shared arguments, returning them to their pool if it was the last.
+ * @param[in] p_keyframe Pointer to the keyframe.
+ * @param     deferred   true to return the arguments with @ref keyframe_free_deferred.
+ */
+static void keyframe_fade_release(keyframe_base_t * const p_keyframe, bool deferred)
+{
+    keyframe_fade_args_t * const p_args = ((keyframe_fade_t *) p_keyframe)->p_args;
 
-    // Set default values.
-    p_fade->state.pair_index = 0;
-    p_fade->state.curr_b_info.x = 0.0f;
-    p_fade->state.curr_b_info.y = 0.0f;
+    assert(p_args->refs > 0U);
+    if (--p_args->refs == 0U)
+    {
+        if (deferred)
+        {
+            keyframe_free_deferred(p_args);
+        }
+        else
+        {
+            keyframe_free(p_args);
+        }
+    }
 }
 
 static keyframe_base_t * keyframe_fade_clone(keyframe_base_t const * const p_keyframe)
 {
-    // Allocate a new keyframe and copy the values.
-    keyframe_fade_t * p_fade = malloc(sizeof(keyframe_fade_t));
+    keyframe_fade_t const * const p_template = (keyframe_fade_t const *) p_keyframe;
+    assert(p_template->p_args->refs < UINT16_MAX);
+
+    // Allocate a new keyframe which shares the arguments.
+    keyframe_fade_t * p_fade = keyframe_alloc(sizeof(keyframe_fade_t));
     if (p_fade == NULL)
     {
         return NULL;
     }
-    memcpy(p_fade, p_keyframe, sizeof(keyframe_fade_t));
+    memcpy(p_fade, p_template, sizeof(keyframe_fade_t));
+    p_fade->p_args->refs++;
 
     return &p_fade->base;
 }
@@ -242,33 +299,128 @@ static void blend_colors(color_hsv_t const * p_a, color_hsv_t const * p_b, fade_
 
 /**
  * @private
- * Calculates a point on a cubic bezier curve at interpolation index, t.
+ * Finds the axes two colors differ in.
+ * @param[in] p_a Pointer to the first color.
+ * @param[in] p_b Pointer to the second color.
+ * @return The axes which need fading between the colors.
+ */
+static fade_axis_t fade_axis_diff(color_hsv_t const * p_a, color_hsv_t const * p_b)
+{
+    fade_axis_t axis = FADE_AXIS_NONE;
+
+    if (p_a->hue != p_b->hue)
+    {
+        axis |= FADE_AXIS_HUE;
+    }
+
+    if (p_a->saturation != p_b->saturation)
+    {
+        axis |= FADE_AXIS_SAT;
+    }
+
+    if (p_a->value != p_b->value)
+    {
+        axis |= FADE_AXIS_VAL;
+    }
+
+    return axis;
+}
+
+/**
+ * @private
+ * Prepares the polynomial coefficients of a cubic bezier curve.
  * 
  * This function assumes start, \f$ P_0 \f$, and end, \f$ P_3 \f$, points of \f$ (0,0) \f$ and \f$ (1,1) \f$ respectively.
  * The equation for the bezier curve is
  * \f[
  *  \vec{B}(t) = (1-t)^3 \vec{P}_0 + 3 (1-t)^2 t \vec{P}_1 + 3 (1-t) t^2 \vec{P}_2 + t^3 \vec{P}_3, \quad 0 \le t \le 1
  * \f]
- * or simplified using the assumptions for \f$ P_0 \f$ and \f$ P_3 \f$
+ * or simplified using the assumptions for \f$ P_0 \f$ and \f$ P_3 \f$ and expanded in powers of t
  * \f[
- *  \vec{B}(t) = 3 (1-t)^2 t \vec{P}_1 + 3 (1-t) t^2 \vec{P}_2 + t^3, \quad 0 \le t \le 1
+ *  \vec{B}(t) = ((\vec{a} t + \vec{b}) t + \vec{c}) t, \quad \vec{c} = 3 \vec{P}_1, \quad
+ *  \vec{b} = 3 (\vec{P}_2 - \vec{P}_1) - \vec{c}, \quad \vec{a} = 1 - \vec{c} - \vec{b}
  * \f]
  * 
  * @param[in]  p_curve Pointer to the bezier control points.
- * @param      t       Interpolation index at which to calculate a point on the curve; 0 <= t <= 1.
- * @param[out] p_point Pointer to store the calculated point.
+ * @param[out] p_x     Pointer to store the coefficients of the x axis.
+ * @param[out] p_y     Pointer to store the coefficients of the y axis.
+ */
+static void cubic_bezier_prepare(cubic_bezier_t const * const p_curve, cubic_coeffs_t * p_x, cubic_coeffs_t * p_y)
+{
+    p_x->c = 3.0f * p_curve->p1.x;
+    p_x->b = 3.0f * (p_curve->p2.x - p_curve->p1.x) - p_x->c;
+    p_x->a = 1.0f - p_x->c - p_x->b;
+
+    p_y->c = 3.0f * p_curve->p1.y;
+    p_y->b = 3.0f * (p_curve->p2.y - p_curve->p1.y) - p_y->c;
+    p_y->a = 1.0f - p_y->c - p_y->b;
+}
+
+/**
+ * @private
+ * Calculates one axis of a cubic bezier curve at interpolation index, t.
+ * @param[in] p_coeffs Pointer to the prepared coefficients of the axis.
+ * @param     t        Interpolation index; 0 <= t <= 1.
+ * @return The coordinate on the axis.
+ */
+static inline float cubic_bezier_calc(cubic_coeffs_t const * p_coeffs, float t)
+{
+    return ((p_coeffs->a * t + p_coeffs->b) * t + p_coeffs->c) * t;
+}
+
+/**
+ * Finds the y coordinate of a cubic bezier curve at an x coordinate.
+ * The curve is solved for t with a fixed maximum number of iterations so the cost does not depend on x.
+ * @param[in] p_x Pointer to the prepared x axis; the x coordinates of the control points must be within [0, 1].
+ * @param[in] p_y Pointer to the prepared y axis.
+ * @param     x   The x coordinate, within [0, 1].
+ * @return The y coordinate.
  */
-static void cubic_bezier_calc(cubic_bezier_t const * const p_curve, float t, point_t * p_point)
+static float cubic_bezier_solve(cubic_coeffs_t const * p_x, cubic_coeffs_t const * p_y, float x)
 {
-    // Calculate the coefficients first because they have to be used twice.
-    float t_ = 1.0f - t;
+    // Newton-Raphson from t = x converges quickly where the curve is not flat in x.
+    float t = x;
+    for (uint8_t i = 0; i < FADE_CURVE_NEWTON_STEPS; i++)
+    {
+        const float error = cubic_bezier_calc(p_x, t) - x;
+        if (fabsf(error) < FADE_CURVE_EPSILON)
+        {
+            return cubic_bezier_calc(p_y, t);
+        }
+
+        // Derivative of x with respect to t.
+        const float dx = (3.0f * p_x->a * t + 2.0f * p_x->b) * t + p_x->c;
+        if (fabsf(dx) < FADE_CURVE_EPSILON)
+        {
+            break;
+        }
+        t -= error / dx;
+    }
+
+    // Otherwise bisect; x increases with t because the control points are within [0, 1].
+    float low = 0.0f;
+    float high = 1.0f;
+    t = x;
+    for (uint8_t i = 0; i < FADE_CURVE_BISECT_STEPS; i++)
+    {
+        const float x_t = cubic_bezier_calc(p_x, t);
+        if (fabsf(x_t - x) < FADE_CURVE_EPSILON)
+        {
+            return cubic_bezier_calc(p_y, t);
+        }
 
-    float a1 = 3.0f * t_ * t_ * t;
-    float a2 = 3.0f * t_ * t * t;
-    float a3 = t * t * t;
+        if (x_t < x)
+        {
+            low = t;
+        }
+        else
+        {
+            high = t;
+        }
+        t = (low + high) / 2.0f;
+    }
 
-    p_point->x = a1 * p_curve->p1.x + a2 * p_curve->p2.x + a3;
-    p_point->y = a1 * p_curve->p1.y + a2 * p_curve->p2.y + a3;
+    return cubic_bezier_calc(p_y, t);
 }
 
 /**
@@ -283,11 +435,10 @@ keyframe_base_t * keyframe_fade_parse(char * p_str)
         return NULL;
     }
 
-    keyframe_fade_t * p_fade = (keyframe_fade_t *) keyframe_fade_ctor(NULL);
-    if (p_fade == NULL)
-    {
-        return NULL;
-    }
+    // Parse into room for the most colors, then keep only the colors which were parsed.
+    keyframe_fade_args_storage_t parsed;
+    keyframe_fade_args_t * const p_args = &parsed.args;
+    memcpy(p_args, &keyframe_fade_args_init, sizeof(*p_args));
 
     bool has_error = true;
     do
@@ -309,7 +460,7 @@ keyframe_base_t * keyframe_fade_parse(char * p_str)
             // It is also set to zero on parse failure.
             break;
         }
-        p_fade->args.period = period;
+        p_args->period = period;
 
         if ((p_tok = strtok_r(NULL, " ", &p_context)) == NULL)
         {
@@ -321,34 +472,60 @@ keyframe_base_t * keyframe_fade_parse(char * p_str)
         if (*p_tok == '&')
         {
             // Special case to push the current color onto the stack.
-            p_fade->args.push_current = true;
+            p_args->push_current = true;
             // Increment to skip the ampersand.
             p_tok++;
         }
 
-        // Split the color list by ':'
-        char * p_color_context = NULL;
-        char * p_color_tok = strtok_r(p_tok, ":", &p_color_context);
+        // Walk the color list, separated by ':', in place.
+        char const * p_colors = p_tok;
+        size_t colors_remaining = strlen(p_tok);
         bool color_error = false;
-        while (p_color_tok != NULL)
+        while (true)
         {
-            color_t color, hsv;
-            if (!color_parse(p_color_tok, &color))
+            if (p_args->colors_len == KEYFRAME_FADE_COLORS_INPUT_MAX_LENGTH)
             {
-                // Color parsing failed!
+                // Too many colors in the list
                 color_error = true;
                 break;
             }
-            // else: Add the color to the list
-            color_convert(COLOR_SPACE_HSV, &color, &hsv);
-            if (p_fade->args.colors_len == KEYFRAME_FADE_COLORS_INPUT_MAX_LENGTH)
+
+            // Palette entries already have an HSV form, so use it directly.
+            palette_entry_t const * p_entry;
+            size_t consumed = palette_parse_n(p_colors, colors_remaining, &p_entry);
+            if (consumed != 0)
+            {
+                p_args->colors[p_args->colors_len++] = p_entry->hsv;
+            }
+            else
             {
-                // Too many colors in the list
+                color_t color, hsv;
+                consumed = color_parse_n(p_colors, colors_remaining, &color);
+                if (consumed == 0)
+                {
+                    // Color parsing failed!
+                    color_error = true;
+                    break;
+                }
+                // else: Add the color to the list
+                color_convert(COLOR_SPACE_HSV, &color, &hsv);
+                p_args->colors[p_args->colors_len++] = hsv.hsv;
+            }
+
+            p_colors += consumed;
+            colors_remaining -= consumed;
+            if (colors_remaining == 0)
+            {
+                break;
+            }
+            if (*p_colors != ':')
+            {
+                // Unexpected characters after the color.
                 color_error = true;
                 break;
             }
-            p_fade->args.colors[p_fade->args.colors_len++] = hsv.hsv;
-            p_color_tok = strtok_r(NULL, ":", &p_color_context);
+            p_colors++;
+            colors_remaining--;
         }
 
         // Exit parsing if an error occurred while parsing the colors.
@@ -367,30 +544,30 @@ keyframe_base_t * keyframe_fade_parse(char * p_str)
 
         if (strcmp(p_tok, "step") == 0)
         {
-            p_fade->args.fade_type = FADE_TYPE_STEP;
+            p_args->fade_type = FADE_TYPE_STEP;
         }
         else
         {
-            p_fade->args.fade_type = FADE_TYPE_CUBIC;
+            p_args->fade_type = FADE_TYPE_CUBIC;
             if (strcmp(p_tok, "linear") == 0)
             {
-                p_fade->args.curve = cb_linear;
+                p_args->curve = cb_linear;
             }
             else if (strcmp(p_tok, "ease") == 0)
             {
-                p_fade->args.curve = cb_ease;
+                p_args->curve = cb_ease;
             }
             else if (strcmp(p_tok, "ease-in") == 0)
             {
-                p_fade->args.curve = cb_ease_in;
+                p_args->curve = cb_ease_in;
             }
             else if (strcmp(p_tok, "ease-out") == 0)
             {
-                p_fade->args.curve = cb_ease_out;
+                p_args->curve = cb_ease_out;
             }
             else if (strcmp(p_tok, "ease-in-out") == 0)
             {
-                p_fade->args.curve = cb_ease_in_out;
+                p_args->curve = cb_ease_in_out;
             }
             else if (memcmp(p_tok, "cubic(", 6) == 0)
             {
@@ -414,7 +591,7 @@ keyframe_base_t * keyframe_fade_parse(char * p_str)
                     break;
                 }
                 float coord = strtof(p_tok, NULL);
-                p_fade->args.curve.p1.x = coord;
+                p_args->curve.p1.x = coord;
 
                 // Grab P1.Y
                 p_point_tok = strtok(NULL, ",");
@@ -424,7 +601,7 @@ keyframe_base_t * keyframe_fade_parse(char * p_str)
                     break;
                 }
                 coord = strtof(p_tok, NULL);
-                p_fade->args.curve.p1.y = coord;
+                p_args->curve.p1.y = coord;
 
                 // Grab P2.X
                 p_point_tok = strtok(NULL, ",");
@@ -434,7 +611,7 @@ keyframe_base_t * keyframe_fade_parse(char * p_str)
                     break;
                 }
                 coord = strtof(p_tok, NULL);
-                p_fade->args.curve.p2.x = coord;
+                p_args->curve.p2.x = coord;
 
                 // Grab P2.Y
                 p_point_tok = strtok(NULL, ",");
@@ -444,7 +621,7 @@ keyframe_base_t * keyframe_fade_parse(char * p_str)
                     break;
                 }
                 coord = strtof(p_tok, NULL);
-                p_fade->args.curve.p2.y = coord;
+                p_args->curve.p2.y = coord;
 
                 // Make sure we are at the end of the list.
                 if (strtok(NULL, ",") != NULL)
@@ -473,27 +650,68 @@ keyframe_base_t * keyframe_fade_parse(char * p_str)
     
     if (has_error)
     {
-        // Cleanup on error.
-        free(p_fade);
         return NULL;
     }
-    else
+
+    // Clones share the lowered arguments and only prepare the current color.
+    keyframe_fade_lower(p_args);
+
+    keyframe_fade_args_t * const p_shared = keyframe_fade_args_alloc(p_args->colors_len);
+    if (p_shared == NULL)
+    {
+        return NULL;
+    }
+
+    // The parsed arguments hold a single reference, which the keyframe adopts to free the block with its last clone.
+    memcpy(p_shared, p_args, KEYFRAME_FADE_ARGS_SIZE(p_args->colors_len));
+    keyframe_base_t * const p_fade = keyframe_fade_ctor(NULL, p_shared, true);
+    if (p_fade == NULL)
+    {
+        keyframe_free(p_shared);
+        return NULL;
+    }
+
+    return p_fade;
+}
+
+/**
+ * Allocate fade arguments from the smallest pool block with room for a number of colors, initialized to the
+ * defaults with a single reference for a keyframe to adopt with @ref keyframe_fade_ctor.
+ * @param colors_len Number of colors, including the current color if it will be pushed.
+ * @return Pointer to the arguments or NULL if none are available.
+ */
+keyframe_fade_args_t * keyframe_fade_args_alloc(uint8_t colors_len)
+{
+    const keyframe_pool_t pool = (colors_len <= KEYFRAME_FADE_COLORS_SHORT_LENGTH) ?
+                                 KEYFRAME_POOL_FADE_ARGS_SHORT : KEYFRAME_POOL_FADE_ARGS;
+    keyframe_fade_args_t * const p_args = keyframe_pool_alloc(pool);
+    if (p_args != NULL)
     {
-        return &p_fade->base;
+        memcpy(p_args, &keyframe_fade_args_init, sizeof(*p_args));
     }
+
+    return p_args;
 }
 
 /**
- * Initialize a Fade keyframe with the appropriate keyframe_base_t and state values.
+ * Initialize a Fade keyframe with the appropriate keyframe_base_t, arguments, and state values.
  * @param[in] p_fade Pointer to the fade keyframe to construct, or NULL to allocate a new one.
- * @return Pointer to the keyframe base portion of the fade keyframe.
+ * @param[in] p_args Pointer to the arguments, with room for the colors that will be set such as a
+ *                   @ref keyframe_fade_args_storage_t, or NULL to allocate room for the most colors.
+ * @param[in] adopt  true if p_args are already filled from a pool block and hold the single reference the keyframe
+ *                   takes over, so the last clone frees them. false to initialize p_args to the defaults with a
+ *                   second reference held by the caller, so destroying the keyframe and its clones never frees them.
+ *                   Ignored if p_args is NULL.
+ * @return Pointer to the keyframe base portion of the fade keyframe or NULL if it could not be allocated, in which
+ *         case adopted arguments are left to the caller.
  */
-keyframe_base_t * keyframe_fade_ctor(keyframe_fade_t * p_fade)
+keyframe_base_t * keyframe_fade_ctor(keyframe_fade_t * p_fade, keyframe_fade_args_t * p_args, bool adopt)
 {
-    // If NULL, allocate a new set keyframe.
-    if (p_fade == NULL)
+    // If NULL, allocate a new fade keyframe.
+    const bool allocated = (p_fade == NULL);
+    if (allocated)
     {
-        p_fade = malloc(sizeof(keyframe_fade_t));
+        p_fade = keyframe_alloc(sizeof(keyframe_fade_t));
         if (p_fade == NULL)
         {
             return NULL;
@@ -508,6 +726,31 @@ keyframe_base_t * keyframe_fade_ctor(keyframe_fade_t * p_fade)
         // Zero out the state
         memset(&p_fade->state, 0, sizeof(p_fade->state));
     }
+
+    // If NULL, allocate new arguments for the keyframe to own.
+    const bool args_allocated = (p_args == NULL);
+    if (args_allocated)
+    {
+        p_args = keyframe_pool_alloc(KEYFRAME_POOL_FADE_ARGS);
+        if (p_args == NULL)
+        {
+            if (allocated)
+            {
+                keyframe_free(p_fade);
+            }
+            return NULL;
+        }
+    }
+    if (args_allocated || !adopt)
+    {
+        memcpy(p_args, &keyframe_fade_args_init, sizeof(*p_args));
+        if (!args_allocated)
+        {
+            p_args->refs++;
+        }
+    }
+    p_fade->p_args = p_args;
+
     return &p_fade->base;
 }
 
@@ -24,6 +24,11 @@
  */
 #define KEYFRAME_FADE_COLORS_MAX_LENGTH  (KEYFRAME_FADE_COLORS_INPUT_MAX_LENGTH + 1)
 
+/** Number of colors, including the current color, kept in the short fade arguments size class. */
+#ifndef KEYFRAME_FADE_COLORS_SHORT_LENGTH
+#define KEYFRAME_FADE_COLORS_SHORT_LENGTH (4)
+#endif
+
 
 /**  
  * The type of fade to perform.
@@ -63,32 +68,72 @@ typedef struct st_cubic_bezier
     point_t p2; ///< Second control point, to (1,1).
 } cubic_bezier_t;
 
+/**
+ * Polynomial coefficients of one axis of a @ref cubic_bezier_t, prepared for evaluation.
+ * The axis at interpolation index t is @f$ ((a t + b) t + c) t @f$.
+ */
+typedef struct st_cubic_coeffs
+{
+    float a; ///< Coefficient of t cubed.
+    float b; ///< Coefficient of t squared.
+    float c; ///< Coefficient of t.
+} cubic_coeffs_t;
+
+/**
+ * Arguments of a fade keyframe, shared by every clone of the parsed keyframe.
+ * The arguments are read-only once they are lowered into render-ready form. Lowering also makes room for the current
+ * color at the start of the colors when it is pushed, and sets push_current if it is; each clone renders its own
+ * current color in that slot. Parsed arguments are allocated with room for only their colors; see
+ * @ref KEYFRAME_FADE_ARGS_SIZE.
+ */
+typedef struct st_keyframe_fade_args
+{
+    /**
+     * Number of fade keyframes sharing the arguments; they are returned to their pool when this reaches 0.
+     * Arguments not allocated from a pool hold a reference for their owner so they are never freed.
+     */
+    uint16_t       refs;
+    bool           lowered;      ///< The arguments are in render-ready form; see @ref KEYFRAME_FLAG_LOWERED.
+    float          period;       ///< Number of seconds to fade over; max of 60 seconds.
+    fade_type_t    fade_type;    ///< The type of transition to perform.
+    cubic_bezier_t curve;        ///< The cubic bezier curve points for non-step transitions.
+    bool           push_current; ///< Push the current color to be the first.
+    uint8_t        colors_len;   ///< Number of colors provided.
+    fade_axis_t    fade_axis;    ///< Which axis of the colors, other than the current color, need to be faded.
+    timestep_t     pair_period;  ///< The period to transition between each pair of colors.
+    timestep_t     finish_time;  ///< Total time for this keyframe.
+    cubic_coeffs_t curve_x;      ///< Prepared x axis of the curve.
+    cubic_coeffs_t curve_y;      ///< Prepared y axis of the curve.
+    bool           curve_linear; ///< The curve is a straight line so its y is its x; it is not solved.
+    color_hsv_t    colors[];     ///< Array of colors provided by the user.
+} keyframe_fade_args_t;
+
+/** Size of fade arguments with room for a number of colors. */
+#define KEYFRAME_FADE_ARGS_SIZE(colors_len) (sizeof(keyframe_fade_args_t) + (size_t) (colors_len) * sizeof(color_hsv_t))
+
+/** Storage for fade arguments with room for the most colors; used to build and parse fade keyframes. */
+typedef union u_keyframe_fade_args_storage
+{
+    keyframe_fade_args_t args;                                      ///< The arguments.
+    uint8_t mem[KEYFRAME_FADE_ARGS_SIZE(KEYFRAME_FADE_COLORS_MAX_LENGTH)]; ///< Room for the colors.
+} keyframe_fade_args_storage_t;
+
 /**
  * Fade keyframe.
+ * Clones share the arguments of the keyframe they were cloned from and only keep the state set when they are
+ * initialized.
  */
 typedef struct st_keyframe_fade
 {
     /** Keyframe base; MUST be the first entry in the struct. */
     keyframe_base_t base;
-    /** Parsed arguments. */
-    struct
-    {
-        float          period;       ///< Number of seconds to fade over; max of 60 seconds.
-        fade_type_t    fade_type;    ///< The type of transition to perform.
-        cubic_bezier_t curve;        ///< The cubic bezier curve points for non-step transitions.
-        bool           push_current; ///< Push the current color to be the first.
-        uint8_t        colors_len;   ///< Number of colors provided.
-        color_hsv_t    colors[KEYFRAME_FADE_COLORS_MAX_LENGTH]; ///< Array of colors provided by the user.
-    } args;
-    /** Keyframe render state. */
+    /** Pointer to the shared arguments. */
+    keyframe_fade_args_t * p_args;
+    /** Keyframe render state; set by @ref keyframe_base_api_t::render_init. */
     struct
     {
-        fade_axis_t fade_axis;   ///< Which axis of the colors need to be faded.
-        timestep_t  pair_period; ///< The period to transition between each pair of colors.
-        timestep_t  finish_time; ///< Total number of frames for this keyframe at the current framerate.
-        uint8_t     pair_index;  ///< Index of the first color of the currently transitioning pair.
-        point_t     curr_b_info; ///< The current bezier point to render.
-        framerate_t framerate;   ///< Framerate currently being used.
+        color_hsv_t current;   ///< Current color; the first color when push_current is set.
+        fade_axis_t fade_axis; ///< Which axis of the colors, including the current color, need to be faded.
     } state;
 } keyframe_fade_t;
 
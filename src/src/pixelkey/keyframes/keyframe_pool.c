@@ -0,0 +1,256 @@
+/**
+ * @file
+ * @defgroup pixelkey__keyframes__pool__internals Keyframe Pool Internals
+ * @ingroup pixelkey__keyframes__pool
+ * @{
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <assert.h>
+
+#include "keyframes.h"
+#include "keyframe_pool.h"
+
+/** Block size of a size class; rounded up so every block is aligned for any keyframe type. */
+#define POOL_BLOCK_SIZE(size)   (((size) + _Alignof(max_align_t) - 1U) & ~(_Alignof(max_align_t) - 1U))
+
+static_assert(KEYFRAME_POOL_KEYFRAME_COUNT >= PIXELKEY_NEOPIXEL_COUNT_MAX,
+              "Every NeoPixel must be able to hold a keyframe of any type.");
+
+/** Free or reclaimed block; the link is stored in the block itself. */
+typedef struct st_pool_block
+{
+    struct st_pool_block * p_next; ///< Next block in the list.
+} pool_block_t;
+
+/** Pool control struct. */
+typedef struct st_pool
+{
+    uint8_t * const        p_mem;       ///< Pointer to the block storage.
+    const size_t           block_size;  ///< Size of each block in bytes.
+    const uint16_t         block_count; ///< Number of blocks in the storage.
+    uint16_t               untouched;   ///< Index of the first block which has never been allocated.
+    pool_block_t *         p_free;      ///< Blocks which have been released.
+    keyframe_pool_stats_t  stats;       ///< Occupancy statistics.
+} pool_t;
+
+// Define the block storage for each size class.
+#define XPOOL(pool,size,count) \
+    static_assert((count) > 0U && (count) <= UINT16_MAX, "Pool " #pool " must have 1 to UINT16_MAX blocks."); \
+    static _Alignas(max_align_t) uint8_t pool_mem_ ## pool[(count) * POOL_BLOCK_SIZE(size)];
+KEYFRAME_POOL_LIST
+#undef XPOOL
+
+// Make the pool list.
+#define XPOOL(pool,size,count) \
+    [KEYFRAME_POOL_ ## pool] = \
+    { \
+        .p_mem = pool_mem_ ## pool, \
+        .block_size = POOL_BLOCK_SIZE(size), \
+        .block_count = (uint16_t) (count), \
+        .stats = { .name = #pool, .block_size = POOL_BLOCK_SIZE(size), .block_count = (uint16_t) (count) }, \
+    },
+static pool_t pools[KEYFRAME_POOL_COUNT] =
+{
+    KEYFRAME_POOL_LIST
+};
+#undef XPOOL
+
+/** Keyframes waiting to be returned to their pools by @ref keyframe_reclaim. */
+static pool_block_t * p_reclaim = NULL;
+
+/**
+ * Finds the pool which owns a block.
+ * @param[in] p_block Pointer to the block.
+ * @return Pointer to the owning pool or NULL if the block is not from a pool.
+ */
+static pool_t * pool_find(void const * p_block)
+{
+    uint8_t const * const p = p_block;
+    for (size_t i = 0; i < KEYFRAME_POOL_COUNT; i++)
+    {
+        pool_t * p_pool = &pools[i];
+        if (p >= p_pool->p_mem && p < p_pool->p_mem + (size_t) p_pool->block_count * p_pool->block_size)
+        {
+            return p_pool;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Returns a block to its pool.
+ * @param[in] p_pool  Pointer to the owning pool.
+ * @param[in] p_block Pointer to the block.
+ */
+static inline void pool_release(pool_t * p_pool, pool_block_t * p_block)
+{
+    p_block->p_next = p_pool->p_free;
+    p_pool->p_free = p_block;
+    p_pool->stats.in_use--;
+}
+
+/**
+ * Allocates a block from a pool.
+ * @param[in] p_pool Pointer to the pool.
+ * @return Pointer to the uninitialized block or NULL if the pool is full.
+ */
+static void * pool_alloc(pool_t * p_pool)
+{
+    void * p_block;
+    if (p_pool->p_free != NULL)
+    {
+        p_block = p_pool->p_free;
+        p_pool->p_free = p_pool->p_free->p_next;
+    }
+    else if (p_pool->untouched < p_pool->block_count)
+    {
+        p_block = &p_pool->p_mem[(size_t) p_pool->untouched * p_pool->block_size];
+        p_pool->untouched++;
+    }
+    else
+    {
+        p_pool->stats.failures++;
+        return NULL;
+    }
+
+    p_pool->stats.in_use++;
+    if (p_pool->stats.in_use > p_pool->stats.high_water)
+    {
+        p_pool->stats.high_water = p_pool->stats.in_use;
+    }
+
+    return p_block;
+}
+
+/**
+ * Allocates a keyframe from the keyframe size class.
+ * @param size Size of the keyframe in bytes.
+ * @return Pointer to the uninitialized keyframe or NULL if the size class is full or the keyframe is too large.
+ */
+void * keyframe_alloc(size_t size)
+{
+    if (size > pools[KEYFRAME_POOL_KEYFRAME].block_size)
+    {
+        return NULL;
+    }
+
+    return pool_alloc(&pools[KEYFRAME_POOL_KEYFRAME]);
+}
+
+/**
+ * Allocates a block from a size class.
+ * @param pool The size class.
+ * @return Pointer to the uninitialized block or NULL if the size class is full.
+ */
+void * keyframe_pool_alloc(keyframe_pool_t pool)
+{
+    return pool_alloc(&pools[pool]);
+}
+
+/**
+ * Immediately returns a keyframe to its pool.
+ * @param[in] p_keyframe Pointer to the keyframe; NULL is ignored.
+ */
+void keyframe_free(void * p_keyframe)
+{
+    if (p_keyframe == NULL)
+    {
+        return;
+    }
+
+    pool_t * const p_pool = pool_find(p_keyframe);
+    assert(p_pool != NULL);
+    if (p_pool != NULL)
+    {
+        pool_release(p_pool, p_keyframe);
+    }
+}
+
+/**
+ * Queues a keyframe to be returned to its pool by the next @ref keyframe_reclaim.
+ * This is used from the render path so that it only does the minimum amount of work.
+ * @param[in] p_keyframe Pointer to the keyframe; NULL is ignored.
+ */
+void keyframe_free_deferred(void * p_keyframe)
+{
+    if (p_keyframe == NULL)
+    {
+        return;
+    }
+
+    pool_block_t * const p_block = p_keyframe;
+    p_block->p_next = p_reclaim;
+    p_reclaim = p_block;
+}
+
+/**
+ * Immediately returns a keyframe, and the blocks it holds, to their pools.
+ * @param[in] p_keyframe Pointer to the keyframe; NULL is ignored.
+ */
+void keyframe_destroy(keyframe_base_t * p_keyframe)
+{
+    if (p_keyframe == NULL)
+    {
+        return;
+    }
+
+    if (p_keyframe->p_api->release != NULL)
+    {
+        p_keyframe->p_api->release(p_keyframe, false);
+    }
+    keyframe_free(p_keyframe);
+}
+
+/**
+ * Queues a keyframe, and the blocks it holds, to be returned to their pools by the next @ref keyframe_reclaim.
+ * @param[in] p_keyframe Pointer to the keyframe; NULL is ignored.
+ */
+void keyframe_destroy_deferred(keyframe_base_t * p_keyframe)
+{
+    if (p_keyframe == NULL)
+    {
+        return;
+    }
+
+    if (p_keyframe->p_api->release != NULL)
+    {
+        p_keyframe->p_api->release(p_keyframe, true);
+    }
+    keyframe_free_deferred(p_keyframe);
+}
+
+/**
+ * Returns all keyframes queued by @ref keyframe_free_deferred to their pools; should be called when idle.
+ */
+void keyframe_reclaim(void)
+{
+    while (p_reclaim != NULL)
+    {
+        pool_block_t * const p_block = p_reclaim;
+        p_reclaim = p_block->p_next;
+
+        pool_t * const p_pool = pool_find(p_block);
+        assert(p_pool != NULL);
+        if (p_pool != NULL)
+        {
+            pool_release(p_pool, p_block);
+        }
+    }
+}
+
+/**
+ * Gets the occupancy statistics of a pool.
+ * @param      pool    The size class.
+ * @param[out] p_stats Pointer to store the statistics.
+ */
+void keyframe_pool_stats_get(keyframe_pool_t pool, keyframe_pool_stats_t * p_stats)
+{
+    *p_stats = pools[pool].stats;
+}
+
+/** @} */
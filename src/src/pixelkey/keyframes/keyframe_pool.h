@@ -0,0 +1,105 @@
+#ifndef KEYFRAME_POOL_H
+#define KEYFRAME_POOL_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "hal_device.h"
+#include "keyframes.h"
+
+/**
+ * @file
+ * @defgroup pixelkey__keyframes__pool Keyframe Pool
+ * @ingroup pixelkey__keyframes
+ * Fixed-size block allocator for keyframes.
+ *
+ * Keyframes are allocated from statically sized pools, one per size class, instead of the heap. Allocation and
+ * release are O(1) and the pools cannot fragment. Every keyframe type shares one size class, so its capacity is not
+ * split between types and any type may be sent to every NeoPixel. Keyframes released while rendering are placed on a
+ * reclaim list with @ref keyframe_free_deferred and returned to their pools by @ref keyframe_reclaim from the idle loop.
+ * Keyframes which hold other blocks, such as shared arguments, are freed with @ref keyframe_destroy or
+ * @ref keyframe_destroy_deferred so those are released too.
+ * @{
+ */
+
+/**
+ * Number of keyframes each NeoPixel is expected to hold at once.
+ * The keyframe size class has this many blocks per NeoPixel so a keyframe sent to every NeoPixel always fits.
+ */
+#ifndef KEYFRAME_POOL_QUEUE_DEPTH
+#define KEYFRAME_POOL_QUEUE_DEPTH   (1U)
+#endif
+
+/**
+ * Number of blocks in the keyframe size class, shared by every keyframe type.
+ * One extra block is kept for the parsed keyframe of each queued command, which is cloned to its NeoPixels.
+ */
+#ifndef KEYFRAME_POOL_KEYFRAME_COUNT
+#define KEYFRAME_POOL_KEYFRAME_COUNT    (PIXELKEY_NEOPIXEL_COUNT_MAX * KEYFRAME_POOL_QUEUE_DEPTH + \
+                                         PIXELKEY_COMMAND_BUFFER_LENGTH)
+#endif
+
+/**
+ * Number of blocks in the short shared fade arguments size class, for up to
+ * @ref KEYFRAME_FADE_COLORS_SHORT_LENGTH colors; one is used by each parsed fade and its clones.
+ */
+#ifndef KEYFRAME_POOL_FADE_ARGS_SHORT_COUNT
+#define KEYFRAME_POOL_FADE_ARGS_SHORT_COUNT (6U)
+#endif
+
+/** Number of blocks in the shared fade arguments size class, for up to @ref KEYFRAME_FADE_COLORS_MAX_LENGTH colors. */
+#ifndef KEYFRAME_POOL_FADE_ARGS_COUNT
+#define KEYFRAME_POOL_FADE_ARGS_COUNT       (2U)
+#endif
+
+/** Larger of two sizes; usable in constant expressions. */
+#define KEYFRAME_POOL_SIZE_MAX(a, b)    (((a) > (b)) ? (a) : (b))
+
+/** Size of the largest keyframe type. */
+#define KEYFRAME_POOL_KEYFRAME_SIZE \
+    KEYFRAME_POOL_SIZE_MAX(sizeof(keyframe_set_t), KEYFRAME_POOL_SIZE_MAX(sizeof(keyframe_blink_t), sizeof(keyframe_fade_t)))
+
+/**
+ * XPOOL(pool,size,count) for defining the pool size classes.
+ * @note Keyframes of any type are allocated from the KEYFRAME class with @ref keyframe_alloc; the other classes hold
+ *       blocks owned by keyframes and are allocated from with @ref keyframe_pool_alloc.
+ */
+#define KEYFRAME_POOL_LIST \
+    XPOOL(KEYFRAME, KEYFRAME_POOL_KEYFRAME_SIZE, KEYFRAME_POOL_KEYFRAME_COUNT) \
+    XPOOL(FADE_ARGS_SHORT, KEYFRAME_FADE_ARGS_SIZE(KEYFRAME_FADE_COLORS_SHORT_LENGTH), KEYFRAME_POOL_FADE_ARGS_SHORT_COUNT) \
+    XPOOL(FADE_ARGS, KEYFRAME_FADE_ARGS_SIZE(KEYFRAME_FADE_COLORS_MAX_LENGTH), KEYFRAME_POOL_FADE_ARGS_COUNT) \
+
+
+#define XPOOL(pool,size,count)  KEYFRAME_POOL_ ## pool /*!< Size class for pool. */,
+/** Keyframe pool size classes. */
+typedef enum e_keyframe_pool
+{
+    KEYFRAME_POOL_LIST
+    KEYFRAME_POOL_COUNT,    ///< Number of size classes.
+} keyframe_pool_t;
+#undef XPOOL
+
+/** Occupancy statistics for a single pool. */
+typedef struct st_keyframe_pool_stats
+{
+    char const * name;        ///< Name of the size class.
+    size_t       block_size;  ///< Size of each block in bytes.
+    uint16_t     block_count; ///< Total number of blocks.
+    uint16_t     in_use;      ///< Blocks currently allocated, including those waiting to be reclaimed.
+    uint16_t     high_water;  ///< Largest value of in_use since startup.
+    uint32_t     failures;    ///< Allocations rejected because the pool was full.
+} keyframe_pool_stats_t;
+
+void * keyframe_alloc(size_t size);
+void * keyframe_pool_alloc(keyframe_pool_t pool);
+void keyframe_free(void * p_keyframe);
+void keyframe_free_deferred(void * p_keyframe);
+void keyframe_destroy(keyframe_base_t * p_keyframe);
+void keyframe_destroy_deferred(keyframe_base_t * p_keyframe);
+void keyframe_reclaim(void);
+void keyframe_pool_stats_get(keyframe_pool_t pool, keyframe_pool_stats_t * p_stats);
+
+/** @} */
+
+#endif // KEYFRAME_POOL_H
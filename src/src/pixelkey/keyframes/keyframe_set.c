@@ -5,6 +5,7 @@
 
 #include "pixelkey.h"
 #include "keyframes.h"
+#include "keyframe_pool.h"
 
 /**
  * @addtogroup pixelkey__keyframes__set
@@ -12,12 +13,14 @@
 */
 
 static bool keyframe_set_render_frame(keyframe_base_t * const p_keyframe, timestep_t time, color_rgb_t * p_color_out);
-static void keyframe_set_render_init(keyframe_base_t * const p_keyframe, framerate_t framerate, color_rgb_t current_color);
+static bool keyframe_set_render_span(keyframe_base_t * const p_keyframe, timestep_t time, uint16_t first_index, uint16_t count, color_rgb_t * p_colors_out);
+static void keyframe_set_render_init(keyframe_base_t * const p_keyframe, color_rgb_t current_color);
 static keyframe_base_t * keyframe_set_clone(keyframe_base_t const * const p_keyframe);
 
 static const keyframe_base_api_t keyframe_set_api =
 {
     .render_frame = keyframe_set_render_frame,
+    .render_span = keyframe_set_render_span,
     .render_init = keyframe_set_render_init,
     .clone = keyframe_set_clone,
 };
@@ -40,13 +43,29 @@ static bool keyframe_set_render_frame(keyframe_base_t * const p_keyframe, timest
     return true;   // No frames remaining.
 }
 
-static void keyframe_set_render_init(keyframe_base_t * const p_keyframe, framerate_t framerate, color_rgb_t current_color)
+static bool keyframe_set_render_span(keyframe_base_t * const p_keyframe, timestep_t time, uint16_t first_index, uint16_t count, color_rgb_t * p_colors_out)
 {
-    ARG_NOT_USED(framerate);
-    ARG_NOT_USED(current_color);
+    // Every NeoPixel gets the same color.
+    ARG_NOT_USED(time);
+    ARG_NOT_USED(first_index);
 
-    // Make sure the color is in RGB.
     keyframe_set_t * const p_set = (keyframe_set_t * const) p_keyframe;
+
+    const color_rgb_t color = p_set->args.color.rgb;
+    for (uint16_t i = 0; i < count; i++)
+    {
+        p_colors_out[i] = color;
+    }
+
+    return true;   // No frames remaining.
+}
+
+/**
+ * Lowers the arguments of a set keyframe into render-ready form: an RGB color.
+ * @param[in,out] p_set Pointer to the keyframe.
+ */
+static void keyframe_set_lower(keyframe_set_t * const p_set)
+{
     if (p_set->args.color.color_space != COLOR_SPACE_RGB)
     {
         color_t color_rgb;
@@ -56,13 +75,26 @@ static void keyframe_set_render_init(keyframe_base_t * const p_keyframe, framera
         p_set->args.color = color_rgb;
     }
 
+    p_set->base.flags |= KEYFRAME_FLAG_LOWERED;
+}
+
+static void keyframe_set_render_init(keyframe_base_t * const p_keyframe, color_rgb_t current_color)
+{
+    ARG_NOT_USED(current_color);
+
+    keyframe_set_t * const p_set = (keyframe_set_t * const) p_keyframe;
+    if (!(p_set->base.flags & KEYFRAME_FLAG_LOWERED))
+    {
+        keyframe_set_lower(p_set);
+    }
+
     return;
 }
 
 static keyframe_base_t * keyframe_set_clone(keyframe_base_t const * const p_keyframe)
 {
     // Allocate a new keyframe and copy the values over.
-    keyframe_set_t * p_set = malloc(sizeof(keyframe_set_t));
+    keyframe_set_t * p_set = keyframe_alloc(sizeof(keyframe_set_t));
     if (p_set == NULL)
     {
         return NULL;
@@ -85,7 +117,7 @@ keyframe_base_t * keyframe_set_parse(char * p_str)
     }
 
     // Allocate a new keyframe and copy the default values.
-    keyframe_set_t * p_set = malloc(sizeof(keyframe_set_t));
+    keyframe_set_t * p_set = keyframe_alloc(sizeof(keyframe_set_t));
     if (p_set == NULL)
     {
         return NULL;
@@ -116,11 +148,13 @@ keyframe_base_t * keyframe_set_parse(char * p_str)
     if (has_error)
     {
         // Cleanup on error.
-        free(p_set);
+        keyframe_free(p_set);
         return NULL;
     }
     else
     {
+        // Clones then render without converting the color.
+        keyframe_set_lower(p_set);
         return &p_set->base;
     }
 }
@@ -135,7 +169,11 @@ keyframe_base_t * keyframe_set_ctor(keyframe_set_t * p_set)
     // If NULL, allocate a new set keyframe.
     if (p_set == NULL)
     {
-        p_set = malloc(sizeof(keyframe_set_t));
+        p_set = keyframe_alloc(sizeof(keyframe_set_t));
+        if (p_set == NULL)
+        {
+            return NULL;
+        }
     }
 
     // Copy the base struct info (yes some of these fields are marked const... Just do it.)
@@ -0,0 +1,191 @@
+/**
+ * @file
+ * @defgroup pixelkey__keyframes__timeline__internals Keyframe Timeline Internals
+ * @ingroup pixelkey__keyframes__timeline
+ * @{
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include "keyframes.h"
+#include "keyframe_timeline.h"
+
+static_assert(KEYFRAME_TIMELINE_LENGTH > 0U && KEYFRAME_TIMELINE_LENGTH < UINT16_MAX,
+              "The timeline must have 1 to UINT16_MAX - 1 entries.");
+
+/** Marks @ref timeline_last as not pointing at an entry. */
+#define TIMELINE_LAST_NONE  (UINT16_MAX)
+
+/** Heap storage; entry 0 is the next activation and the children of entry n are 2n + 1 and 2n + 2. */
+static keyframe_activation_t timeline[KEYFRAME_TIMELINE_LENGTH];
+
+/** Number of entries in the heap. */
+static uint16_t timeline_count = 0;
+
+/** Heap position of the most recently inserted entry, or @ref TIMELINE_LAST_NONE once the heap has been popped. */
+static uint16_t timeline_last = TIMELINE_LAST_NONE;
+
+/** Insertion order of the next entry. */
+static uint32_t timeline_seq = 0;
+
+/**
+ * Checks the order of two activations.
+ * Times and sequence numbers are compared by their difference so they may wrap.
+ * @param[in] p_a Pointer to the first activation.
+ * @param[in] p_b Pointer to the second activation.
+ * @return true if p_a must be activated before p_b.
+ */
+static inline bool activation_before(keyframe_activation_t const * p_a, keyframe_activation_t const * p_b)
+{
+    const int32_t dt = (int32_t) (p_a->start - p_b->start);
+    return (dt < 0) || (dt == 0 && (int32_t) (p_a->seq - p_b->seq) < 0);
+}
+
+/**
+ * Moves an entry towards the root until its parent comes before it.
+ * @param pos Heap position of the entry.
+ * @return The new heap position of the entry.
+ */
+static uint16_t sift_up(uint16_t pos)
+{
+    const keyframe_activation_t entry = timeline[pos];
+    while (pos > 0U)
+    {
+        const uint16_t parent = (uint16_t) ((pos - 1U) / 2U);
+        if (!activation_before(&entry, &timeline[parent]))
+        {
+            break;
+        }
+        timeline[pos] = timeline[parent];
+        pos = parent;
+    }
+    timeline[pos] = entry;
+
+    return pos;
+}
+
+/**
+ * Moves an entry away from the root until it comes before both of its children.
+ * @param pos Heap position of the entry.
+ */
+static void sift_down(uint16_t pos)
+{
+    const keyframe_activation_t entry = timeline[pos];
+    for (;;)
+    {
+        uint16_t child = (uint16_t) (2U * pos + 1U);
+        if (child >= timeline_count)
+        {
+            break;
+        }
+        if (child + 1U < timeline_count && activation_before(&timeline[child + 1U], &timeline[child]))
+        {
+            child++;
+        }
+        if (!activation_before(&timeline[child], &entry))
+        {
+            break;
+        }
+        timeline[pos] = timeline[child];
+        pos = child;
+    }
+    timeline[pos] = entry;
+}
+
+/**
+ * Removes all pending activations without releasing their keyframes.
+ */
+void keyframe_timeline_clear(void)
+{
+    timeline_count = 0;
+    timeline_last = TIMELINE_LAST_NONE;
+}
+
+/**
+ * Schedules a keyframe to become the current keyframe of a NeoPixel.
+ * Activations with the same start time are made in the order they are inserted.
+ * @param     start      Frame time at or after which the keyframe becomes current.
+ * @param     index      Index of the NeoPixel.
+ * @param[in] p_keyframe Pointer to the keyframe.
+ * @return true if the activation was added, false if the timeline is full.
+ */
+bool keyframe_timeline_insert(timestep_t start, uint16_t index, keyframe_base_t * p_keyframe)
+{
+    // A broadcast keyframe pushed to the NeoPixel after the last one extends that entry.
+    if (timeline_last != TIMELINE_LAST_NONE)
+    {
+        keyframe_activation_t * const p_last = &timeline[timeline_last];
+        if (p_last->p_keyframe == p_keyframe && p_last->start == start &&
+            (uint32_t) p_last->first + p_last->count == index && p_last->count < UINT16_MAX)
+        {
+            p_last->count++;
+            return true;
+        }
+    }
+
+    if (timeline_count >= KEYFRAME_TIMELINE_LENGTH)
+    {
+        return false;
+    }
+
+    timeline[timeline_count] = (keyframe_activation_t)
+    {
+        .start = start,
+        .p_keyframe = p_keyframe,
+        .first = index,
+        .count = 1,
+        .seq = timeline_seq++,
+    };
+    timeline_last = sift_up(timeline_count++);
+
+    return true;
+}
+
+/**
+ * Removes the next activation if it is due.
+ * @param      time         The current frame time.
+ * @param[out] p_activation Pointer to store the activation; only written when one is due.
+ * @return true if an activation was due, false if there are none at or before time.
+ */
+bool keyframe_timeline_pop_due(timestep_t time, keyframe_activation_t * p_activation)
+{
+    if (timeline_count == 0 || (int32_t) (timeline[0].start - time) > 0)
+    {
+        return false;
+    }
+
+    *p_activation = timeline[0];
+    timeline[0] = timeline[--timeline_count];
+    sift_down(0);
+
+    // The last inserted entry may have moved.
+    timeline_last = TIMELINE_LAST_NONE;
+
+    return true;
+}
+
+/**
+ * Moves every pending activation by the same amount of time; their order does not change.
+ * @param offset Time to add to every start time.
+ */
+void keyframe_timeline_shift(timestep_t offset)
+{
+    for (uint16_t i = 0; i < timeline_count; i++)
+    {
+        timeline[i].start += offset;
+    }
+}
+
+/**
+ * Gets the number of pending activations.
+ * @return Number of entries in the timeline; merged broadcast activations count once.
+ */
+size_t keyframe_timeline_count(void)
+{
+    return timeline_count;
+}
+
+/** @} */
@@ -0,0 +1,51 @@
+#ifndef KEYFRAME_TIMELINE_H
+#define KEYFRAME_TIMELINE_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "keyframes.h"
+#include "keyframe_pool.h"
+
+/**
+ * @file
+ * @defgroup pixelkey__keyframes__timeline Keyframe Timeline
+ * @ingroup pixelkey__keyframes
+ * Time-ordered list of pending keyframe activations shared by all NeoPixels.
+ *
+ * Each entry makes a keyframe the current keyframe of a contiguous range of NeoPixels at a start time. Entries are
+ * kept in a binary min-heap ordered by start time, then by insertion order, so inserting and removing are O(log n)
+ * and finding the next due activation is O(1). Memory is used per queued activation rather than per NeoPixel, and a
+ * broadcast keyframe pushed to consecutive NeoPixels is merged into a single entry.
+ * @{
+ */
+
+/**
+ * Number of activations which may be pending at once, shared by all NeoPixels.
+ * Each pending activation holds a keyframe from the pool, so the pool never fills more; only a broadcast keyframe
+ * pushed to several separate ranges of NeoPixels takes more than one entry.
+ */
+#ifndef KEYFRAME_TIMELINE_LENGTH
+#define KEYFRAME_TIMELINE_LENGTH    (KEYFRAME_POOL_KEYFRAME_COUNT)
+#endif
+
+/** A keyframe waiting to become the current keyframe of a range of NeoPixels. */
+typedef struct st_keyframe_activation
+{
+    timestep_t        start;      ///< Frame time at or after which the keyframe becomes current.
+    keyframe_base_t * p_keyframe; ///< Pointer to the keyframe.
+    uint16_t          first;      ///< Index of the first NeoPixel; the processor numbers NeoPixels on each layer.
+    uint16_t          count;      ///< Number of NeoPixels; more than 1 only for broadcast keyframes.
+    uint32_t          seq;        ///< Insertion order; orders activations with the same start time.
+} keyframe_activation_t;
+
+void keyframe_timeline_clear(void);
+bool keyframe_timeline_insert(timestep_t start, uint16_t index, keyframe_base_t * p_keyframe);
+bool keyframe_timeline_pop_due(timestep_t time, keyframe_activation_t * p_activation);
+void keyframe_timeline_shift(timestep_t offset);
+size_t keyframe_timeline_count(void);
+
+/** @} */
+
+#endif // KEYFRAME_TIMELINE_H
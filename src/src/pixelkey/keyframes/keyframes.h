@@ -44,11 +44,22 @@ typedef enum e_schedule_type
 typedef enum e_keyframe_flag
 {
     KEYFRAME_FLAG_NONE = 0UL,                ///< No flags are set.
+    KEYFRAME_FLAG_LOWERED = (1UL << 28),     ///< The arguments are in render-ready form; see @ref keyframe_base_api_t::render_init.
+    KEYFRAME_FLAG_BROADCAST = (1UL << 29),   ///< The keyframe is shared by several NeoPixels; see @ref keyframe_broadcast_t.
     KEYFRAME_FLAG_INITIALIZED = (1UL << 30), ///< The keyframe has been initialized.
     KEYFRAME_FLAG_GROUP = (1UL << 31),       ///< The keyframe is a group keyframe.
 } keyframe_flag_t;
 
-/** The base unit of time for animating keyframes; resolution of 1 frame. */
+/** Number of time steps in one second. */
+#define TIMESTEP_PER_SECOND ((timestep_t) 1000000UL)
+
+/** Converts a number of seconds to time steps. */
+#define TIMESTEP_FROM_SECONDS(s)    ((timestep_t) ((s) * (float) TIMESTEP_PER_SECOND))
+
+/**
+ * The base unit of time for animating keyframes; resolution of 1 microsecond.
+ * Time steps are independent of the framerate. Clocks built from them wrap, so only differences should be compared.
+ */
 typedef uint32_t timestep_t;
 
 /** Number of frames per second. */
@@ -64,30 +75,82 @@ typedef struct st_keyframe_base_api
 {
     /**
      * Renders a keyframe for the given time step.
+     * Every render function must be seekable: the result may depend only on time and the state set by
+     * @ref keyframe_base_api_t::render_init, never on earlier renders, and take the same time to compute for any time.
+     * This lets the keyframe processor drop late frames and start scheduled keyframes partway through.
      * @param[in]  p_keyframe  Pointer to the keyframe.
-     * @param      time        Current time step for animation.
+     * @param      time        Time since the keyframe started; usually 0 for the first frame and increasing, but any
+     *                         value may be given, in any order.
      * @param[out] p_color_out Pointer to the rendered RGB color for this time step.
      * @return true if the keyframe has completed, false if more frames remain.
      */
     bool (* render_frame)(keyframe_base_t * const p_keyframe, timestep_t time, color_rgb_t * p_color_out);
 
+    /**
+     * Renders a keyframe for the given time step without converting to RGB; optional, may be NULL.
+     * Keyframes which produce HSV colors natively should provide this so the keyframe processor
+     * can convert the whole frame to RGB in a single pass.
+     * @param[in]  p_keyframe  Pointer to the keyframe.
+     * @param      time        Time since the keyframe started; see @ref keyframe_base_api_t::render_frame.
+     * @param[out] p_color_out Pointer to the rendered HSV color for this time step.
+     * @return true if the keyframe has completed, false if more frames remain.
+     */
+    bool (* render_frame_hsv)(keyframe_base_t * const p_keyframe, timestep_t time, color_hsv_t * p_color_out);
+
+    /**
+     * Renders a keyframe for the given time step across a contiguous range of NeoPixels; optional, may be NULL.
+     * The keyframe processor prefers this over the other render functions when it is provided. A broadcast keyframe
+     * is rendered with one call per contiguous run of NeoPixels it is the current keyframe of, so this may be called
+     * several times per frame with the same time step; each call must depend only on the time step and indexes.
+     * @param[in]  p_keyframe   Pointer to the keyframe.
+     * @param      time         Time since the keyframe started; see @ref keyframe_base_api_t::render_frame.
+     * @param      first_index  Index of the first NeoPixel in the range.
+     * @param      count        Number of NeoPixels in the range.
+     * @param[out] p_colors_out Pointer to count RGB colors; element 0 is the NeoPixel at first_index.
+     * @return true if the keyframe has completed, false if more frames remain.
+     */
+    bool (* render_span)(keyframe_base_t * const p_keyframe, timestep_t time, uint16_t first_index, uint16_t count,
+                         color_rgb_t * p_colors_out);
+
     /**
      * Initialize the renderer for the keyframe.
+     * This is called once, when the keyframe first becomes current; it may add the current color, so it must not be
+     * called again on the same keyframe. Parsers lower the arguments into a render-ready form and set
+     * @ref KEYFRAME_FLAG_LOWERED so this, and cloning, only copy; keyframes built without a parser are lowered here.
      * @param[in] p_keyframe    Pointer to the keyframe.
-     * @param     framerate     Framerate for keyframe rendering.
      * @param     current_color The current color being used.
      */
-    void (* render_init)(keyframe_base_t * const p_keyframe, framerate_t framerate, color_rgb_t current_color);
+    void (* render_init)(keyframe_base_t * const p_keyframe, color_rgb_t current_color);
 
     /**
-     * Create a copy of the keyframe.
+     * Prepares an initialized keyframe to render again from time 0 when it repeats; optional, may be NULL.
+     * Only keyframes with render state beyond what @ref keyframe_base_api_t::render_init sets up need this, and it
+     * must take constant time. Seekable keyframes have no such state so most types leave this NULL.
+     * @param[in] p_keyframe Pointer to the keyframe.
+     */
+    void (* render_reset)(keyframe_base_t * const p_keyframe);
+
+    /**
+     * Releases what the keyframe holds besides its own block before it is freed; optional, may be NULL.
+     * Keyframes which share their arguments drop their reference here. This must take constant time.
+     * @param[in] p_keyframe Pointer to the keyframe.
+     * @param     deferred   true to return blocks with @ref keyframe_free_deferred, as when called while rendering.
+     */
+    void (* release)(keyframe_base_t * const p_keyframe, bool deferred);
+
+    /**
+     * Create a copy of the keyframe; the copy may share the arguments of the keyframe, which must not change after.
      * @param[in] p_keyframe Pointer to the keyframe to copy.
      * @return Pointer to the cloned keyframe or NULL on failure.
      */
     keyframe_base_t * (* clone)(keyframe_base_t const * const p_keyframe);
 } keyframe_base_api_t;
 
-/** Provides scheduled time information for keyframes. */
+/**
+ * Provides scheduled time information for keyframes.
+ * A schedule is resolved to the frame time its keyframe is pushed at with @ref pixelkey_keyframeproc_push_at, so
+ * keyframes themselves do not keep it; every pool block would otherwise carry its 32 bytes.
+ */
 typedef struct st_keyframe_schedule
 {
     schedule_type_t type;           ///< Type of schedule modifier.
@@ -106,6 +169,22 @@ typedef struct st_keyframe_schedule
     };
 } keyframe_schedule_t;
 
+/**
+ * Shared render state for a broadcast keyframe.
+ *
+ * A broadcast keyframe is a single instance pushed to the queue of every targeted NeoPixel. The keyframe processor
+ * renders it once per frame and copies the result to each NeoPixel it is the current keyframe of.
+ */
+typedef struct st_keyframe_broadcast
+{
+    uint16_t    refs;     ///< Number of NeoPixel queues and owners holding the keyframe.
+    timestep_t  start;    ///< Frame time of the first render.
+    uint32_t    frame;    ///< Keyframe processor frame count of the last render.
+    color_rgb_t color;    ///< Color rendered for the last frame.
+    bool        rendered; ///< false until the first render after the keyframe is initialized.
+    bool        finished; ///< true if the last render completed the keyframe.
+} keyframe_broadcast_t;
+
 /** Base struct for all keyframe types, must be the first element in child structs. */
 struct st_keyframe_base
 {
@@ -120,10 +199,11 @@ struct st_keyframe_base
     /** Modifiers applied to this keyframe. */
     struct
     {
-        keyframe_schedule_t schedule;              ///< Schedule times for this keyframe.
-        int32_t             repeat_count;          ///< Total number of times to render the keyframe; negative is indefinite.
-        bool                schedule_is_repeating; ///< Indicates the schedule should repeat instead of the frame.
+        int32_t repeat_count; ///< Total number of times to render the keyframe; negative is indefinite.
+        uint8_t layer;        ///< Layer the keyframe is rendered on; 0 is the bottom layer.
     } modifiers;
+    /** Shared render state; only used when @ref KEYFRAME_FLAG_BROADCAST is set. */
+    keyframe_broadcast_t broadcast;
 };
 
 /** Storage and state for keyframe groups. */
@@ -161,11 +241,11 @@ typedef struct st_keyframe_blink
         bool    color1_provided; ///< Specifies if color1 was set during parsing.
         bool    color2_provided; ///< Specifies if color2 was set during parsing.
     } args;
-    /** Keyframe render state. */
+    /** Keyframe render state; set when the keyframe is lowered, along with both colors in RGB. */
     struct
     {
-        timestep_t  transition_time; ///< Time to transition from color1 to color2 for the current framerate.
-        timestep_t  finish_time;     ///< Time at which the keyframe has completed for the current framerate.
+        timestep_t  transition_time; ///< Time to transition from color1 to color2.
+        timestep_t  finish_time;     ///< Time at which the keyframe has completed.
     } state;
 } keyframe_blink_t;
 
@@ -199,7 +279,8 @@ keyframe_base_t * keyframe_blink_parse(char * p_str);
 keyframe_base_t * keyframe_blink_ctor(keyframe_blink_t * p_blink);
 
 keyframe_base_t * keyframe_fade_parse(char * p_str);
-keyframe_base_t * keyframe_fade_ctor(keyframe_fade_t * p_fade);
+keyframe_base_t * keyframe_fade_ctor(keyframe_fade_t * p_fade, keyframe_fade_args_t * p_args, bool adopt);
+keyframe_fade_args_t * keyframe_fade_args_alloc(uint8_t colors_len);
 
 keyframe_base_t * keyframe_set_parse(char * p_str);
 keyframe_base_t * keyframe_set_ctor(keyframe_set_t * p_set);
@@ -0,0 +1,341 @@
+/**
+ * @file
+ * @defgroup pixelkey__palette__internals Color Palette Internals
+ * @ingroup pixelkey__palette
+ * @{
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "pixelkey_errors.h"
+#include "color.h"
+
+#include "palette.h"
+
+/** Number of slots in the hashed index; must be a power of 2 and larger than @ref PALETTE_ENTRIES_MAX. */
+#define PALETTE_HASH_SLOTS      (PALETTE_ENTRIES_MAX * 2U)
+
+/** Value of an empty hashed index slot. */
+#define PALETTE_HASH_EMPTY      (0U)
+
+/** FNV-1a 32-bit offset basis. */
+#define FNV_OFFSET_BASIS        (2166136261UL)
+/** FNV-1a 32-bit prime. */
+#define FNV_PRIME               (16777619UL)
+
+static_assert((PALETTE_HASH_SLOTS & (PALETTE_HASH_SLOTS - 1U)) == 0, "PALETTE_HASH_SLOTS must be a power of 2.");
+
+/** Currently registered NV memory API instance. */
+static palette_api_t const * registered_api = NULL;
+
+/** Working copy of the palette. */
+static palette_data_t palette =
+{
+    .header = { .version = PALETTE_DATA_VERSION, .length = sizeof(palette_data_t) },
+};
+
+/** true if @ref palette has changes which have not been saved to NV memory. */
+static bool palette_dirty = false;
+
+/** Hashed index into @ref palette; each slot holds the entry index + 1 or @ref PALETTE_HASH_EMPTY. */
+static uint8_t palette_index[PALETTE_HASH_SLOTS] = {0};
+
+/**
+ * Checks if a character may be used in a palette name.
+ * @param c     Character to check.
+ * @param first true if c is the first character of the name.
+ * @return true if the character is allowed.
+ */
+static inline bool palette_name_char(char c, bool first)
+{
+    return (c >= 'a' && c <= 'z') || (!first && ((c >= '0' && c <= '9') || c == '_'));
+}
+
+/**
+ * Hashes a palette key.
+ * @param[in] p_name Pointer to the name; does not need to be NULL-terminated.
+ * @param     len    Length of the name.
+ * @param     index  Palette index or @ref PALETTE_INDEX_NONE.
+ * @return FNV-1a hash of the key.
+ */
+static uint32_t palette_hash(char const * p_name, size_t len, uint8_t index)
+{
+    uint32_t hash = FNV_OFFSET_BASIS;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash = (hash ^ (uint8_t) p_name[i]) * FNV_PRIME;
+    }
+    return (hash ^ index) * FNV_PRIME;
+}
+
+/**
+ * Checks if a palette entry matches a key.
+ * @param[in] p_entry Pointer to the entry.
+ * @param[in] p_name  Pointer to the name; does not need to be NULL-terminated.
+ * @param     len     Length of the name.
+ * @param     index   Palette index or @ref PALETTE_INDEX_NONE.
+ * @return true if the entry matches.
+ */
+static inline bool palette_entry_matches(palette_entry_t const * p_entry, char const * p_name, size_t len, uint8_t index)
+{
+    return p_entry->index == index && strncmp(p_entry->name, p_name, len) == 0 && p_entry->name[len] == '\0';
+}
+
+/**
+ * Finds the hashed index slot for a key.
+ * @param[in] p_name Pointer to the name; does not need to be NULL-terminated.
+ * @param     len    Length of the name.
+ * @param     index  Palette index or @ref PALETTE_INDEX_NONE.
+ * @return The slot holding the key or the empty slot where it would be inserted.
+ */
+static size_t palette_slot(char const * p_name, size_t len, uint8_t index)
+{
+    size_t slot = palette_hash(p_name, len, index) & (PALETTE_HASH_SLOTS - 1U);
+
+    // The index is never full since it has more slots than entries, so this always terminates.
+    while (palette_index[slot] != PALETTE_HASH_EMPTY &&
+           !palette_entry_matches(&palette.entries[palette_index[slot] - 1U], p_name, len, index))
+    {
+        slot = (slot + 1U) & (PALETTE_HASH_SLOTS - 1U);
+    }
+
+    return slot;
+}
+
+/**
+ * Rebuilds the hashed index from the palette entries.
+ */
+static void palette_index_build(void)
+{
+    memset(palette_index, PALETTE_HASH_EMPTY, sizeof(palette_index));
+
+    for (uint8_t i = 0; i < palette.count; i++)
+    {
+        palette_entry_t const * p_entry = &palette.entries[i];
+        palette_index[palette_slot(p_entry->name, strlen(p_entry->name), p_entry->index)] = (uint8_t) (i + 1U);
+    }
+}
+
+/**
+ * Register an NV memory API to be used to persist the palette.
+ * @param[in] p_instance Pointer to the API instance.
+ */
+void palette_register(palette_api_t const * p_instance)
+{
+    registered_api = p_instance;
+}
+
+/**
+ * Loads the palette from NV memory, if an API is registered, and builds the lookup index.
+ * @retval PIXELKEY_ERROR_NONE           Palette was loaded or no palette has been saved.
+ * @retval PIXELKEY_ERROR_NV_CRC_MISMATCH Saved palette is corrupt; the palette is empty.
+ */
+pixelkey_error_t palette_init(void)
+{
+    pixelkey_error_t err = PIXELKEY_ERROR_NONE;
+
+    palette.count = 0;
+    palette_dirty = false;
+    if (registered_api != NULL)
+    {
+        palette_data_t const * p_data = NULL;
+        err = registered_api->read(&p_data);
+        if (err == PIXELKEY_ERROR_NONE)
+        {
+            if (p_data->header.version == PALETTE_DATA_VERSION &&
+                p_data->header.length == sizeof(palette_data_t) &&
+                p_data->count <= PALETTE_ENTRIES_MAX)
+            {
+                palette = *p_data;
+            }
+        }
+        else if (err == PIXELKEY_ERROR_NV_NOT_INITIALIZED)
+        {
+            // Nothing has been saved yet.
+            err = PIXELKEY_ERROR_NONE;
+        }
+    }
+
+    palette_index_build();
+
+    return err;
+}
+
+/**
+ * Adds or replaces a palette entry. The change is kept until @ref palette_save writes it to NV memory.
+ * @param[in] p_name  Name of the color or palette; see @ref palette_name_valid.
+ * @param     index   Index within the palette or @ref PALETTE_INDEX_NONE for a named color.
+ * @param[in] p_color Pointer to the color to store.
+ * @retval PIXELKEY_ERROR_NONE             Entry was set.
+ * @retval PIXELKEY_ERROR_INVALID_ARGUMENT Name is invalid or is a built-in color name.
+ * @retval PIXELKEY_ERROR_BUFFER_FULL      No more palette entries are available.
+ */
+pixelkey_error_t palette_set(char const * p_name, uint8_t index, color_t const * p_color)
+{
+    const size_t len = (p_name == NULL) ? 0 : strlen(p_name);
+    if (!palette_name_valid(p_name, len) || (index == PALETTE_INDEX_NONE && color_named_find(p_name, len) != NULL))
+    {
+        return PIXELKEY_ERROR_INVALID_ARGUMENT;
+    }
+
+    const size_t slot = palette_slot(p_name, len, index);
+    palette_entry_t * p_entry;
+    if (palette_index[slot] != PALETTE_HASH_EMPTY)
+    {
+        p_entry = &palette.entries[palette_index[slot] - 1U];
+    }
+    else
+    {
+        if (palette.count == PALETTE_ENTRIES_MAX)
+        {
+            return PIXELKEY_ERROR_BUFFER_FULL;
+        }
+
+        p_entry = &palette.entries[palette.count++];
+        palette_index[slot] = palette.count;
+        memset(p_entry, 0, sizeof(*p_entry));
+        memcpy(p_entry->name, p_name, len);
+        p_entry->index = index;
+    }
+
+    // Store both forms so users of the entry never need to convert it.
+    color_kind_t converted;
+    color_convert2(p_color->color_space, COLOR_SPACE_RGB, (color_kind_t const *) p_color, &converted);
+    p_entry->rgb = converted.rgb;
+    color_convert2(p_color->color_space, COLOR_SPACE_HSV, (color_kind_t const *) p_color, &converted);
+    p_entry->hsv = converted.hsv;
+    palette_dirty = true;
+
+    return PIXELKEY_ERROR_NONE;
+}
+
+/**
+ * Removes all palette entries. The change is kept until @ref palette_save writes it to NV memory.
+ */
+void palette_clear(void)
+{
+    palette.count = 0;
+    palette_index_build();
+    palette_dirty = true;
+}
+
+/**
+ * Saves the palette to NV memory, if an API is registered and the palette changed since it was loaded or saved.
+ * Each save erases and rewrites the palette blocks, so changes are batched until they are saved.
+ * @retval PIXELKEY_ERROR_NONE            Palette was saved or had no changes.
+ * @retval PIXELKEY_ERROR_NV_MEMORY_ERROR NV memory error occurred on write.
+ */
+pixelkey_error_t palette_save(void)
+{
+    if (!palette_dirty || registered_api == NULL)
+    {
+        return PIXELKEY_ERROR_NONE;
+    }
+
+    pixelkey_error_t err = registered_api->write(&palette);
+    if (err == PIXELKEY_ERROR_NONE)
+    {
+        palette_dirty = false;
+    }
+    return err;
+}
+
+/**
+ * Checks if a string is a valid palette name.
+ * Names start with a lowercase letter followed by lowercase letters, digits, or underscores.
+ * @param[in] p_name Pointer to the name; does not need to be NULL-terminated.
+ * @param     len    Length of the name.
+ * @return true if the name is valid.
+ */
+bool palette_name_valid(char const * p_name, size_t len)
+{
+    if (p_name == NULL || len == 0 || len >= PALETTE_NAME_MAX_LENGTH)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < len; i++)
+    {
+        if (!palette_name_char(p_name[i], i == 0))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Finds a palette entry.
+ * @param[in] p_name Pointer to the name; does not need to be NULL-terminated.
+ * @param     len    Length of the name.
+ * @param     index  Palette index or @ref PALETTE_INDEX_NONE for a named color.
+ * @return Pointer to the entry or NULL if it does not exist.
+ */
+palette_entry_t const * palette_find(char const * p_name, size_t len, uint8_t index)
+{
+    if (len >= PALETTE_NAME_MAX_LENGTH)
+    {
+        return NULL;
+    }
+
+    const uint8_t entry = palette_index[palette_slot(p_name, len, index)];
+    return (entry == PALETTE_HASH_EMPTY) ? NULL : &palette.entries[entry - 1U];
+}
+
+/**
+ * Parses a palette reference, `name` or `name.index`, from the start of a string view.
+ * @param[in]  p_str    Pointer to the characters to parse; does not need to be NULL-terminated.
+ * @param      len      Number of characters available.
+ * @param[out] pp_entry Pointer to store the referenced entry.
+ * @return Number of characters consumed or 0 if the reference is invalid or does not exist.
+ */
+size_t palette_parse_n(char const * p_str, size_t len, palette_entry_t const ** pp_entry)
+{
+    size_t name_len = 0;
+    while (name_len < len && palette_name_char(p_str[name_len], name_len == 0))
+    {
+        name_len++;
+    }
+    if (name_len == 0)
+    {
+        return 0;
+    }
+
+    size_t pos = name_len;
+    uint32_t index = PALETTE_INDEX_NONE;
+    if (pos < len && p_str[pos] == '.')
+    {
+        pos++;
+
+        index = 0;
+        const size_t digits_start = pos;
+        while (pos < len && p_str[pos] >= '0' && p_str[pos] <= '9')
+        {
+            index = index * 10U + (uint32_t) (p_str[pos] - '0');
+            if (index > PALETTE_INDEX_MAX)
+            {
+                return 0;
+            }
+            pos++;
+        }
+        if (pos == digits_start)
+        {
+            return 0;
+        }
+    }
+
+    palette_entry_t const * p_entry = palette_find(p_str, name_len, (uint8_t) index);
+    if (p_entry == NULL)
+    {
+        return 0;
+    }
+
+    *pp_entry = p_entry;
+    return pos;
+}
+
+/** @} */
@@ -0,0 +1,105 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <assert.h>
+
+#include "pixelkey_errors.h"
+#include "color.h"
+
+/**
+ * @file
+ * @defgroup pixelkey__palette Color Palette
+ * @ingroup pixelkey
+ * User-defined named colors and indexed palettes.
+ *
+ * Entries are referenced in color strings as `name` for named colors or `name.index` for palette entries.
+ * Each entry stores both its RGB and HSV forms so no conversion is required when it is used.
+ * @{
+ */
+
+#define PALETTE_DATA_VERSION        (1)
+
+/** Maximum number of palette entries, named colors and indexed entries combined. */
+#define PALETTE_ENTRIES_MAX         (32U)
+
+/** Max string length for palette names, including the '\0'. */
+#define PALETTE_NAME_MAX_LENGTH     (12U)
+
+/** Maximum index of an indexed palette entry. */
+#define PALETTE_INDEX_MAX           (254U)
+
+/** Index used for named colors which are not part of an indexed palette. */
+#define PALETTE_INDEX_NONE          (255U)
+
+// Saved to memory; must be packed!
+#pragma pack(push, 1)
+/** Single palette entry. */
+typedef struct st_palette_entry
+{
+    char        name[PALETTE_NAME_MAX_LENGTH]; ///< Entry or palette name stringZ.
+    uint8_t     index;                         ///< Index within the palette or @ref PALETTE_INDEX_NONE.
+    color_rgb_t rgb;                           ///< Color in the RGB color space.
+    color_hsv_t hsv;                           ///< Color in the HSV color space.
+} palette_entry_t;
+
+/**
+ * Palette storage saved to NV memory.
+ *
+ * @note The @ref palette_data_t::version element should be incremented if the struct layout changes.
+ */
+typedef struct st_palette_data
+{
+    /**
+     * Palette header.
+     * @warning These fields should only be modified by the NV memory implementation.
+     */
+    struct
+    {
+        uint16_t crc;                     ///< CRC-CCITT of all the following fields in the structure.
+        uint16_t length;                  ///< Size of the palette data struct at the time of save.
+        uint8_t  version;                 ///< Palette struct version.
+    } header;
+    uint8_t         count;                ///< Number of valid entries.
+    palette_entry_t entries[PALETTE_ENTRIES_MAX]; ///< Palette entries; only the first count are valid.
+} palette_data_t;
+#pragma pack(pop)
+
+static_assert(offsetof(palette_data_t, header.crc) == 0, "CRC must start at byte 0.");
+static_assert(offsetof(palette_data_t, header.length) == 2, "Length must start at byte 2.");
+static_assert(PALETTE_ENTRIES_MAX <= UINT8_MAX, "Palette entry count must fit in palette_data_t::count.");
+
+/** Palette NV memory instance API. */
+typedef struct st_palette_api
+{
+    /**
+     * Writes the palette data struct to NV memory.
+     * @param[in,out] p_palette_data Pointer to the data to save; its header is filled in before it is written.
+     * @retval PIXELKEY_ERROR_NONE            Write was successful.
+     * @retval PIXELKEY_ERROR_NV_MEMORY_ERROR NV memory error occurred on write.
+     */
+    pixelkey_error_t (* write)(palette_data_t * const p_palette_data);
+    /**
+     * Gets a pointer to the palette data struct.
+     * @param[out] pp_palette_data Pointer to write the palette data pointer.
+     * @retval PIXELKEY_ERROR_NONE              Read was successful.
+     * @retval PIXELKEY_ERROR_NV_NOT_INITIALIZED No palette has been saved.
+     * @retval PIXELKEY_ERROR_NV_CRC_MISMATCH    Saved palette is corrupt.
+     */
+    pixelkey_error_t (* read)(palette_data_t const ** pp_palette_data);
+} palette_api_t;
+
+void palette_register(palette_api_t const * p_instance);
+pixelkey_error_t palette_init(void);
+pixelkey_error_t palette_set(char const * p_name, uint8_t index, color_t const * p_color);
+void palette_clear(void);
+pixelkey_error_t palette_save(void);
+bool palette_name_valid(char const * p_name, size_t len);
+palette_entry_t const * palette_find(char const * p_name, size_t len, uint8_t index);
+size_t palette_parse_n(char const * p_str, size_t len, palette_entry_t const ** pp_entry);
+
+/** @} */
+
+#endif // PALETTE_H
@@ -0,0 +1,186 @@
+/**
+ * @file
+ * @defgroup pixelkey__pixel_map__internals Pixel Map Internals
+ * @ingroup pixelkey__pixel_map
+ * @{
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "pixelkey_errors.h"
+
+#include "pixel_map.h"
+
+/** All of the defined @ref pixel_map_flag_t flags. */
+#define PIXEL_MAP_FLAGS_ALL (PIXEL_MAP_FLAG_SERPENTINE | PIXEL_MAP_FLAG_FLIP_X | PIXEL_MAP_FLAG_FLIP_Y | \
+                             PIXEL_MAP_FLAG_MIRROR_X | PIXEL_MAP_FLAG_MIRROR_Y)
+
+/**
+ * Gets the size of the virtual grid of a matrix layout.
+ * @param[in]  p_layout Pointer to the layout; must have a width.
+ * @param[out] p_width  Pointer to store the width of the virtual grid.
+ * @param[out] p_height Pointer to store the height of the virtual grid.
+ */
+static void grid_size(pixel_map_layout_t const * p_layout, uint16_t * p_width, uint16_t * p_height)
+{
+    // Odd quarter turns swap the rows and columns.
+    const bool turned = (p_layout->rotation & 1U) != 0U;
+    uint16_t width = turned ? p_layout->height : p_layout->width;
+    uint16_t height = turned ? p_layout->width : p_layout->height;
+
+    // A mirrored half is folded onto the other; the middle row or column of an odd size is kept.
+    if (p_layout->flags & PIXEL_MAP_FLAG_MIRROR_X)
+    {
+        width = (uint16_t) ((width + 1U) / 2U);
+    }
+    if (p_layout->flags & PIXEL_MAP_FLAG_MIRROR_Y)
+    {
+        height = (uint16_t) ((height + 1U) / 2U);
+    }
+
+    *p_width = width;
+    *p_height = height;
+}
+
+/**
+ * Folds a coordinate onto the first half of an axis.
+ * @param pos  The coordinate.
+ * @param size Length of the axis before it is folded.
+ * @return The coordinate, or its reflection if it is in the second half.
+ */
+static inline uint16_t fold(uint16_t pos, uint16_t size)
+{
+    const uint16_t reflected = (uint16_t) (size - 1U - pos);
+    return (reflected < pos) ? reflected : pos;
+}
+
+/**
+ * Checks if a layout maps every NeoPixel to itself so no table is needed.
+ * @param[in] p_layout Pointer to the layout.
+ * @return true for a strip, or a matrix which is not rotated, flipped, mirrored, or wired in a serpentine.
+ */
+bool pixel_map_is_identity(pixel_map_layout_t const * p_layout)
+{
+    return (p_layout->width == 0U) || (p_layout->rotation == 0U && p_layout->flags == PIXEL_MAP_FLAG_NONE);
+}
+
+/**
+ * Gets the number of virtual NeoPixels rendered for a layout.
+ * @param[in]  p_layout        Pointer to the layout.
+ * @param      physical_count  Number of NeoPixels attached.
+ * @param[out] p_virtual_count Pointer to store the number of virtual NeoPixels.
+ * @retval PIXELKEY_ERROR_NONE             The layout is valid.
+ * @retval PIXELKEY_ERROR_INVALID_ARGUMENT The matrix has no rows, has more NeoPixels than are attached, or the
+ *                                         rotation or flags are not valid.
+ */
+pixelkey_error_t pixel_map_virtual_count(pixel_map_layout_t const * p_layout, uint16_t physical_count,
+                                         uint16_t * p_virtual_count)
+{
+    if (p_layout->width == 0U)
+    {
+        *p_virtual_count = physical_count;
+        return PIXELKEY_ERROR_NONE;
+    }
+
+    const uint32_t matrix_count = (uint32_t) p_layout->width * p_layout->height;
+    if (p_layout->height == 0U || matrix_count > physical_count || p_layout->rotation >= PIXEL_MAP_ROTATIONS ||
+        (p_layout->flags & ~PIXEL_MAP_FLAGS_ALL) != 0U)
+    {
+        return PIXELKEY_ERROR_INVALID_ARGUMENT;
+    }
+
+    uint16_t width;
+    uint16_t height;
+    grid_size(p_layout, &width, &height);
+    *p_virtual_count = (uint16_t) (width * height + (physical_count - matrix_count));
+
+    return PIXELKEY_ERROR_NONE;
+}
+
+/**
+ * Builds the table of virtual NeoPixels copied to each physical NeoPixel.
+ * @param[in]  p_layout       Pointer to a layout accepted by @ref pixel_map_virtual_count.
+ * @param      physical_count Number of NeoPixels attached.
+ * @param[out] p_table        Pointer to physical_count entries; entry n is the index of the virtual NeoPixel shown
+ *                            by physical NeoPixel n.
+ */
+void pixel_map_build(pixel_map_layout_t const * p_layout, uint16_t physical_count, uint16_t * p_table)
+{
+    const uint16_t wired_width = p_layout->width;
+    const uint16_t wired_height = p_layout->height;
+    const uint16_t matrix_count = (uint16_t) (wired_width * wired_height);
+    const bool turned = (p_layout->rotation & 1U) != 0U;
+
+    // Size of the virtual grid before it is mirrored.
+    const uint16_t turned_width = turned ? wired_height : wired_width;
+    const uint16_t turned_height = turned ? wired_width : wired_height;
+
+    uint16_t grid_width;
+    uint16_t grid_height;
+    grid_size(p_layout, &grid_width, &grid_height);
+
+    for (uint16_t p = 0; p < matrix_count; p++)
+    {
+        const uint16_t row = (uint16_t) (p / wired_width);
+        uint16_t x = (uint16_t) (p % wired_width);
+        uint16_t y = row;
+
+        if ((p_layout->flags & PIXEL_MAP_FLAG_SERPENTINE) && (row & 1U))
+        {
+            x = (uint16_t) (wired_width - 1U - x);
+        }
+        if (p_layout->flags & PIXEL_MAP_FLAG_FLIP_X)
+        {
+            x = (uint16_t) (wired_width - 1U - x);
+        }
+        if (p_layout->flags & PIXEL_MAP_FLAG_FLIP_Y)
+        {
+            y = (uint16_t) (wired_height - 1U - y);
+        }
+
+        // Quarter turns clockwise.
+        uint16_t vx;
+        uint16_t vy;
+        switch (p_layout->rotation)
+        {
+            case 1:
+                vx = (uint16_t) (wired_height - 1U - y);
+                vy = x;
+                break;
+            case 2:
+                vx = (uint16_t) (wired_width - 1U - x);
+                vy = (uint16_t) (wired_height - 1U - y);
+                break;
+            case 3:
+                vx = y;
+                vy = (uint16_t) (wired_width - 1U - x);
+                break;
+            default:
+                vx = x;
+                vy = y;
+                break;
+        }
+
+        if (p_layout->flags & PIXEL_MAP_FLAG_MIRROR_X)
+        {
+            vx = fold(vx, turned_width);
+        }
+        if (p_layout->flags & PIXEL_MAP_FLAG_MIRROR_Y)
+        {
+            vy = fold(vy, turned_height);
+        }
+
+        p_table[p] = (uint16_t) (vy * grid_width + vx);
+    }
+
+    // NeoPixels after the matrix follow the virtual grid in order.
+    const uint16_t grid_count = (uint16_t) (grid_width * grid_height);
+    for (uint16_t p = matrix_count; p < physical_count; p++)
+    {
+        p_table[p] = (uint16_t) (grid_count + (p - matrix_count));
+    }
+}
+
+/** @} */
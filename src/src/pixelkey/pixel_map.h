@@ -0,0 +1,57 @@
+#ifndef PIXEL_MAP_H
+#define PIXEL_MAP_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include "pixelkey_errors.h"
+
+/**
+ * @file
+ * @defgroup pixelkey__pixel_map Pixel Map
+ * @ingroup pixelkey
+ * Maps the NeoPixels of a matrix to a virtual grid that keyframes are rendered in.
+ *
+ * NeoPixels are wired along the rows of a matrix, width NeoPixels to a row, optionally in a serpentine. Keyframes are
+ * rendered once per virtual NeoPixel, numbered along the rows of the virtual grid, and each physical NeoPixel copies
+ * its color from a virtual NeoPixel through a table built once at startup. The grid may be rotated and flipped to
+ * match how the matrix is mounted, and mirrored so symmetric halves share their virtual NeoPixels and are rendered
+ * once. NeoPixels after the matrix carry on as a strip after the virtual grid.
+ * @{
+ */
+
+/** How the matrix is wired and mounted. */
+typedef enum e_pixel_map_flag
+{
+    PIXEL_MAP_FLAG_NONE = 0U,              ///< No flags are set.
+    PIXEL_MAP_FLAG_SERPENTINE = (1U << 0), ///< Every other row is wired right to left.
+    PIXEL_MAP_FLAG_FLIP_X = (1U << 1),     ///< The matrix is flipped left to right before it is rotated.
+    PIXEL_MAP_FLAG_FLIP_Y = (1U << 2),     ///< The matrix is flipped top to bottom before it is rotated.
+    PIXEL_MAP_FLAG_MIRROR_X = (1U << 3),   ///< The right half of the virtual grid mirrors the left half.
+    PIXEL_MAP_FLAG_MIRROR_Y = (1U << 4),   ///< The bottom half of the virtual grid mirrors the top half.
+} pixel_map_flag_t;
+
+/** Number of quarter turns a matrix may be rotated by. */
+#define PIXEL_MAP_ROTATIONS     (4U)
+
+/** Layout of a NeoPixel matrix. */
+typedef struct st_pixel_map_layout
+{
+    uint8_t width;    ///< NeoPixels in each wired row; 0 for a strip, which is not mapped.
+    uint8_t height;   ///< Number of wired rows.
+    uint8_t rotation; ///< Quarter turns clockwise from the wired rows to the virtual grid.
+    uint8_t flags;    ///< @ref pixel_map_flag_t flags.
+} pixel_map_layout_t;
+
+static_assert(sizeof(pixel_map_layout_t) == 4, "pixel_map_layout_t must be 4 bytes or an upgrade path provided.");
+
+bool pixel_map_is_identity(pixel_map_layout_t const * p_layout);
+pixelkey_error_t pixel_map_virtual_count(pixel_map_layout_t const * p_layout, uint16_t physical_count,
+                                         uint16_t * p_virtual_count);
+void pixel_map_build(pixel_map_layout_t const * p_layout, uint16_t physical_count, uint16_t * p_table);
+
+/** @} */
+
+#endif // PIXEL_MAP_H
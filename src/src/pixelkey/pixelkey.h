@@ -12,6 +12,7 @@
 #include "pixelkey_commands.h"
 
 #include "keyframes.h"
+#include "arena.h"
 
 /**
  * @defgroup pixelkey PixelKey
@@ -22,11 +23,16 @@
  * @{
  */
 
-void pixelkey_frameproc_init(framerate_t framerate);
-void pixelkey_keyframeproc_framerate_set(framerate_t framerate);
+pixelkey_error_t pixelkey_frameproc_init(arena_t * p_arena, uint32_t count);
+void pixelkey_keyframeproc_output_update(void);
 uint32_t pixelkey_keyframeproc_framecount_get(void);
-pixelkey_error_t pixelkey_keyframeproc_render_frame(color_rgb_t * p_frame_buffer);
-pixelkey_error_t pixelkey_keyframeproc_push(uint8_t index, keyframe_base_t * p_keyframe);
+uint16_t pixelkey_keyframeproc_pixel_count_get(void);
+pixelkey_error_t pixelkey_keyframeproc_render_frame(color_rgb_t * p_frame_buffer, timestep_t time);
+pixelkey_error_t pixelkey_keyframeproc_push(uint16_t index, keyframe_base_t * p_keyframe);
+pixelkey_error_t pixelkey_keyframeproc_push_at(uint16_t index, keyframe_base_t * p_keyframe, timestep_t start);
+void pixelkey_keyframeproc_release(keyframe_base_t * p_keyframe);
+bool pixelkey_keyframeproc_stale_get(timestep_t * p_time);
+pixelkey_error_t pixelkey_keyframeproc_layer_set(uint8_t layer, color_blend_t blend, uint8_t opacity);
 
 void pixelkey_commandproc_init(void);
 void pixelkey_commandproc_task(void);
@@ -13,6 +13,8 @@
 #include <stdbool.h>
 
 #include "keyframes.h"
+#include "palette.h"
+#include "segment.h"
 
 /** Prefix for non-keyframe commands. */
 #define CMD_PREFIX                  ('$')
@@ -20,12 +22,18 @@
 /** Prefix for repeat keyframe modifier command. */
 #define CMD_REPEAT_MOD_PREFIX       ('^')
 
+/** Broadcast keyframe modifier command. */
+#define CMD_BROADCAST_MOD_PREFIX    ('*')
+
 /** Prefix for schedule keyframe modifier command. */
 #define CMD_SCHEDULE_MOD_PREFIX     ('@')
 
 /** Prefix for group keyframe modifier command. */
 #define CMD_GROUP_BEGIN_MOD_PREFIX  ('{')
 
+/** Prefix for layer keyframe modifier command. */
+#define CMD_LAYER_MOD_PREFIX        ('|')
+
 /** Prefix for group keyframe modifier command. */
 #define CMD_GROUP_END_MOD_PREFIX    ('}')
 
@@ -40,6 +48,9 @@
 /** Maximum channel number that can be specified for keyframes. */
 #define CMD_KEYFRAME_MAX_CHANNEL_NUMBER (0x7FFF)
 
+/** Marks the first channel of a channel range in @ref cmd_args_keyframe_wrapper_t::channels. */
+#define CMD_KEYFRAME_CHANNEL_RANGE_FLAG (0x8000U)
+
 /** Command types. */
 typedef enum e_cmd_type
 {
@@ -58,6 +69,13 @@ typedef enum e_cmd_type
     CMD_TYPE_TIME_SET,              ///< Set the current system time.
     CMD_TYPE_HELP,                  ///< Displays a help message.
     CMD_TYPE_REBOOT,                ///< Triggers a software reset of the micro.
+    CMD_TYPE_PALETTE_SET,           ///< Sets a user palette color.
+    CMD_TYPE_PALETTE_CLEAR,         ///< Removes all user palette colors.
+    CMD_TYPE_KEYFRAME_MOD_BROADCAST, ///< Keyframe broadcast modifier command.
+    CMD_TYPE_KEYFRAME_MOD_LAYER,    ///< Keyframe layer modifier command.
+    CMD_TYPE_SEGMENT_SET,           ///< Sets a strip segment.
+    CMD_TYPE_SEGMENT_CLEAR,         ///< Removes all strip segments.
+    CMD_TYPE_PALETTE_SAVE,          ///< Saves the user palette colors.
     CMD_TYPE_COUNT,                 ///< Total number of command types.
 } cmd_type_t;
 
@@ -97,6 +115,23 @@ typedef struct st_cmd_args_config_set
     
 } cmd_args_config_set_t;
 
+/** Arguments to palette-set command. */
+typedef struct st_cmd_args_palette_set
+{
+    char    name[PALETTE_NAME_MAX_LENGTH]; ///< Color or palette name.
+    uint8_t index;                         ///< Palette index or @ref PALETTE_INDEX_NONE for a named color.
+    color_t color;                         ///< Color to store.
+} cmd_args_palette_set_t;
+
+/** Arguments to segment-set command. */
+typedef struct st_cmd_args_segment_set
+{
+    char        name[SEGMENT_NAME_MAX_LENGTH]; ///< Segment name.
+    uint16_t    first;                         ///< Index of the first NeoPixel.
+    uint16_t    count;                         ///< Number of NeoPixels.
+    framerate_t framerate;                     ///< Framerate to render the segment at.
+} cmd_args_segment_set_t;
+
 /** Arguments to time-set command. */
 typedef struct st_cmd_args_time_set
 {
@@ -120,6 +155,15 @@ typedef struct st_cmd_args_keyframe_mod_repeat
     int32_t repeat_count;   ///< Number of repeats to perform, -1 is indefinite, 0 = 1.
 } cmd_args_keyframe_mod_repeat_t;
 
+/** Arguments for layer keyframe modifier command. */
+typedef struct st_cmd_args_keyframe_mod_layer
+{
+    uint8_t       layer;          ///< Layer to render the next keyframe on.
+    bool          blend_provided; ///< true if the blend mode and opacity of the layer are to be set.
+    color_blend_t blend;          ///< How the layer is combined with the layers beneath it.
+    uint8_t       opacity;        ///< Amount of the blended color shown, 0 to 255.
+} cmd_args_keyframe_mod_layer_t;
+
 /** Arguments for schedule keyframe modifier command. */
 typedef struct st_cmd_args_keyframe_mod_schedule
 {
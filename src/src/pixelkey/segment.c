@@ -0,0 +1,243 @@
+/**
+ * @file
+ * @defgroup pixelkey__segment__internals Strip Segments Internals
+ * @ingroup pixelkey__segment
+ * @{
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "hal_device.h"
+#include "pixelkey_errors.h"
+#include "keyframes.h"
+
+#include "segment.h"
+
+/** A named range of NeoPixels and its render schedule. */
+typedef struct st_segment
+{
+    char       name[SEGMENT_NAME_MAX_LENGTH]; ///< Segment name stringZ.
+    uint16_t   first;                         ///< Index of the first NeoPixel.
+    uint16_t   count;                         ///< Number of NeoPixels.
+    timestep_t period;                        ///< Time between renders.
+    timestep_t next;                          ///< Time of the next render.
+    bool       restart;                       ///< true to render on the next frame and time the ticks from it.
+} segment_t;
+
+/** Segments ordered by their first NeoPixel; they never overlap. */
+static segment_t segments[SEGMENTS_MAX];
+
+/** Number of entries in @ref segments. */
+static uint8_t segment_count = 0;
+
+/**
+ * Checks if a segment is due to render and moves it to its next tick if it is.
+ * @param[in,out] p_seg Pointer to the segment.
+ * @param         time  The current frame time.
+ * @param         slack Time before a tick at which it is rendered early.
+ * @return true if the segment renders this frame.
+ */
+static bool segment_due(segment_t * p_seg, timestep_t time, timestep_t slack)
+{
+    if (p_seg->restart)
+    {
+        p_seg->restart = false;
+        p_seg->next = time + p_seg->period;
+        return true;
+    }
+
+    if ((int32_t) (time + slack - p_seg->next) < 0)
+    {
+        return false;
+    }
+
+    // Ticks keep to the segment's period; one missed by a whole period is dropped rather than rendered late.
+    p_seg->next += p_seg->period;
+    if ((int32_t) (time - p_seg->next) >= 0)
+    {
+        p_seg->next = time + p_seg->period;
+    }
+
+    return true;
+}
+
+/**
+ * Appends a range of NeoPixels to a list, merging it with the last range when they are next to each other.
+ * @param[in,out] p_ranges Pointer to the list.
+ * @param[in,out] p_count  Pointer to the number of ranges in the list.
+ * @param         first    Index of the first NeoPixel.
+ * @param         count    Number of NeoPixels; nothing is added if 0.
+ */
+static void range_add(segment_range_t * p_ranges, size_t * p_count, uint16_t first, uint16_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    if (*p_count > 0)
+    {
+        segment_range_t * const p_last = &p_ranges[*p_count - 1U];
+        if ((uint32_t) p_last->first + p_last->count == first)
+        {
+            p_last->count = (uint16_t) (p_last->count + count);
+            return;
+        }
+    }
+    p_ranges[(*p_count)++] = (segment_range_t) { .first = first, .count = count };
+}
+
+/**
+ * Checks if a name may be used for a segment.
+ * Names start with a lowercase letter followed by lowercase letters, digits, or underscores.
+ * @param[in] p_name Pointer to the name; does not need to be NULL-terminated.
+ * @param     len    Length of the name.
+ * @return true if the name is valid.
+ */
+bool segment_name_valid(char const * p_name, size_t len)
+{
+    if (p_name == NULL || len == 0 || len >= SEGMENT_NAME_MAX_LENGTH)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < len; i++)
+    {
+        const char c = p_name[i];
+        if (!((c >= 'a' && c <= 'z') || (i > 0 && ((c >= '0' && c <= '9') || c == '_'))))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Adds a segment, or replaces the segment with the same name.
+ * The segment renders on the next frame and then at its own framerate.
+ * @param[in] p_name    Name of the segment; see @ref segment_name_valid.
+ * @param     first     Index of the first NeoPixel.
+ * @param     count     Number of NeoPixels.
+ * @param     framerate Frames per second to render the segment at; the strip is still output at the current framerate.
+ * @retval PIXELKEY_ERROR_NONE               The segment was set.
+ * @retval PIXELKEY_ERROR_INVALID_ARGUMENT   The name is invalid or the range overlaps another segment.
+ * @retval PIXELKEY_ERROR_VALUE_OUT_OF_RANGE The range is empty or past @ref PIXELKEY_NEOPIXEL_COUNT_MAX, or the
+ *                                           framerate is not between @ref FRAMERATE_MIN and @ref FRAMERATE_MAX.
+ * @retval PIXELKEY_ERROR_BUFFER_FULL        @ref SEGMENTS_MAX segments are already set.
+ */
+pixelkey_error_t segment_set(char const * p_name, uint16_t first, uint16_t count, framerate_t framerate)
+{
+    const size_t len = (p_name == NULL) ? 0 : strlen(p_name);
+    if (!segment_name_valid(p_name, len))
+    {
+        return PIXELKEY_ERROR_INVALID_ARGUMENT;
+    }
+    if (count == 0 || (uint32_t) first + count > PIXELKEY_NEOPIXEL_COUNT_MAX ||
+        framerate < FRAMERATE_MIN || framerate > FRAMERATE_MAX)
+    {
+        return PIXELKEY_ERROR_VALUE_OUT_OF_RANGE;
+    }
+
+    // Find the segment being replaced and check the range against the others.
+    uint8_t existing = segment_count;
+    for (uint8_t i = 0; i < segment_count; i++)
+    {
+        segment_t const * const p_seg = &segments[i];
+        if (!strcmp(p_seg->name, p_name))
+        {
+            existing = i;
+        }
+        else if (first < p_seg->first + p_seg->count && p_seg->first < first + count)
+        {
+            return PIXELKEY_ERROR_INVALID_ARGUMENT;
+        }
+    }
+
+    if (existing < segment_count)
+    {
+        memmove(&segments[existing], &segments[existing + 1U], (segment_count - existing - 1U) * sizeof(segment_t));
+        segment_count--;
+    }
+    else if (segment_count == SEGMENTS_MAX)
+    {
+        return PIXELKEY_ERROR_BUFFER_FULL;
+    }
+
+    // Keep the segments ordered so they can be scheduled in one pass along the strip.
+    uint8_t pos = 0;
+    while (pos < segment_count && segments[pos].first < first)
+    {
+        pos++;
+    }
+    memmove(&segments[pos + 1U], &segments[pos], (segment_count - pos) * sizeof(segment_t));
+    segment_count++;
+
+    segments[pos] = (segment_t)
+    {
+        .first = first,
+        .count = count,
+        .period = TIMESTEP_PER_SECOND / framerate,
+        .restart = true,
+    };
+    strcpy(segments[pos].name, p_name);
+
+    return PIXELKEY_ERROR_NONE;
+}
+
+/**
+ * Removes all segments; every NeoPixel is rendered on every frame.
+ */
+void segment_clear(void)
+{
+    segment_count = 0;
+}
+
+/**
+ * Renders every segment on the next frame and times its ticks from there.
+ * This must be called when the frame clock is restarted.
+ */
+void segment_restart(void)
+{
+    for (uint8_t i = 0; i < segment_count; i++)
+    {
+        segments[i].restart = true;
+    }
+}
+
+/**
+ * Finds the NeoPixels to render this frame and advances the segments which are due.
+ * @param      time        The current frame time.
+ * @param      slack       Time before a tick at which it is rendered early; half the frame period keeps segment
+ *                         framerates which do not divide the output framerate from losing ticks.
+ * @param      pixel_count Number of NeoPixels rendered; segments past it are ignored.
+ * @param[out] p_ranges    Pointer to @ref SEGMENT_RANGES_MAX ranges to store the NeoPixels to render, in order.
+ * @return Number of ranges stored.
+ */
+size_t segment_schedule(timestep_t time, timestep_t slack, uint16_t pixel_count, segment_range_t * p_ranges)
+{
+    size_t count = 0;
+    uint16_t pos = 0;
+    for (uint8_t i = 0; i < segment_count && segments[i].first < pixel_count; i++)
+    {
+        segment_t * const p_seg = &segments[i];
+        const uint32_t end = (uint32_t) p_seg->first + p_seg->count;
+        const uint16_t last = (uint16_t) ((end < pixel_count) ? end : pixel_count);
+
+        // NeoPixels between segments render on every frame.
+        range_add(p_ranges, &count, pos, (uint16_t) (p_seg->first - pos));
+        if (segment_due(p_seg, time, slack))
+        {
+            range_add(p_ranges, &count, p_seg->first, (uint16_t) (last - p_seg->first));
+        }
+        pos = last;
+    }
+    range_add(p_ranges, &count, pos, (uint16_t) (pixel_count - pos));
+
+    return count;
+}
+
+/** @} */
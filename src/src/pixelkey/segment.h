@@ -0,0 +1,53 @@
+#ifndef SEGMENT_H
+#define SEGMENT_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include "pixelkey_errors.h"
+#include "keyframes.h"
+
+/**
+ * @file
+ * @defgroup pixelkey__segment Strip Segments
+ * @ingroup pixelkey
+ * Named ranges of NeoPixels rendered at their own framerate.
+ *
+ * The strip is always output at the current framerate, but a segment's keyframes are only rendered on the segment's
+ * own ticks; on the frames in between its NeoPixels keep their last rendered colors. NeoPixels outside of every
+ * segment are rendered on every frame. Keyframes are rendered from the frame time so animations keep their speed at
+ * any segment framerate.
+ * @{
+ */
+
+/** Maximum number of segments. */
+#ifndef SEGMENTS_MAX
+#define SEGMENTS_MAX                (8U)
+#endif
+
+/** Max string length for segment names, including the '\0'. */
+#define SEGMENT_NAME_MAX_LENGTH     (12U)
+
+/** Maximum number of ranges returned by @ref segment_schedule; due ranges next to each other are merged. */
+#define SEGMENT_RANGES_MAX          (SEGMENTS_MAX + 1U)
+
+static_assert(SEGMENTS_MAX > 0U && SEGMENTS_MAX <= UINT8_MAX, "There must be 1 to 255 segments.");
+
+/** A range of NeoPixels. */
+typedef struct st_segment_range
+{
+    uint16_t first; ///< Index of the first NeoPixel.
+    uint16_t count; ///< Number of NeoPixels.
+} segment_range_t;
+
+pixelkey_error_t segment_set(char const * p_name, uint16_t first, uint16_t count, framerate_t framerate);
+void segment_clear(void);
+void segment_restart(void);
+bool segment_name_valid(char const * p_name, size_t len);
+size_t segment_schedule(timestep_t time, timestep_t slack, uint16_t pixel_count, segment_range_t * p_ranges);
+
+/** @} */
+
+#endif // SEGMENT_H
@@ -20,6 +20,8 @@
 #include "neopixel.h"
 #include "serial.h"
 #include "config.h"
+#include "pixelkey_hal.h"
+#include "framerate_governor.h"
 
 #include "hal_npdata_transfer.h"
 
@@ -43,6 +45,12 @@ static size_t input_buffer_idx = 0;
 /** Input buffer for received command data over USB. */
 static uint8_t input_buffer[PIXELKEY_INPUT_COMMAND_BUFFER_LENGTH] = {0};
 
+/** Most core cycles a frame render has taken since the framerate governor was last sampled. */
+static uint32_t render_cycles_max = 0;
+
+/** Transmission count when the framerate governor was last sampled; see @ref npdata_tx_count_get. */
+static uint32_t governor_tx_count = 0;
+
 void __NO_RETURN pixelkey_reboot(void)
 {
     // Shut down the USB before reboot.
@@ -58,15 +66,64 @@ void __NO_RETURN pixelkey_reboot(void)
 }
 
 /**
- * Renders and queues a frame to be transferred at the next frame interval.
+ * Feeds the cost of a frame to the framerate governor once per frame sent and applies any framerate it selects.
+ * The governor counts its samples as frames shown, so the renders between two frames sent, whether topping up the ring
+ * or rendering stale frames again, are sampled together by the most expensive of them.
+ * @param render_cycles Number of core cycles taken to render the frame.
+ */
+static void frame_cost_sample(uint32_t render_cycles)
+{
+    if (render_cycles > render_cycles_max)
+    {
+        render_cycles_max = render_cycles;
+    }
+
+    const uint32_t tx_count = npdata_tx_count_get();
+    if (tx_count == governor_tx_count)
+    {
+        return;
+    }
+    governor_tx_count = tx_count;
+
+    // Transmission overlaps the next render but its interrupts take CPU time, so both count against the period.
+    const timestep_t cost = (timestep_t) HAL_CYCLES_TO_US(render_cycles_max + npdata_tx_cycles_get());
+    render_cycles_max = 0;
+
+    framerate_t framerate;
+    if (framerate_governor_sample(cost, &framerate))
+    {
+        // Frames already rendered ahead keep their times; the new period applies from the next frame timer tick.
+        pixelkey_hal_frame_timer_update(framerate);
+    }
+}
+
+/**
+ * Renders a frame into the render-ahead ring if it has space, first dropping the frames made stale by keyframes pushed
+ * for times already rendered.
  */
 void pixelkey_task_do_frame(void)
 {
-    color_rgb_t temp_frame[PIXELKEY_NEOPIXEL_COUNT] = {0};
+    // Keyframes pushed for a time already rendered change the frames rendered ahead from then on; those frames are
+    // rendered again from the first changed one.
+    timestep_t stale_time;
+    if (pixelkey_keyframeproc_stale_get(&stale_time))
+    {
+        npdata_frame_rewind(stale_time);
+    }
 
+    color_rgb_t * const p_frame = npdata_back_buffer_get();
+    if (p_frame == NULL)
+    {
+        // Enough frames have been rendered ahead.
+        return;
+    }
+
+    const uint32_t render_start = HAL_CYCLES_GET();
     LOG_TIME_START(DIAG_TIMING_FRAME_RENDER);
-    pixelkey_error_t err = pixelkey_keyframeproc_render_frame(temp_frame);
+    // Render straight into the back buffer; it is queued behind the frames already waiting to be sent.
+    pixelkey_error_t err = pixelkey_keyframeproc_render_frame(p_frame, npdata_back_buffer_time_get());
     LOG_TIME(DIAG_TIMING_FRAME_RENDER);
+    const uint32_t render_cycles = HAL_CYCLES_GET() - render_start;
 
     if (err != PIXELKEY_ERROR_NONE)
     {
@@ -74,14 +131,14 @@ void pixelkey_task_do_frame(void)
         return;
     }
 
-    while (npdata_status_get() == TRANSFER_STATUS_WORKING)
+    npdata_frame_commit();
+    frame_cost_sample(render_cycles);
+
+    // Keep rendering until the ring is full again; one frame is rendered per frame timer tick otherwise.
+    if (npdata_back_buffer_get() != NULL)
     {
-        // Wait until the transfer has completed.
+        tasks_queue(TASK_FRAME_RENDER);
     }
-
-    // Copy the rendered frame to the frame buffer.
-    /// @todo Change this to a copy function in npdata?
-    memcpy((void *)npdata_frame_buffer_get(), temp_frame, NPDATA_FRAME_BUFFER_SIZE);
 }
 
 /**
@@ -192,7 +249,10 @@ void pixelkey_task_command_rx(void)
                     }
                     else
                     {
-                        p_cmd_list = p_cmd_list->p_next;
+                        // The queue owns the command now, so only the list node is freed.
+                        cmd_list_t * p_next = p_cmd_list->p_next;
+                        free(p_cmd_list);
+                        p_cmd_list = p_next;
                         tasks_queue(TASK_CMD_HANDLER);
                     }
                 }
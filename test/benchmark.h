@@ -0,0 +1,23 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * @file
+ * Timing helpers for the host benchmarks.
+ */
+
+/**
+ * Gets the current monotonic time.
+ * @return Monotonic time in nanoseconds.
+ */
+static inline uint64_t bench_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * UINT64_C(1000000000) + (uint64_t) ts.tv_nsec;
+}
+
+#endif // BENCHMARK_H
@@ -0,0 +1,330 @@
+/**
+ * @file
+ * Exhaustive color conversion accuracy and throughput benchmark.
+ *
+ * Sweeps every RGB color and the full fixed-point HSV/HSL domain through @ref color_convert2 and reports error
+ * histograms, conversion speed against the floating-point and span implementations, and color parsing speed.
+ * Results are written to stdout as JSON lines, one object per measurement, so runs can be compared by scripts;
+ * progress is written to stderr.
+ *
+ * Usage: `pixelkey_benchmark [hue_step]` where hue_step is the stride, in 1/64 degree units, of the hue sweep
+ * for the HSV and HSL domains; defaults to 1 (every fixed-point hue).
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "benchmark.h"
+#include "color.h"
+
+/** Number of histogram buckets; the last bucket holds all larger errors. */
+#define HISTOGRAM_BUCKETS   (17U)
+
+/** Total number of fixed-point hues. */
+#define HUE_RANGE_FP        (HUE_RANGE << HUE_FP_BITS)
+
+/** Number of colors converted per timed batch. */
+#define THROUGHPUT_BATCH    (1U << 16)
+
+/** Number of timed passes over each batch. */
+#define THROUGHPUT_PASSES   (256U)
+
+/** Color conversion function, as @ref color_convert2. */
+typedef void (* convert_fn_t)(color_space_t from, color_space_t to, color_kind_t const * p_in, color_kind_t * p_out);
+
+/** Error statistics for one sweep. */
+typedef struct st_error_stats
+{
+    uint64_t samples;                      ///< Number of colors compared.
+    uint64_t sum;                          ///< Sum of all errors.
+    uint32_t max;                          ///< Largest error.
+    uint64_t histogram[HISTOGRAM_BUCKETS]; ///< Count of each error value.
+} error_stats_t;
+
+static color_kind_t batch_in[THROUGHPUT_BATCH];
+static color_kind_t batch_out[THROUGHPUT_BATCH];
+static color_hsv_t span_in[THROUGHPUT_BATCH];
+static color_rgb_t span_out[THROUGHPUT_BATCH];
+
+/** Absolute difference of two unsigned values. */
+static inline uint32_t abs_diff(uint32_t a, uint32_t b)
+{
+    return (a > b) ? a - b : b - a;
+}
+
+/** Largest channel difference between two RGB colors. */
+static inline uint32_t rgb_error(color_rgb_t const * p_a, color_rgb_t const * p_b)
+{
+    uint32_t err = abs_diff(p_a->red, p_b->red);
+    uint32_t g = abs_diff(p_a->green, p_b->green);
+    uint32_t b = abs_diff(p_a->blue, p_b->blue);
+    if (g > err) { err = g; }
+    if (b > err) { err = b; }
+    return err;
+}
+
+/** Adds an error sample to a sweep's statistics. */
+static void stats_add(error_stats_t * p_stats, uint32_t err)
+{
+    p_stats->samples++;
+    p_stats->sum += err;
+    if (err > p_stats->max)
+    {
+        p_stats->max = err;
+    }
+    p_stats->histogram[(err < HISTOGRAM_BUCKETS - 1U) ? err : HISTOGRAM_BUCKETS - 1U]++;
+}
+
+/** Writes a sweep's statistics as a JSON line. */
+static void stats_print(char const * direction, char const * metric, char const * units, error_stats_t const * p_stats)
+{
+    printf("{\"suite\":\"color_accuracy\",\"direction\":\"%s\",\"metric\":\"%s\",\"units\":\"%s\","
+           "\"samples\":%llu,\"max\":%u,\"mean\":%.6f,\"histogram\":[",
+           direction, metric, units, (unsigned long long) p_stats->samples, p_stats->max,
+           (p_stats->samples > 0) ? (double) p_stats->sum / (double) p_stats->samples : 0.0);
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        printf("%s%llu", (i > 0) ? "," : "", (unsigned long long) p_stats->histogram[i]);
+    }
+    printf("]}\n");
+    fflush(stdout);
+}
+
+/** RGB -> space -> RGB round trip error in RGB units. */
+static uint32_t rgb_round_trip_error(color_rgb_t rgb, color_space_t space)
+{
+    color_kind_t mid, out;
+    color_convert2(COLOR_SPACE_RGB, space, (color_kind_t const *) &rgb, &mid);
+    color_convert2(space, COLOR_SPACE_RGB, &mid, &out);
+    return rgb_error(&rgb, &out.rgb);
+}
+
+/** Error of space -> RGB against the floating-point reference, in RGB units. */
+static uint32_t to_rgb_error(color_kind_t const * p_in, color_space_t space)
+{
+    color_kind_t out, ref;
+    color_convert2(space, COLOR_SPACE_RGB, p_in, &out);
+    color_convert2_f32(space, COLOR_SPACE_RGB, p_in, &ref);
+    return rgb_error(&out.rgb, &ref.rgb);
+}
+
+/** HSV -> HSL -> HSV round trip error in saturation/value units; hue is unchanged by these conversions. */
+static uint32_t hsv_round_trip_error(color_hsv_t hsv)
+{
+    color_kind_t mid, out;
+    color_convert2(COLOR_SPACE_HSV, COLOR_SPACE_HSL, (color_kind_t const *) &hsv, &mid);
+    color_convert2(COLOR_SPACE_HSL, COLOR_SPACE_HSV, &mid, &out);
+
+    // Saturation is meaningless when value is zero.
+    uint32_t err = abs_diff(hsv.value, out.hsv.value);
+    if (hsv.value != 0)
+    {
+        uint32_t s = abs_diff(hsv.saturation, out.hsv.saturation);
+        if (s > err) { err = s; }
+    }
+    return err;
+}
+
+/** Round trips every RGB color through HSV and HSL. */
+static void sweep_rgb(void)
+{
+    error_stats_t hsv = {0};
+    error_stats_t hsl = {0};
+
+    for (uint32_t i = 0; i < (1UL << 24); i++)
+    {
+        color_rgb_t rgb = { .red = (uint8_t) (i >> 16), .green = (uint8_t) (i >> 8), .blue = (uint8_t) i };
+        stats_add(&hsv, rgb_round_trip_error(rgb, COLOR_SPACE_HSV));
+        stats_add(&hsl, rgb_round_trip_error(rgb, COLOR_SPACE_HSL));
+
+        if ((i & 0xFFFFFU) == 0)
+        {
+            fprintf(stderr, "\rrgb sweep: %3u%%", (unsigned) (((uint64_t) i * 100U) >> 24));
+        }
+    }
+    fprintf(stderr, "\rrgb sweep: done\n");
+
+    stats_print("rgb_to_hsv", "round_trip", "rgb", &hsv);
+    stats_print("rgb_to_hsl", "round_trip", "rgb", &hsl);
+}
+
+/** Sweeps the fixed-point HSV/HSL domain against the floating-point reference. */
+static void sweep_hue_domain(uint32_t hue_step)
+{
+    error_stats_t hsv_rgb = {0};
+    error_stats_t hsl_rgb = {0};
+    error_stats_t hsv_hsl = {0};
+
+    for (uint32_t hue = 0; hue < HUE_RANGE_FP; hue += hue_step)
+    {
+        for (uint32_t s = 0; s <= SATURATION_MAX; s++)
+        {
+            for (uint32_t v = 0; v <= VALUE_MAX; v++)
+            {
+                color_kind_t in = { .hsv = { (uint16_t) hue, (uint8_t) s, (uint8_t) v } };
+                stats_add(&hsv_rgb, to_rgb_error(&in, COLOR_SPACE_HSV));
+                stats_add(&hsv_hsl, hsv_round_trip_error(in.hsv));
+
+                // HSL has the same layout and range.
+                stats_add(&hsl_rgb, to_rgb_error(&in, COLOR_SPACE_HSL));
+            }
+        }
+
+        if ((hue & 0x3FFU) == 0)
+        {
+            fprintf(stderr, "\rhue sweep: %3u%%", (unsigned) (hue * 100U / HUE_RANGE_FP));
+        }
+    }
+    fprintf(stderr, "\rhue sweep: done\n");
+
+    stats_print("hsv_to_rgb", "vs_f32", "rgb", &hsv_rgb);
+    stats_print("hsl_to_rgb", "vs_f32", "rgb", &hsl_rgb);
+    stats_print("hsv_to_hsl", "round_trip", "percent", &hsv_hsl);
+}
+
+/** Fills the throughput batch with random colors in a color space. */
+static void fill_batch(color_space_t from)
+{
+    srand(1);
+    for (size_t i = 0; i < THROUGHPUT_BATCH; i++)
+    {
+        if (from == COLOR_SPACE_RGB)
+        {
+            batch_in[i].rgb = (color_rgb_t) { .red = (uint8_t) rand(), .green = (uint8_t) rand(), .blue = (uint8_t) rand() };
+        }
+        else
+        {
+            // HSV and HSL share a layout and range.
+            batch_in[i].hsv = (color_hsv_t) { (uint16_t) ((unsigned) rand() % HUE_RANGE_FP),
+                                              (uint8_t) ((unsigned) rand() % (SATURATION_MAX + 1U)),
+                                              (uint8_t) ((unsigned) rand() % (VALUE_MAX + 1U)) };
+        }
+    }
+}
+
+/** Times conversions of the throughput batch with a conversion function; returns nanoseconds per conversion. */
+static double batch_ns(convert_fn_t fn, color_space_t from, color_space_t to)
+{
+    uint64_t start = bench_ns();
+    for (size_t pass = 0; pass < THROUGHPUT_PASSES; pass++)
+    {
+        for (size_t i = 0; i < THROUGHPUT_BATCH; i++)
+        {
+            fn(from, to, &batch_in[i], &batch_out[i]);
+        }
+    }
+    uint64_t end = bench_ns();
+
+    return (double) (end - start) / ((double) THROUGHPUT_PASSES * THROUGHPUT_BATCH);
+}
+
+/** Times conversions of the throughput batch and its f32 and fixed-point forms and writes the result as a JSON line. */
+static void throughput(char const * direction, color_space_t from, color_space_t to)
+{
+    fill_batch(from);
+
+    const double ns = batch_ns(color_convert2, from, to);
+    const double f32_ns = batch_ns(color_convert2_f32, from, to);
+    const double fp_ns = batch_ns(color_convert2_fp, from, to);
+
+    const uint64_t samples = (uint64_t) THROUGHPUT_PASSES * THROUGHPUT_BATCH;
+    printf("{\"suite\":\"color_throughput\",\"direction\":\"%s\",\"samples\":%llu,\"ns_per_conversion\":%.3f,"
+           "\"f32_ns_per_conversion\":%.3f,\"fp_ns_per_conversion\":%.3f}\n",
+           direction, (unsigned long long) samples, ns, f32_ns, fp_ns);
+    fflush(stdout);
+}
+
+/** Times HSV to RGB conversions of the throughput batch one at a time and as a span and writes a JSON line. */
+static void span_throughput(void)
+{
+    fill_batch(COLOR_SPACE_HSV);
+    for (size_t i = 0; i < THROUGHPUT_BATCH; i++)
+    {
+        span_in[i] = batch_in[i].hsv;
+    }
+
+    const double single_ns = batch_ns(color_convert2, COLOR_SPACE_HSV, COLOR_SPACE_RGB);
+
+    uint64_t start = bench_ns();
+    for (size_t pass = 0; pass < THROUGHPUT_PASSES; pass++)
+    {
+        color_convert_hsv_to_rgb_n(span_in, span_out, THROUGHPUT_BATCH);
+    }
+    uint64_t end = bench_ns();
+
+    const uint64_t samples = (uint64_t) THROUGHPUT_PASSES * THROUGHPUT_BATCH;
+    printf("{\"suite\":\"color_span_throughput\",\"direction\":\"hsv_to_rgb\",\"samples\":%llu,"
+           "\"single_ns_per_conversion\":%.3f,\"span_ns_per_conversion\":%.3f}\n",
+           (unsigned long long) samples, single_ns, (double) (end - start) / (double) samples);
+    fflush(stdout);
+}
+
+/** Times parsing of each color string format and writes the results as JSON lines; returns false on a parse error. */
+static bool parse_throughput(void)
+{
+    static char const * const inputs[] =
+    {
+        "#FF8000", "%100,50,0", "!120.5,50,25", "!!60,100,50", "magenta", "off",
+    };
+
+    const uint64_t samples = (uint64_t) THROUGHPUT_PASSES * THROUGHPUT_BATCH;
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++)
+    {
+        const size_t len = strlen(inputs[i]);
+        color_t color;
+        uint64_t consumed = 0;
+
+        uint64_t start = bench_ns();
+        for (uint64_t pass = 0; pass < samples; pass++)
+        {
+            consumed += color_parse_n(inputs[i], len, &color);
+        }
+        uint64_t end = bench_ns();
+
+        if (consumed != len * samples)
+        {
+            fprintf(stderr, "failed to parse %s\n", inputs[i]);
+            return false;
+        }
+
+        printf("{\"suite\":\"color_parse_throughput\",\"input\":\"%s\",\"samples\":%llu,\"ns_per_parse\":%.3f}\n",
+               inputs[i], (unsigned long long) samples, (double) (end - start) / (double) samples);
+        fflush(stdout);
+    }
+
+    return true;
+}
+
+int main(int argc, char const * argv[])
+{
+    uint32_t hue_step = 1;
+    if (argc > 1)
+    {
+        hue_step = (uint32_t) strtoul(argv[1], NULL, 0);
+        if (hue_step == 0)
+        {
+            fprintf(stderr, "usage: %s [hue_step]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    throughput("hsv_to_rgb", COLOR_SPACE_HSV, COLOR_SPACE_RGB);
+    throughput("hsl_to_rgb", COLOR_SPACE_HSL, COLOR_SPACE_RGB);
+    throughput("rgb_to_hsv", COLOR_SPACE_RGB, COLOR_SPACE_HSV);
+    throughput("rgb_to_hsl", COLOR_SPACE_RGB, COLOR_SPACE_HSL);
+    throughput("hsv_to_hsl", COLOR_SPACE_HSV, COLOR_SPACE_HSL);
+    throughput("hsl_to_hsv", COLOR_SPACE_HSL, COLOR_SPACE_HSV);
+    span_throughput();
+    if (!parse_throughput())
+    {
+        return 1;
+    }
+
+    sweep_rgb();
+    sweep_hue_domain(hue_step);
+
+    return 0;
+}
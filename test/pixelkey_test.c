@@ -16,6 +16,13 @@ static void runAllTests(void)
 {
     RUN_TEST_GROUP(color);
     RUN_TEST_GROUP(command_parse);
+    RUN_TEST_GROUP(palette);
+    RUN_TEST_GROUP(keyframe_processor);
+    RUN_TEST_GROUP(keyframe_pool);
+    RUN_TEST_GROUP(keyframe_timeline);
+    RUN_TEST_GROUP(framerate_governor);
+    RUN_TEST_GROUP(segment);
+    RUN_TEST_GROUP(pixel_map);
 
 #if TEST_PRINT_BEZIER_CURVE
     RUN_TEST_GROUP(keyframe_fade);
@@ -360,6 +360,274 @@ TEST(color, hsl_to_hsv)
     TEST_ASSERT_COLOR_COMPARE_HSL_HSV(((color_hsl_t) {   0,   0,   0 }), ((color_hsv_t) {   0,   0,   0 }));
 }
 
+TEST(color, fp_matches_f32)
+{
+    // Sweep the HSV/HSL domain on whole-degree hues.
+    for (uint16_t hue = 0; hue < HUE(HUE_RANGE); hue += HUE(1))
+    {
+        for (uint8_t s = 0; s <= SATURATION_MAX; s++)
+        {
+            for (uint8_t x = 0; x <= VALUE_MAX; x++)
+            {
+                color_kind_t in = { .hsv = { hue, s, x } };
+                color_kind_t out_f32, out_fp;
+
+                color_convert2_f32(COLOR_SPACE_HSV, COLOR_SPACE_RGB, &in, &out_f32);
+                color_convert2_fp(COLOR_SPACE_HSV, COLOR_SPACE_RGB, &in, &out_fp);
+                TEST_ASSERT_UINT8_WITHIN(1, out_f32.rgb.red, out_fp.rgb.red);
+                TEST_ASSERT_UINT8_WITHIN(1, out_f32.rgb.green, out_fp.rgb.green);
+                TEST_ASSERT_UINT8_WITHIN(1, out_f32.rgb.blue, out_fp.rgb.blue);
+
+                color_convert2_f32(COLOR_SPACE_HSL, COLOR_SPACE_RGB, &in, &out_f32);
+                color_convert2_fp(COLOR_SPACE_HSL, COLOR_SPACE_RGB, &in, &out_fp);
+                TEST_ASSERT_UINT8_WITHIN(1, out_f32.rgb.red, out_fp.rgb.red);
+                TEST_ASSERT_UINT8_WITHIN(1, out_f32.rgb.green, out_fp.rgb.green);
+                TEST_ASSERT_UINT8_WITHIN(1, out_f32.rgb.blue, out_fp.rgb.blue);
+            }
+        }
+    }
+
+    // Sweep a coarse RGB grid.
+    for (unsigned r = 0; r <= RGB_MAX; r += 5)
+    {
+        for (unsigned g = 0; g <= RGB_MAX; g += 5)
+        {
+            for (unsigned b = 0; b <= RGB_MAX; b += 5)
+            {
+                color_kind_t in = { .rgb = { .red = (uint8_t) r, .green = (uint8_t) g, .blue = (uint8_t) b } };
+                color_kind_t out_f32, out_fp;
+
+                color_convert2_f32(COLOR_SPACE_RGB, COLOR_SPACE_HSV, &in, &out_f32);
+                color_convert2_fp(COLOR_SPACE_RGB, COLOR_SPACE_HSV, &in, &out_fp);
+                TEST_ASSERT_UINT16_WITHIN((1U << HUE_FP_BITS), out_f32.hsv.hue, out_fp.hsv.hue);
+                TEST_ASSERT_UINT8_WITHIN(1, out_f32.hsv.saturation, out_fp.hsv.saturation);
+                TEST_ASSERT_UINT8_WITHIN(1, out_f32.hsv.value, out_fp.hsv.value);
+
+                color_convert2_f32(COLOR_SPACE_RGB, COLOR_SPACE_HSL, &in, &out_f32);
+                color_convert2_fp(COLOR_SPACE_RGB, COLOR_SPACE_HSL, &in, &out_fp);
+                TEST_ASSERT_UINT16_WITHIN((1U << HUE_FP_BITS), out_f32.hsl.hue, out_fp.hsl.hue);
+                TEST_ASSERT_UINT8_WITHIN(1, out_f32.hsl.lightness, out_fp.hsl.lightness);
+                // The float path truncates near-black and near-white lightness to 0/100 and drops the saturation.
+                if (out_f32.hsl.lightness != 0 && out_f32.hsl.lightness != LIGHTNESS_MAX)
+                {
+                    TEST_ASSERT_UINT8_WITHIN(1, out_f32.hsl.saturation, out_fp.hsl.saturation);
+                }
+            }
+        }
+    }
+}
+
+TEST(color, span_matches_single)
+{
+    color_hsv_t hsv[HUE_RANGE];
+    color_hsl_t hsl[HUE_RANGE];
+    color_rgb_t rgb[HUE_RANGE];
+    color_hsv_t hsv_out[HUE_RANGE];
+    color_hsl_t hsl_out[HUE_RANGE];
+    color_rgb_t rgb_out[HUE_RANGE];
+
+    for (uint16_t i = 0; i < HUE_RANGE; i++)
+    {
+        hsv[i] = (color_hsv_t) { HUE(i), (uint8_t) (i % (SATURATION_MAX + 1U)), (uint8_t) ((i * 7U) % (VALUE_MAX + 1U)) };
+        hsl[i] = (color_hsl_t) { HUE(i), (uint8_t) (i % (SATURATION_MAX + 1U)), (uint8_t) ((i * 7U) % (LIGHTNESS_MAX + 1U)) };
+        rgb[i] = (color_rgb_t) { .red = (uint8_t) i, .green = (uint8_t) (i * 3U), .blue = (uint8_t) (i * 11U) };
+    }
+
+    color_convert_hsv_to_rgb_n(hsv, rgb_out, HUE_RANGE);
+    for (uint16_t i = 0; i < HUE_RANGE; i++)
+    {
+        color_kind_t out;
+        color_convert2(COLOR_SPACE_HSV, COLOR_SPACE_RGB, (color_kind_t *) &hsv[i], &out);
+        TEST_ASSERT_EQUAL_MEMORY(&out.rgb, &rgb_out[i], sizeof(color_rgb_t));
+    }
+
+    color_convert_hsl_to_rgb_n(hsl, rgb_out, HUE_RANGE);
+    for (uint16_t i = 0; i < HUE_RANGE; i++)
+    {
+        color_kind_t out;
+        color_convert2(COLOR_SPACE_HSL, COLOR_SPACE_RGB, (color_kind_t *) &hsl[i], &out);
+        TEST_ASSERT_EQUAL_MEMORY(&out.rgb, &rgb_out[i], sizeof(color_rgb_t));
+    }
+
+    color_convert_rgb_to_hsv_n(rgb, hsv_out, HUE_RANGE);
+    color_convert_rgb_to_hsl_n(rgb, hsl_out, HUE_RANGE);
+    for (uint16_t i = 0; i < HUE_RANGE; i++)
+    {
+        color_kind_t out;
+        color_convert2(COLOR_SPACE_RGB, COLOR_SPACE_HSV, (color_kind_t *) &rgb[i], &out);
+        TEST_ASSERT_EQUAL_MEMORY(&out.hsv, &hsv_out[i], sizeof(color_hsv_t));
+        color_convert2(COLOR_SPACE_RGB, COLOR_SPACE_HSL, (color_kind_t *) &rgb[i], &out);
+        TEST_ASSERT_EQUAL_MEMORY(&out.hsl, &hsl_out[i], sizeof(color_hsl_t));
+    }
+}
+
+TEST(color, output_table)
+{
+    color_rgb_t in[3] = {
+        { .red = 0,   .green = 128, .blue = 255 },
+        { .red = 255, .green = 255, .blue = 255 },
+        { .red = 64,  .green = 1,   .blue = 200 },
+    };
+    color_rgb_t out[3];
+
+    // No gamma and full brightness is the identity.
+    color_output_build(false, 2.0f, UINT8_MAX);
+    color_output_apply_n(in, out, 3);
+    TEST_ASSERT_EQUAL_MEMORY(in, out, sizeof(in));
+
+    // Brightness only scales linearly.
+    color_output_build(false, 2.0f, 128);
+    color_output_apply_n(in, out, 3);
+    TEST_ASSERT_EQUAL(0, out[0].red);
+    TEST_ASSERT_EQUAL(64, out[0].green);
+    TEST_ASSERT_EQUAL(128, out[0].blue);
+    TEST_ASSERT_EQUAL(128, out[1].red);
+
+    // Gamma and brightness are folded together.
+    color_output_build(true, 2.0f, 128);
+    color_output_apply_n(in, out, 3);
+    TEST_ASSERT_EQUAL(0, out[0].red);
+    TEST_ASSERT_EQUAL(32, out[0].green);
+    TEST_ASSERT_EQUAL(128, out[0].blue);
+    TEST_ASSERT_EQUAL(8, out[2].red);
+
+    // In-place mapping is allowed.
+    color_output_apply_n(in, in, 3);
+    TEST_ASSERT_EQUAL_MEMORY(out, in, sizeof(in));
+}
+
+TEST(color, blend)
+{
+    const color_rgb_t below = { .red = 200, .green = 100, .blue = 0 };
+    const color_rgb_t above[2] = {
+        { .red = 100, .green = 200, .blue = 255 },
+        { .red = 100, .green = 200, .blue = 255 },
+    };
+    const uint8_t opacity[2] = { UINT8_MAX, 0 };
+
+    const struct
+    {
+        color_blend_t blend;
+        color_rgb_t   expected;
+    } cases[] = {
+        { COLOR_BLEND_REPLACE,  { .red = 100, .green = 200, .blue = 255 } },
+        { COLOR_BLEND_ADD,      { .red = 255, .green = 255, .blue = 255 } },
+        { COLOR_BLEND_MULTIPLY, { .red = 79,  .green = 79,  .blue = 0 } },
+        { COLOR_BLEND_MAX,      { .red = 200, .green = 200, .blue = 255 } },
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        color_rgb_t dst[2] = { below, below };
+        color_blend_n(cases[i].blend, above, opacity, dst, 2);
+        TEST_ASSERT_EQUAL_MEMORY(&cases[i].expected, &dst[0], sizeof(color_rgb_t));
+
+        // A transparent color leaves the color beneath.
+        TEST_ASSERT_EQUAL_MEMORY(&below, &dst[1], sizeof(color_rgb_t));
+    }
+
+    // Partial opacity mixes the blended color with the color beneath.
+    const uint8_t half[2] = { 128, 128 };
+    color_rgb_t dst[2] = { below, below };
+    color_blend_n(COLOR_BLEND_REPLACE, above, half, dst, 2);
+    TEST_ASSERT_EQUAL(150, dst[0].red);
+    TEST_ASSERT_EQUAL(150, dst[0].green);
+    TEST_ASSERT_EQUAL(128, dst[0].blue);
+}
+
+TEST(color, parse)
+{
+    color_t color;
+
+    TEST_ASSERT_TRUE(color_parse("#FF8001", &color));
+    TEST_ASSERT_EQUAL(COLOR_SPACE_RGB, color.color_space);
+    TEST_ASSERT_EQUAL(0xFF, color.rgb.red);
+    TEST_ASSERT_EQUAL(0x80, color.rgb.green);
+    TEST_ASSERT_EQUAL(0x01, color.rgb.blue);
+
+    TEST_ASSERT_TRUE(color_parse("%100,50,0", &color));
+    TEST_ASSERT_EQUAL(COLOR_SPACE_RGB, color.color_space);
+    TEST_ASSERT_EQUAL(255, color.rgb.red);
+    TEST_ASSERT_EQUAL(127, color.rgb.green);
+    TEST_ASSERT_EQUAL(0, color.rgb.blue);
+
+    TEST_ASSERT_TRUE(color_parse("!120.5,50,25", &color));
+    TEST_ASSERT_EQUAL(COLOR_SPACE_HSV, color.color_space);
+    TEST_ASSERT_EQUAL(HUE(120) + (1U << (HUE_FP_BITS - 1)), color.hsv.hue);
+    TEST_ASSERT_EQUAL(50, color.hsv.saturation);
+    TEST_ASSERT_EQUAL(25, color.hsv.value);
+
+    // HSV shortcuts.
+    TEST_ASSERT_TRUE(color_parse("!240", &color));
+    TEST_ASSERT_EQUAL(HUE(240), color.hsv.hue);
+    TEST_ASSERT_EQUAL(SATURATION_MAX, color.hsv.saturation);
+    TEST_ASSERT_EQUAL(VALUE_MAX, color.hsv.value);
+    TEST_ASSERT_TRUE(color_parse("!240,30", &color));
+    TEST_ASSERT_EQUAL(SATURATION_MAX, color.hsv.saturation);
+    TEST_ASSERT_EQUAL(30, color.hsv.value);
+
+    TEST_ASSERT_TRUE(color_parse("!!60,100,50", &color));
+    TEST_ASSERT_EQUAL(COLOR_SPACE_HSL, color.color_space);
+    TEST_ASSERT_EQUAL(HUE(60), color.hsl.hue);
+    TEST_ASSERT_EQUAL(100, color.hsl.saturation);
+    TEST_ASSERT_EQUAL(50, color.hsl.lightness);
+
+    TEST_ASSERT_TRUE(color_parse("magenta", &color));
+    TEST_ASSERT_EQUAL_MEMORY(&color_magenta, &color, sizeof(color));
+
+    // Invalid colors.
+    TEST_ASSERT_FALSE(color_parse("", &color));
+    TEST_ASSERT_FALSE(color_parse("#FF80", &color));
+    TEST_ASSERT_FALSE(color_parse("#FF80G0", &color));
+    TEST_ASSERT_FALSE(color_parse("#FF800000", &color));
+    TEST_ASSERT_FALSE(color_parse("%101,0,0", &color));
+    TEST_ASSERT_FALSE(color_parse("%50,50", &color));
+    TEST_ASSERT_FALSE(color_parse("!360", &color));
+    TEST_ASSERT_FALSE(color_parse("!12.", &color));
+    TEST_ASSERT_FALSE(color_parse("!!60,100", &color));
+    TEST_ASSERT_FALSE(color_parse("!60,50,50,50", &color));
+    TEST_ASSERT_FALSE(color_parse("mauve", &color));
+    TEST_ASSERT_FALSE(color_parse("re", &color));
+}
+
+TEST(color, parse_n)
+{
+    char const list[] = "#00FF00:red:!!90,50,50 tail";
+    color_t color;
+
+    // Parsing stops at the end of each color and does not need a terminator.
+    TEST_ASSERT_EQUAL(7, color_parse_n(list, sizeof(list) - 1, &color));
+    TEST_ASSERT_EQUAL(0xFF, color.rgb.green);
+    TEST_ASSERT_EQUAL(3, color_parse_n(&list[8], sizeof(list) - 9, &color));
+    TEST_ASSERT_EQUAL_MEMORY(&color_red, &color, sizeof(color));
+    TEST_ASSERT_EQUAL(10, color_parse_n(&list[12], sizeof(list) - 13, &color));
+    TEST_ASSERT_EQUAL(COLOR_SPACE_HSL, color.color_space);
+
+    // The view length is honored.
+    TEST_ASSERT_EQUAL(0, color_parse_n(list, 5, &color));
+    TEST_ASSERT_EQUAL(0, color_parse_n(&list[8], 2, &color));
+    TEST_ASSERT_EQUAL(4, color_parse_n(&list[12], 4, &color));
+    TEST_ASSERT_EQUAL(HUE(90), color.hsl.hue);
+}
+
+TEST(color, lerp)
+{
+    const color_rgb_t from[2] = { { .red = 0, .green = 100, .blue = 255 }, { .red = 10, .green = 10, .blue = 10 } };
+    const color_rgb_t to[2] = { { .red = 255, .green = 200, .blue = 0 }, { .red = 10, .green = 10, .blue = 10 } };
+    color_rgb_t out[2];
+
+    color_lerp_n(from, to, 0, out, 2);
+    TEST_ASSERT_EQUAL_MEMORY(from, out, sizeof(out));
+    color_lerp_n(from, to, COLOR_LERP_WEIGHT_MAX, out, 2);
+    TEST_ASSERT_EQUAL_MEMORY(to, out, sizeof(out));
+
+    color_lerp_n(from, to, COLOR_LERP_WEIGHT_MAX / 4U, out, 2);
+    TEST_ASSERT_EQUAL(64, out[0].red);
+    TEST_ASSERT_EQUAL(125, out[0].green);
+    TEST_ASSERT_EQUAL(191, out[0].blue);
+    TEST_ASSERT_EQUAL_MEMORY(&from[1], &out[1], sizeof(color_rgb_t));
+}
+
 TEST_GROUP_RUNNER(color)
 {
     RUN_TEST_CASE(color, hsv_to_rgb);
@@ -368,4 +636,11 @@ TEST_GROUP_RUNNER(color)
     RUN_TEST_CASE(color, rgb_to_hsv);
     RUN_TEST_CASE(color, rgb_to_hsl);
     RUN_TEST_CASE(color, hsl_to_hsv);
+    RUN_TEST_CASE(color, fp_matches_f32);
+    RUN_TEST_CASE(color, span_matches_single);
+    RUN_TEST_CASE(color, output_table);
+    RUN_TEST_CASE(color, blend);
+    RUN_TEST_CASE(color, lerp);
+    RUN_TEST_CASE(color, parse);
+    RUN_TEST_CASE(color, parse_n);
 }
@@ -5,6 +5,7 @@
 
 #include "unity_fixture.h"
 
+#include "hal_device.h"
 #include "pixelkey.h"
 #include "pixelkey_commands.h"
 #include "pixelkey_errors.h"
@@ -45,6 +46,36 @@ TEST(command_parse, invalid_inputs)
     TEST_ASSERT_NULL(p_list);
 }
 
+TEST(command_parse, cmds_fit_queue)
+{
+    char in[128] = {0};
+
+    // A string may hold as many commands as the command queue.
+    for (size_t i = 0; i < PIXELKEY_COMMAND_BUFFER_LENGTH; i++)
+    {
+        strcat(in, "$stop;");
+    }
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_command_parse(in, &p_list));
+    size_t count = 0;
+    for (cmd_list_t const * p = p_list; p != NULL; p = p->p_next)
+    {
+        count++;
+    }
+    TEST_ASSERT_EQUAL(PIXELKEY_COMMAND_BUFFER_LENGTH, count);
+
+    pixelkey_cmd_list_free(p_list);
+    p_list = NULL;
+
+    // Parsing splits the string in place, so build it again with one more command.
+    in[0] = '\0';
+    for (size_t i = 0; i <= PIXELKEY_COMMAND_BUFFER_LENGTH; i++)
+    {
+        strcat(in, "$stop;");
+    }
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_BUFFER_FULL, pixelkey_command_parse(in, &p_list));
+    TEST_ASSERT_NULL(p_list);
+}
+
 TEST(command_parse, config_get)
 {
     char in[] = "$config-get somekey";
@@ -328,6 +359,13 @@ TEST(command_parse, keyframe_blink)
     p_wrapper = (cmd_args_keyframe_wrapper_t *)p_list->p_cmd->p_args;
     TEST_ASSERT_NOT_NULL(p_wrapper->p_keyframe);
 
+    // The colors and times are lowered when parsed.
+    keyframe_blink_t const * p_blink = (keyframe_blink_t const *)p_wrapper->p_keyframe;
+    TEST_ASSERT_TRUE(p_blink->base.flags & KEYFRAME_FLAG_LOWERED);
+    TEST_ASSERT_EQUAL(COLOR_SPACE_RGB, p_blink->args.color1.color_space);
+    TEST_ASSERT_EQUAL(COLOR_SPACE_RGB, p_blink->args.color2.color_space);
+    TEST_ASSERT_EQUAL(5U * TIMESTEP_PER_SECOND, p_blink->state.finish_time);
+
     pixelkey_cmd_list_free(p_list);
     p_list = NULL;
 
@@ -391,10 +429,10 @@ TEST(command_parse, keyframe_fade)
     TEST_ASSERT_NOT_NULL(p_wrapper->p_keyframe);
 
     keyframe_fade_t * p_fade = (keyframe_fade_t *)p_wrapper->p_keyframe;
-    TEST_ASSERT_EQUAL(2, p_fade->args.colors_len);
+    TEST_ASSERT_EQUAL(2, p_fade->p_args->colors_len);
 
-    TEST_ASSERT_EQUAL(color_red.hsv.hue, p_fade->args.colors[0].hue);
-    TEST_ASSERT_EQUAL(color_blue.hsv.hue, p_fade->args.colors[1].hue);
+    TEST_ASSERT_EQUAL(color_red.hsv.hue, p_fade->p_args->colors[0].hue);
+    TEST_ASSERT_EQUAL(color_blue.hsv.hue, p_fade->p_args->colors[1].hue);
 
     pixelkey_cmd_list_free(p_list);
     p_list = NULL;
@@ -463,9 +501,187 @@ TEST(command_parse, keyframe_mod_repeat_invalid)
     TEST_ASSERT_NULL(p_list);
 }
 
+TEST(command_parse, keyframe_mod_broadcast)
+{
+    char in[64] = {0};
+
+    strcpy(in, "*");
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_command_parse(in, &p_list));
+    TEST_ASSERT_EQUAL(CMD_TYPE_KEYFRAME_MOD_BROADCAST, p_list->p_cmd->type);
+    TEST_ASSERT_NULL(p_list->p_cmd->p_args);
+
+    pixelkey_cmd_list_free(p_list);
+    p_list = NULL;
+
+    strcpy(in, "* 5");
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_TOO_MANY_ARGUMENTS, pixelkey_command_parse(in, &p_list));
+    TEST_ASSERT_NULL(p_list);
+}
+
+TEST(command_parse, keyframe_mod_layer)
+{
+    char in[64] = {0};
+    cmd_args_keyframe_mod_layer_t * p_args = NULL;
+
+    // Only the layer.
+    strcpy(in, "|1");
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_command_parse(in, &p_list));
+    TEST_ASSERT_EQUAL(CMD_TYPE_KEYFRAME_MOD_LAYER, p_list->p_cmd->type);
+    p_args = p_list->p_cmd->p_args;
+    TEST_ASSERT_EQUAL(1, p_args->layer);
+    TEST_ASSERT_FALSE(p_args->blend_provided);
+
+    pixelkey_cmd_list_free(p_list);
+    p_list = NULL;
+
+    // With a blend mode and opacity.
+    strcpy(in, "|1 ADD 50");
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_command_parse(in, &p_list));
+    p_args = p_list->p_cmd->p_args;
+    TEST_ASSERT_EQUAL(1, p_args->layer);
+    TEST_ASSERT_TRUE(p_args->blend_provided);
+    TEST_ASSERT_EQUAL(COLOR_BLEND_ADD, p_args->blend);
+    TEST_ASSERT_EQUAL(128, p_args->opacity);
+
+    pixelkey_cmd_list_free(p_list);
+    p_list = NULL;
+
+    // Opacity defaults to full.
+    strcpy(in, "|0 max");
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_command_parse(in, &p_list));
+    p_args = p_list->p_cmd->p_args;
+    TEST_ASSERT_EQUAL(COLOR_BLEND_MAX, p_args->blend);
+    TEST_ASSERT_EQUAL(UINT8_MAX, p_args->opacity);
+
+    pixelkey_cmd_list_free(p_list);
+    p_list = NULL;
+
+    strcpy(in, "|");
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NOT_ENOUGH_ARGUMENTS, pixelkey_command_parse(in, &p_list));
+    TEST_ASSERT_NULL(p_list);
+
+    strcpy(in, "|99");
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_INVALID_ARGUMENT, pixelkey_command_parse(in, &p_list));
+    TEST_ASSERT_NULL(p_list);
+
+    strcpy(in, "|1 dodge");
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_INVALID_ARGUMENT, pixelkey_command_parse(in, &p_list));
+    TEST_ASSERT_NULL(p_list);
+
+    strcpy(in, "|1 add 101");
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_INVALID_ARGUMENT, pixelkey_command_parse(in, &p_list));
+    TEST_ASSERT_NULL(p_list);
+
+    strcpy(in, "|1 add 50 2");
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_TOO_MANY_ARGUMENTS, pixelkey_command_parse(in, &p_list));
+    TEST_ASSERT_NULL(p_list);
+}
+
+TEST(command_parse, segment_set)
+{
+    char in[64] = {0};
+    cmd_args_segment_set_t * p_args = NULL;
+
+    strcpy(in, "$segment-set ambient 1-40 10");
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_command_parse(in, &p_list));
+    TEST_ASSERT_EQUAL(CMD_TYPE_SEGMENT_SET, p_list->p_cmd->type);
+    p_args = (cmd_args_segment_set_t *) p_list->p_cmd->p_args;
+    TEST_ASSERT_EQUAL_STRING("ambient", p_args->name);
+    TEST_ASSERT_EQUAL(0, p_args->first);
+    TEST_ASSERT_EQUAL(40, p_args->count);
+    TEST_ASSERT_EQUAL(10, p_args->framerate);
+
+    pixelkey_cmd_list_free(p_list);
+    p_list = NULL;
+
+    // A single channel.
+    strcpy(in, "$segment-set led 5 60");
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_command_parse(in, &p_list));
+    p_args = (cmd_args_segment_set_t *) p_list->p_cmd->p_args;
+    TEST_ASSERT_EQUAL(4, p_args->first);
+    TEST_ASSERT_EQUAL(1, p_args->count);
+
+    pixelkey_cmd_list_free(p_list);
+    p_list = NULL;
+
+    strcpy(in, "$segment-set ambient 1-40");
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NOT_ENOUGH_ARGUMENTS, pixelkey_command_parse(in, &p_list));
+    TEST_ASSERT_NULL(p_list);
+
+    strcpy(in, "$segment-set ambient 40-1 10");
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_INVALID_ARGUMENT, pixelkey_command_parse(in, &p_list));
+    TEST_ASSERT_NULL(p_list);
+
+    strcpy(in, "$segment-set ambient 0-4 10");
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_INVALID_ARGUMENT, pixelkey_command_parse(in, &p_list));
+    TEST_ASSERT_NULL(p_list);
+
+    strcpy(in, "$segment-set ambient 1-4 0");
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_INVALID_ARGUMENT, pixelkey_command_parse(in, &p_list));
+    TEST_ASSERT_NULL(p_list);
+
+    strcpy(in, "$segment-set ambient 1-4 10 2");
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_TOO_MANY_ARGUMENTS, pixelkey_command_parse(in, &p_list));
+    TEST_ASSERT_NULL(p_list);
+}
+
+TEST(command_parse, palette_set)
+{
+    char in[64] = {0};
+    cmd_args_palette_set_t * p_args = NULL;
+
+    // Indexed palette entry.
+    strcpy(in, "$palette-set warm 3 #FF8800");
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_command_parse(in, &p_list));
+    TEST_ASSERT_EQUAL(CMD_TYPE_PALETTE_SET, p_list->p_cmd->type);
+    p_args = (cmd_args_palette_set_t *) p_list->p_cmd->p_args;
+    TEST_ASSERT_EQUAL_STRING("warm", p_args->name);
+    TEST_ASSERT_EQUAL(3, p_args->index);
+    TEST_ASSERT_EQUAL(COLOR_SPACE_RGB, p_args->color.color_space);
+    TEST_ASSERT_EQUAL(0x88, p_args->color.rgb.green);
+
+    pixelkey_cmd_list_free(p_list);
+    p_list = NULL;
+
+    // Named color.
+    strcpy(in, "$palette-set Coral !16,69");
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_command_parse(in, &p_list));
+    p_args = (cmd_args_palette_set_t *) p_list->p_cmd->p_args;
+    TEST_ASSERT_EQUAL_STRING("coral", p_args->name);
+    TEST_ASSERT_EQUAL(PALETTE_INDEX_NONE, p_args->index);
+    TEST_ASSERT_EQUAL(COLOR_SPACE_HSV, p_args->color.color_space);
+
+    pixelkey_cmd_list_free(p_list);
+    p_list = NULL;
+
+    // Invalid arguments.
+    strcpy(in, "$palette-set warm");
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NOT_ENOUGH_ARGUMENTS, pixelkey_command_parse(in, &p_list));
+    strcpy(in, "$palette-set warm 255 #FF8800");
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_INVALID_ARGUMENT, pixelkey_command_parse(in, &p_list));
+    strcpy(in, "$palette-set warm 0 #FF88");
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_INVALID_ARGUMENT, pixelkey_command_parse(in, &p_list));
+    strcpy(in, "$palette-set 1warm #FF8800");
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_INVALID_ARGUMENT, pixelkey_command_parse(in, &p_list));
+    strcpy(in, "$palette-set warm 0 #FF8800 extra");
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_TOO_MANY_ARGUMENTS, pixelkey_command_parse(in, &p_list));
+    TEST_ASSERT_NULL(p_list);
+
+    // Saving is a separate command.
+    strcpy(in, "$palette-save");
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_command_parse(in, &p_list));
+    TEST_ASSERT_EQUAL(CMD_TYPE_PALETTE_SAVE, p_list->p_cmd->type);
+    pixelkey_cmd_list_free(p_list);
+    p_list = NULL;
+    strcpy(in, "$palette-save now");
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_TOO_MANY_ARGUMENTS, pixelkey_command_parse(in, &p_list));
+    TEST_ASSERT_NULL(p_list);
+}
+
 TEST_GROUP_RUNNER(command_parse)
 {
     RUN_TEST_CASE(command_parse, invalid_inputs);
+    RUN_TEST_CASE(command_parse, cmds_fit_queue);
 
     RUN_TEST_CASE(command_parse, simple_cmds);
     RUN_TEST_CASE(command_parse, simple_cmds_extra_args);
@@ -482,6 +698,8 @@ TEST_GROUP_RUNNER(command_parse)
 
     RUN_TEST_CASE(command_parse, time_set);
 
+    RUN_TEST_CASE(command_parse, palette_set);
+
     RUN_TEST_CASE(command_parse, keyframe_set);
     RUN_TEST_CASE(command_parse, keyframe_set_invalid);
     RUN_TEST_CASE(command_parse, keyframe_blink);
@@ -491,4 +709,7 @@ TEST_GROUP_RUNNER(command_parse)
 
     RUN_TEST_CASE(command_parse, keyframe_mod_repeat);
     RUN_TEST_CASE(command_parse, keyframe_mod_repeat_invalid);
+    RUN_TEST_CASE(command_parse, keyframe_mod_broadcast);
+    RUN_TEST_CASE(command_parse, keyframe_mod_layer);
+    RUN_TEST_CASE(command_parse, segment_set);
 }
@@ -0,0 +1,133 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "unity_fixture.h"
+
+#include "keyframes.h"
+#include "framerate_governor.h"
+
+/** Cost of a frame as a percentage of the period at a framerate. */
+#define COST(percent, framerate)    ((timestep_t) (((percent) * TIMESTEP_PER_SECOND) / (100U * (framerate))))
+
+/**
+ * Feeds the same frame cost to the governor several times.
+ * @param cost  The cost of each frame.
+ * @param count Number of frames.
+ * @return Number of times the framerate changed.
+ */
+static uint32_t sample_repeat(timestep_t cost, uint32_t count)
+{
+    uint32_t changes = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        framerate_t framerate;
+        if (framerate_governor_sample(cost, &framerate))
+        {
+            TEST_ASSERT_EQUAL(framerate_governor_framerate_get(), framerate);
+            changes++;
+        }
+    }
+
+    return changes;
+}
+
+TEST_GROUP(framerate_governor);
+
+TEST_SETUP(framerate_governor)
+{
+    framerate_governor_init(true, 60, 10, 60);
+}
+
+TEST_TEAR_DOWN(framerate_governor)
+{
+}
+
+TEST(framerate_governor, disabled_only_measures)
+{
+    // The configured framerate is used as-is, even out of bounds.
+    framerate_governor_init(false, 100, 10, 60);
+    TEST_ASSERT_EQUAL(100, framerate_governor_framerate_get());
+
+    TEST_ASSERT_EQUAL(0, sample_repeat(COST(200U, 100U), 64));
+    TEST_ASSERT_EQUAL(100, framerate_governor_framerate_get());
+    TEST_ASSERT_TRUE(framerate_governor_load_get() > 150U);
+}
+
+TEST(framerate_governor, init_clamps)
+{
+    framerate_governor_init(true, 100, 10, 60);
+    TEST_ASSERT_EQUAL(60, framerate_governor_framerate_get());
+
+    framerate_governor_init(true, 5, 10, 60);
+    TEST_ASSERT_EQUAL(10, framerate_governor_framerate_get());
+
+    // A maximum below the minimum pins the framerate to the minimum.
+    framerate_governor_init(true, 30, 20, 10);
+    TEST_ASSERT_EQUAL(20, framerate_governor_framerate_get());
+}
+
+TEST(framerate_governor, steady_load_holds)
+{
+    TEST_ASSERT_EQUAL(0, sample_repeat(COST(75U, 60U), 256));
+    TEST_ASSERT_EQUAL(60, framerate_governor_framerate_get());
+}
+
+TEST(framerate_governor, overload_lowers)
+{
+    // Each frame costs 1.5 periods at 60 fps; the target load is met at 30 fps.
+    sample_repeat(COST(150U, 60U), 64);
+    TEST_ASSERT_TRUE(framerate_governor_framerate_get() < 60U);
+    TEST_ASSERT_TRUE(framerate_governor_framerate_get() >= 10U);
+
+    // It settles once the cost fits the period.
+    const framerate_t settled = framerate_governor_framerate_get();
+    TEST_ASSERT_EQUAL(0, sample_repeat(COST(150U, 60U), 256));
+    TEST_ASSERT_EQUAL(settled, framerate_governor_framerate_get());
+    TEST_ASSERT_TRUE(framerate_governor_load_get() <= FRAMERATE_GOVERNOR_LOAD_HIGH);
+    TEST_ASSERT_TRUE(settled <= 40U);
+}
+
+TEST(framerate_governor, overload_stops_at_min)
+{
+    sample_repeat(TIMESTEP_PER_SECOND, 256);
+    TEST_ASSERT_EQUAL(10, framerate_governor_framerate_get());
+}
+
+TEST(framerate_governor, headroom_raises)
+{
+    framerate_governor_init(true, 10, 10, 60);
+
+    // Raising needs sustained headroom.
+    TEST_ASSERT_EQUAL(0, sample_repeat(COST(10U, 60U), FRAMERATE_GOVERNOR_RAISE_SAMPLES - 1U));
+    TEST_ASSERT_EQUAL(10, framerate_governor_framerate_get());
+    TEST_ASSERT_EQUAL(1, sample_repeat(COST(10U, 60U), 1));
+    TEST_ASSERT_TRUE(framerate_governor_framerate_get() > 10U);
+
+    // Keeps stepping up to the maximum.
+    sample_repeat(COST(10U, 60U), 64U * FRAMERATE_GOVERNOR_RAISE_SAMPLES);
+    TEST_ASSERT_EQUAL(60, framerate_governor_framerate_get());
+}
+
+TEST(framerate_governor, headroom_stops_at_target)
+{
+    framerate_governor_init(true, 10, 10, 60);
+
+    // Each frame costs 75 % at 30 fps so the governor should not go any higher.
+    sample_repeat(COST(75U, 30U), 64U * FRAMERATE_GOVERNOR_RAISE_SAMPLES);
+    TEST_ASSERT_TRUE(framerate_governor_framerate_get() <= 30U);
+    TEST_ASSERT_TRUE(framerate_governor_framerate_get() >= 20U);
+}
+
+TEST_GROUP_RUNNER(framerate_governor)
+{
+    RUN_TEST_CASE(framerate_governor, disabled_only_measures);
+    RUN_TEST_CASE(framerate_governor, init_clamps);
+    RUN_TEST_CASE(framerate_governor, steady_load_holds);
+    RUN_TEST_CASE(framerate_governor, overload_lowers);
+    RUN_TEST_CASE(framerate_governor, overload_stops_at_min);
+    RUN_TEST_CASE(framerate_governor, headroom_raises);
+    RUN_TEST_CASE(framerate_governor, headroom_stops_at_target);
+}
@@ -9,21 +9,28 @@
 #include "pixelkey.h"
 #include "pixelkey_commands.h"
 #include "pixelkey_errors.h"
+#include "hal_device.h"
+#include "arena.h"
 
 #include "keyframes.h"
+#include "keyframe_pool.h"
 
 #include "color.h"
 
 #define FRAMERATE 60
 
 keyframe_fade_t fade;
+keyframe_fade_args_storage_t fade_args;
 keyframe_base_t * p_keyframe = NULL;
 
+/** Pixel arena for the tests which push fades to every NeoPixel. */
+static uint8_t arena_mem[16384] ALIGN(8);
+
 TEST_GROUP(keyframe_fade);
 
 TEST_SETUP(keyframe_fade)
 {
-    p_keyframe = keyframe_fade_ctor(&fade);
+    p_keyframe = keyframe_fade_ctor(&fade, &fade_args.args, false);
 }
 
 TEST_TEAR_DOWN(keyframe_fade)
@@ -33,20 +40,20 @@ TEST_TEAR_DOWN(keyframe_fade)
 
 static void test_curve(color_hsv_t color1, color_hsv_t color2, cubic_bezier_t const * const curve)
 {
-    fade.args.colors_len = 2;
-    fade.args.colors[0] = color1;
-    fade.args.colors[1] = color2;
-    fade.args.curve = *curve;
-    fade.args.fade_type = FADE_TYPE_CUBIC;
-    fade.args.period = 1;
-    fade.args.push_current = false;
+    fade_args.args.colors_len = 2;
+    fade_args.args.colors[0] = color1;
+    fade_args.args.colors[1] = color2;
+    fade_args.args.curve = *curve;
+    fade_args.args.fade_type = FADE_TYPE_CUBIC;
+    fade_args.args.period = 1;
+    fade_args.args.push_current = false;
 
-    fade.base.p_api->render_init(p_keyframe, FRAMERATE, (color_rgb_t){ 0, 0, 0});
+    fade.base.p_api->render_init(p_keyframe, (color_rgb_t){ 0, 0, 0});
 
     color_rgb_t output[FRAMERATE] = {0};  // Do one whole frame
     for (int i = 0; i < FRAMERATE; i++)
     {
-        fade.base.p_api->render_frame(p_keyframe, i, &output[i]);
+        fade.base.p_api->render_frame(p_keyframe, (timestep_t) i * (TIMESTEP_PER_SECOND / FRAMERATE), &output[i]);
     }
 
     printf("\n");
@@ -84,6 +91,199 @@ TEST(keyframe_fade, ease_in_out)
     test_curve(color_red.hsv, color_blue.hsv, &cb_ease_in_out);
 }
 
+TEST(keyframe_fade, seek)
+{
+    fade_args.args.colors_len = 3;
+    fade_args.args.colors[0] = color_red.hsv;
+    fade_args.args.colors[1] = color_blue.hsv;
+    fade_args.args.colors[2] = color_green.hsv;
+    fade_args.args.curve = cb_ease_in_out;
+    fade_args.args.fade_type = FADE_TYPE_CUBIC;
+    fade_args.args.period = 1;
+    fade_args.args.push_current = false;
+    fade.base.p_api->render_init(p_keyframe, (color_rgb_t){ 0, 0, 0});
+
+    color_rgb_t forward[FRAMERATE + 1];
+    for (int i = 0; i <= FRAMERATE; i++)
+    {
+        fade.base.p_api->render_frame(p_keyframe, (timestep_t) i * (TIMESTEP_PER_SECOND / FRAMERATE), &forward[i]);
+    }
+
+    // Rendering backwards, or any single time, gives the same colors as rendering every frame in order.
+    for (int i = FRAMERATE; i >= 0; i--)
+    {
+        color_rgb_t color;
+        const bool finished = fade.base.p_api->render_frame(p_keyframe, (timestep_t) i * (TIMESTEP_PER_SECOND / FRAMERATE), &color);
+        TEST_ASSERT_EQUAL_MEMORY(&forward[i], &color, sizeof(color));
+        TEST_ASSERT_FALSE(finished);
+    }
+
+    // The curve is symmetric so half way between two colors is an even blend.
+    color_hsv_t color;
+    fade.base.p_api->render_frame_hsv(p_keyframe, TIMESTEP_PER_SECOND / 4U, &color);
+    TEST_ASSERT_UINT16_WITHIN(HUE_F32(1.0f), HUE_F32(300.0f), color.hue);
+
+    // The last color is held once the fade has finished.
+    TEST_ASSERT_TRUE(fade.base.p_api->render_frame_hsv(p_keyframe, 2U * TIMESTEP_PER_SECOND, &color));
+    TEST_ASSERT_EQUAL_MEMORY(&color_green.hsv, &color, sizeof(color));
+}
+
+TEST(keyframe_fade, clones_share_args)
+{
+    char in[] = "1 &red:blue";
+    keyframe_base_t * p_parsed = keyframe_fade_parse(in);
+    TEST_ASSERT_NOT_NULL(p_parsed);
+    keyframe_fade_args_t const * const p_args = ((keyframe_fade_t const *) p_parsed)->p_args;
+    TEST_ASSERT_TRUE(p_args->lowered);
+
+    // Room is made for the current color, and the times are known before the keyframe is initialized.
+    TEST_ASSERT_EQUAL(3, p_args->colors_len);
+    TEST_ASSERT_EQUAL_MEMORY(&color_red.hsv, &p_args->colors[1], sizeof(color_hsv_t));
+    TEST_ASSERT_EQUAL_MEMORY(&color_blue.hsv, &p_args->colors[2], sizeof(color_hsv_t));
+    TEST_ASSERT_EQUAL(TIMESTEP_PER_SECOND / 2U, p_args->pair_period);
+
+    // A clone shares the arguments and only adds the current color.
+    keyframe_base_t * p_clone = p_parsed->p_api->clone(p_parsed);
+    TEST_ASSERT_NOT_NULL(p_clone);
+    TEST_ASSERT_TRUE(((keyframe_fade_t const *) p_clone)->p_args == p_args);
+    TEST_ASSERT_EQUAL(2, p_args->refs);
+    color_t green;
+    color_convert(COLOR_SPACE_RGB, &color_green, &green);
+    p_clone->p_api->render_init(p_clone, green.rgb);
+
+    color_hsv_t color;
+    TEST_ASSERT_FALSE(p_clone->p_api->render_frame_hsv(p_clone, 0, &color));
+    TEST_ASSERT_EQUAL(color_green.hsv.hue, color.hue);
+    TEST_ASSERT_FALSE(p_clone->p_api->render_frame_hsv(p_clone, TIMESTEP_PER_SECOND / 2U, &color));
+    TEST_ASSERT_EQUAL_MEMORY(&color_red.hsv, &color, sizeof(color));
+    TEST_ASSERT_TRUE(p_clone->p_api->render_frame_hsv(p_clone, TIMESTEP_PER_SECOND, &color));
+    TEST_ASSERT_EQUAL_MEMORY(&color_blue.hsv, &color, sizeof(color));
+
+    // The arguments are kept until the last keyframe sharing them is destroyed.
+    keyframe_pool_stats_t before, after;
+    keyframe_pool_stats_get(KEYFRAME_POOL_FADE_ARGS_SHORT, &before);
+    keyframe_destroy(p_clone);
+    TEST_ASSERT_EQUAL(1, p_args->refs);
+    keyframe_destroy(p_parsed);
+    keyframe_pool_stats_get(KEYFRAME_POOL_FADE_ARGS_SHORT, &after);
+    TEST_ASSERT_EQUAL(before.in_use - 1U, after.in_use);
+}
+
+TEST(keyframe_fade, clones_fill_every_neopixel)
+{
+    static keyframe_base_t * p_clones[PIXELKEY_NEOPIXEL_COUNT_MAX];
+    arena_t arena;
+    arena_init(&arena, arena_mem, sizeof(arena_mem));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_frameproc_init(&arena, PIXELKEY_NEOPIXEL_COUNT_MAX));
+
+    keyframe_pool_stats_t before, after;
+    keyframe_pool_stats_get(KEYFRAME_POOL_FADE_ARGS_SHORT, &before);
+
+    char in[] = "1 red:blue";
+    keyframe_base_t * p_parsed = keyframe_fade_parse(in);
+    TEST_ASSERT_NOT_NULL(p_parsed);
+
+    // Every NeoPixel gets its own fade, and all of them share one block of arguments.
+    for (uint16_t i = 0; i < PIXELKEY_NEOPIXEL_COUNT_MAX; i++)
+    {
+        p_clones[i] = p_parsed->p_api->clone(p_parsed);
+        TEST_ASSERT_NOT_NULL(p_clones[i]);
+        TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_push(i, p_clones[i]));
+    }
+    keyframe_pool_stats_get(KEYFRAME_POOL_FADE_ARGS_SHORT, &after);
+    TEST_ASSERT_EQUAL(before.in_use + 1U, after.in_use);
+    TEST_ASSERT_EQUAL(PIXELKEY_NEOPIXEL_COUNT_MAX + 1U, ((keyframe_fade_t const *) p_parsed)->p_args->refs);
+
+    // Drop the queued fades before destroying them.
+    arena_init(&arena, arena_mem, sizeof(arena_mem));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_frameproc_init(&arena, PIXELKEY_NEOPIXEL_COUNT_MAX));
+    for (uint16_t i = 0; i < PIXELKEY_NEOPIXEL_COUNT_MAX; i++)
+    {
+        keyframe_destroy(p_clones[i]);
+    }
+    keyframe_destroy(p_parsed);
+    keyframe_pool_stats_get(KEYFRAME_POOL_FADE_ARGS_SHORT, &after);
+    TEST_ASSERT_EQUAL(before.in_use, after.in_use);
+}
+
+TEST(keyframe_fade, caller_owned_args)
+{
+    keyframe_pool_stats_t before, after;
+    keyframe_pool_stats_get(KEYFRAME_POOL_KEYFRAME, &before);
+
+    // Arguments supplied by the caller are never freed, even by a pool keyframe and its clones.
+    keyframe_fade_args_storage_t storage;
+    keyframe_base_t * p_fade = keyframe_fade_ctor(NULL, &storage.args, false);
+    TEST_ASSERT_NOT_NULL(p_fade);
+    TEST_ASSERT_EQUAL(2, storage.args.refs);
+    keyframe_base_t * p_clone = p_fade->p_api->clone(p_fade);
+    TEST_ASSERT_NOT_NULL(p_clone);
+    TEST_ASSERT_EQUAL(3, storage.args.refs);
+
+    keyframe_destroy(p_clone);
+    keyframe_destroy(p_fade);
+    TEST_ASSERT_EQUAL(1, storage.args.refs);
+    keyframe_pool_stats_get(KEYFRAME_POOL_KEYFRAME, &after);
+    TEST_ASSERT_EQUAL(before.in_use, after.in_use);
+}
+
+TEST(keyframe_fade, adopted_args)
+{
+    keyframe_pool_stats_t short_before, short_after, long_before, long_after;
+    keyframe_pool_stats_get(KEYFRAME_POOL_FADE_ARGS_SHORT, &short_before);
+    keyframe_pool_stats_get(KEYFRAME_POOL_FADE_ARGS, &long_before);
+
+    // Arguments allocated for a few colors take a short block, which the keyframe frees with its last clone.
+    keyframe_fade_args_t * p_args = keyframe_fade_args_alloc(KEYFRAME_FADE_COLORS_SHORT_LENGTH);
+    TEST_ASSERT_NOT_NULL(p_args);
+    keyframe_base_t * p_fade = keyframe_fade_ctor(NULL, p_args, true);
+    TEST_ASSERT_NOT_NULL(p_fade);
+    TEST_ASSERT_EQUAL(1, p_args->refs);
+    keyframe_pool_stats_get(KEYFRAME_POOL_FADE_ARGS_SHORT, &short_after);
+    keyframe_pool_stats_get(KEYFRAME_POOL_FADE_ARGS, &long_after);
+    TEST_ASSERT_EQUAL(short_before.in_use + 1U, short_after.in_use);
+    TEST_ASSERT_EQUAL(long_before.in_use, long_after.in_use);
+
+    keyframe_base_t * p_clone = p_fade->p_api->clone(p_fade);
+    TEST_ASSERT_NOT_NULL(p_clone);
+    keyframe_destroy(p_fade);
+    keyframe_destroy(p_clone);
+    keyframe_pool_stats_get(KEYFRAME_POOL_FADE_ARGS_SHORT, &short_after);
+    TEST_ASSERT_EQUAL(short_before.in_use, short_after.in_use);
+}
+
+TEST(keyframe_fade, args_sized_to_colors)
+{
+    keyframe_pool_stats_t short_before, short_after, long_before, long_after;
+    keyframe_pool_stats_get(KEYFRAME_POOL_FADE_ARGS_SHORT, &short_before);
+    keyframe_pool_stats_get(KEYFRAME_POOL_FADE_ARGS, &long_before);
+
+    // Short color lists take a short block, longer lists a block with room for every color.
+    char in_short[] = "1 red:blue";
+    keyframe_base_t * p_short = keyframe_fade_parse(in_short);
+    TEST_ASSERT_NOT_NULL(p_short);
+    char in_long[] = "1 red:green:blue:red:green";
+    keyframe_base_t * p_long = keyframe_fade_parse(in_long);
+    TEST_ASSERT_NOT_NULL(p_long);
+    TEST_ASSERT_EQUAL(5, ((keyframe_fade_t const *) p_long)->p_args->colors_len);
+    TEST_ASSERT_EQUAL_MEMORY(&color_green.hsv, &((keyframe_fade_t const *) p_long)->p_args->colors[4], sizeof(color_hsv_t));
+
+    keyframe_pool_stats_get(KEYFRAME_POOL_FADE_ARGS_SHORT, &short_after);
+    keyframe_pool_stats_get(KEYFRAME_POOL_FADE_ARGS, &long_after);
+    TEST_ASSERT_EQUAL(short_before.in_use + 1U, short_after.in_use);
+    TEST_ASSERT_EQUAL(long_before.in_use + 1U, long_after.in_use);
+
+    // Parsed keyframes hold the only reference to their arguments and free them when destroyed.
+    TEST_ASSERT_EQUAL(1, ((keyframe_fade_t const *) p_short)->p_args->refs);
+    TEST_ASSERT_EQUAL(1, ((keyframe_fade_t const *) p_long)->p_args->refs);
+    keyframe_destroy(p_short);
+    keyframe_destroy(p_long);
+    keyframe_pool_stats_get(KEYFRAME_POOL_FADE_ARGS_SHORT, &short_after);
+    keyframe_pool_stats_get(KEYFRAME_POOL_FADE_ARGS, &long_after);
+    TEST_ASSERT_EQUAL(short_before.in_use, short_after.in_use);
+    TEST_ASSERT_EQUAL(long_before.in_use, long_after.in_use);
+}
+
 TEST_GROUP_RUNNER(keyframe_fade)
 {
     RUN_TEST_CASE(keyframe_fade, linear);
@@ -91,4 +291,10 @@ TEST_GROUP_RUNNER(keyframe_fade)
     RUN_TEST_CASE(keyframe_fade, ease_in);
     RUN_TEST_CASE(keyframe_fade, ease_out);
     RUN_TEST_CASE(keyframe_fade, ease_in_out);
+    RUN_TEST_CASE(keyframe_fade, seek);
+    RUN_TEST_CASE(keyframe_fade, clones_share_args);
+    RUN_TEST_CASE(keyframe_fade, clones_fill_every_neopixel);
+    RUN_TEST_CASE(keyframe_fade, caller_owned_args);
+    RUN_TEST_CASE(keyframe_fade, adopted_args);
+    RUN_TEST_CASE(keyframe_fade, args_sized_to_colors);
 }
@@ -0,0 +1,128 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "unity_fixture.h"
+
+#include "keyframes.h"
+#include "keyframe_pool.h"
+
+static keyframe_pool_stats_t before;
+
+TEST_GROUP(keyframe_pool);
+
+TEST_SETUP(keyframe_pool)
+{
+    keyframe_reclaim();
+    keyframe_pool_stats_get(KEYFRAME_POOL_KEYFRAME, &before);
+}
+
+TEST_TEAR_DOWN(keyframe_pool)
+{
+    keyframe_reclaim();
+}
+
+TEST(keyframe_pool, size_classes)
+{
+    keyframe_pool_stats_t keyframe;
+    keyframe_pool_stats_get(KEYFRAME_POOL_KEYFRAME, &keyframe);
+
+    // Every keyframe type fits the shared class, which holds a keyframe for every NeoPixel.
+    TEST_ASSERT_TRUE(keyframe.block_size >= sizeof(keyframe_set_t));
+    TEST_ASSERT_TRUE(keyframe.block_size >= sizeof(keyframe_blink_t));
+    TEST_ASSERT_TRUE(keyframe.block_size >= sizeof(keyframe_fade_t));
+    TEST_ASSERT_TRUE(keyframe.block_count >= PIXELKEY_NEOPIXEL_COUNT_MAX);
+
+    keyframe_pool_stats_t fade_args;
+    keyframe_pool_stats_get(KEYFRAME_POOL_FADE_ARGS, &fade_args);
+    TEST_ASSERT_TRUE(fade_args.block_size >= KEYFRAME_FADE_ARGS_SIZE(KEYFRAME_FADE_COLORS_MAX_LENGTH));
+
+    // Blocks owned by keyframes are only allocated from their own class.
+    const uint16_t fade_args_in_use = fade_args.in_use;
+    void * p_args = keyframe_pool_alloc(KEYFRAME_POOL_FADE_ARGS);
+    TEST_ASSERT_NOT_NULL(p_args);
+    keyframe_pool_stats_get(KEYFRAME_POOL_FADE_ARGS, &fade_args);
+    keyframe_pool_stats_get(KEYFRAME_POOL_KEYFRAME, &keyframe);
+    TEST_ASSERT_EQUAL(before.in_use, keyframe.in_use);
+    TEST_ASSERT_EQUAL(fade_args_in_use + 1U, fade_args.in_use);
+    keyframe_free(p_args);
+
+    // Too large for the keyframe class.
+    TEST_ASSERT_NULL(keyframe_alloc(keyframe.block_size + 1U));
+}
+
+TEST(keyframe_pool, alloc_free_stats)
+{
+    void * p_blocks[4];
+    for (size_t i = 0; i < 4; i++)
+    {
+        p_blocks[i] = keyframe_alloc(sizeof(keyframe_set_t));
+        TEST_ASSERT_NOT_NULL(p_blocks[i]);
+    }
+
+    keyframe_pool_stats_t stats;
+    keyframe_pool_stats_get(KEYFRAME_POOL_KEYFRAME, &stats);
+    TEST_ASSERT_EQUAL(before.in_use + 4U, stats.in_use);
+    TEST_ASSERT_TRUE(stats.high_water >= stats.in_use);
+
+    // Freed blocks are reused first.
+    keyframe_free(p_blocks[2]);
+    TEST_ASSERT_TRUE(p_blocks[2] == keyframe_alloc(sizeof(keyframe_set_t)));
+
+    for (size_t i = 0; i < 4; i++)
+    {
+        keyframe_free(p_blocks[i]);
+    }
+    keyframe_pool_stats_get(KEYFRAME_POOL_KEYFRAME, &stats);
+    TEST_ASSERT_EQUAL(before.in_use, stats.in_use);
+}
+
+TEST(keyframe_pool, deferred_reclaim)
+{
+    void * p_block = keyframe_alloc(sizeof(keyframe_set_t));
+    TEST_ASSERT_NOT_NULL(p_block);
+
+    // Deferred blocks are still in use until they are reclaimed.
+    keyframe_free_deferred(p_block);
+    keyframe_pool_stats_t stats;
+    keyframe_pool_stats_get(KEYFRAME_POOL_KEYFRAME, &stats);
+    TEST_ASSERT_EQUAL(before.in_use + 1U, stats.in_use);
+
+    keyframe_reclaim();
+    keyframe_pool_stats_get(KEYFRAME_POOL_KEYFRAME, &stats);
+    TEST_ASSERT_EQUAL(before.in_use, stats.in_use);
+}
+
+TEST(keyframe_pool, exhausted)
+{
+    static void * p_blocks[KEYFRAME_POOL_KEYFRAME_COUNT];
+    const size_t count = KEYFRAME_POOL_KEYFRAME_COUNT - before.in_use;
+    for (size_t i = 0; i < count; i++)
+    {
+        p_blocks[i] = keyframe_alloc(sizeof(keyframe_set_t));
+        TEST_ASSERT_NOT_NULL(p_blocks[i]);
+    }
+
+    // A full class does not overflow into another one.
+    TEST_ASSERT_NULL(keyframe_alloc(sizeof(keyframe_set_t)));
+
+    keyframe_pool_stats_t stats;
+    keyframe_pool_stats_get(KEYFRAME_POOL_KEYFRAME, &stats);
+    TEST_ASSERT_EQUAL(KEYFRAME_POOL_KEYFRAME_COUNT, stats.high_water);
+    TEST_ASSERT_EQUAL(before.failures + 1U, stats.failures);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        keyframe_free(p_blocks[i]);
+    }
+}
+
+TEST_GROUP_RUNNER(keyframe_pool)
+{
+    RUN_TEST_CASE(keyframe_pool, size_classes);
+    RUN_TEST_CASE(keyframe_pool, alloc_free_stats);
+    RUN_TEST_CASE(keyframe_pool, deferred_reclaim);
+    RUN_TEST_CASE(keyframe_pool, exhausted);
+}
@@ -0,0 +1,638 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "unity_fixture.h"
+
+#include "hal_device.h"
+#include "pixelkey.h"
+#include "pixelkey_errors.h"
+#include "config.h"
+#include "arena.h"
+
+#include "keyframes.h"
+#include "keyframe_pool.h"
+#include "keyframe_timeline.h"
+#include "segment.h"
+
+#include "color.h"
+
+#define FRAMERATE       60
+#define FRAME_PERIOD    (TIMESTEP_PER_SECOND / FRAMERATE)
+#define PIXEL_COUNT     37
+
+static config_data_t test_config;
+
+static pixelkey_error_t test_config_write(config_data_t const * const p_config_data)
+{
+    test_config = *p_config_data;
+    return PIXELKEY_ERROR_NONE;
+}
+
+static pixelkey_error_t test_config_read(config_data_t ** pp_config_data)
+{
+    *pp_config_data = &test_config;
+    return PIXELKEY_ERROR_NONE;
+}
+
+static const config_api_t test_config_api =
+{
+    .write = test_config_write,
+    .read = test_config_read,
+};
+
+/** Number of times @ref counting_render_frame has been called. */
+static uint32_t render_count = 0;
+
+/** Renders the frame number, from 1, into the red channel and finishes after 3 frame periods. */
+static bool counting_render_frame(keyframe_base_t * const p_keyframe, timestep_t time, color_rgb_t * p_color_out)
+{
+    (void) p_keyframe;
+    render_count++;
+    *p_color_out = (color_rgb_t) { .red = (uint8_t) (time / FRAME_PERIOD + 1U) };
+    return time >= 2U * FRAME_PERIOD;
+}
+
+/** Number of times @ref counting_render_init has been called. */
+static uint32_t init_count = 0;
+
+static void counting_render_init(keyframe_base_t * const p_keyframe, color_rgb_t current_color)
+{
+    (void) p_keyframe;
+    (void) current_color;
+    init_count++;
+}
+
+/** Number of times @ref counting_render_reset has been called. */
+static uint32_t reset_count = 0;
+
+static void counting_render_reset(keyframe_base_t * const p_keyframe)
+{
+    (void) p_keyframe;
+    reset_count++;
+}
+
+static const keyframe_base_api_t counting_api =
+{
+    .render_frame = counting_render_frame,
+    .render_init = counting_render_init,
+};
+
+static const keyframe_base_t counting_init = { .p_api = &counting_api };
+
+static const keyframe_base_api_t resetting_api =
+{
+    .render_frame = counting_render_frame,
+    .render_init = counting_render_init,
+    .render_reset = counting_render_reset,
+};
+
+static const keyframe_base_t resetting_init = { .p_api = &resetting_api };
+
+/** Number of times @ref span_render_span has been called. */
+static uint32_t span_count = 0;
+
+/** Renders the NeoPixel index into the red channel and the frame number into the green channel. */
+static bool span_render_span(keyframe_base_t * const p_keyframe, timestep_t time, uint16_t first_index, uint16_t count, color_rgb_t * p_colors_out)
+{
+    (void) p_keyframe;
+    span_count++;
+    for (uint16_t i = 0; i < count; i++)
+    {
+        p_colors_out[i] = (color_rgb_t) { .red = (uint8_t) (first_index + i), .green = (uint8_t) (time / FRAME_PERIOD + 1U) };
+    }
+    return false;
+}
+
+static const keyframe_base_api_t span_api =
+{
+    .render_frame = counting_render_frame,
+    .render_span = span_render_span,
+    .render_init = counting_render_init,
+};
+
+static const keyframe_base_t span_init = { .p_api = &span_api };
+
+static uint8_t arena_mem[16384] ALIGN(8);
+static arena_t arena;
+
+TEST_GROUP(keyframe_processor);
+
+TEST_SETUP(keyframe_processor)
+{
+    test_config = *config_default();
+    config_register(&test_config_api);
+    arena_init(&arena, arena_mem, sizeof(arena_mem));
+    segment_clear();
+
+    // Return keyframes released by earlier tests to their pools, as the idle loop would.
+    keyframe_reclaim();
+}
+
+TEST_TEAR_DOWN(keyframe_processor)
+{
+
+}
+
+TEST(keyframe_processor, init_sizes_from_count)
+{
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_frameproc_init(&arena, PIXEL_COUNT));
+    TEST_ASSERT_EQUAL(PIXEL_COUNT, pixelkey_keyframeproc_pixel_count_get());
+    TEST_ASSERT_TRUE(arena_used(&arena) > 0);
+
+    keyframe_set_t set;
+    keyframe_base_t * p_set = keyframe_set_ctor(&set);
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_push(PIXEL_COUNT - 1, p_set));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_INDEX_OUT_OF_RANGE, pixelkey_keyframeproc_push(PIXEL_COUNT, p_set));
+}
+
+TEST(keyframe_processor, init_rejects_unsupported_count)
+{
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_INDEX_OUT_OF_RANGE, pixelkey_frameproc_init(&arena, 0));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_INDEX_OUT_OF_RANGE, pixelkey_frameproc_init(&arena, PIXELKEY_NEOPIXEL_COUNT_MAX + 1U));
+    TEST_ASSERT_EQUAL(0, pixelkey_keyframeproc_pixel_count_get());
+
+    // An arena too small for the per-pixel state.
+    arena_init(&arena, arena_mem, 64);
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_OUT_OF_MEMORY, pixelkey_frameproc_init(&arena, PIXEL_COUNT));
+    TEST_ASSERT_EQUAL(0, pixelkey_keyframeproc_pixel_count_get());
+}
+
+TEST(keyframe_processor, render_all_pixels)
+{
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_frameproc_init(&arena, PIXEL_COUNT));
+
+    keyframe_set_t set;
+    keyframe_base_t * p_set = keyframe_set_ctor(&set);
+    for (uint16_t i = 0; i < PIXEL_COUNT; i++)
+    {
+        set.args.color = (color_t) { .color_space = COLOR_SPACE_RGB, .rgb = { .red = (uint8_t) i, .green = 0x40, .blue = 0x80 } };
+        TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_push(i, p_set->p_api->clone(p_set)));
+    }
+
+    color_rgb_t frame[PIXEL_COUNT + 1];
+    memset(frame, 0xA5, sizeof(frame));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frame, 0));
+
+    for (uint16_t i = 0; i < PIXEL_COUNT; i++)
+    {
+        TEST_ASSERT_EQUAL(i, frame[i].red);
+        TEST_ASSERT_EQUAL(0x40, frame[i].green);
+        TEST_ASSERT_EQUAL(0x80, frame[i].blue);
+    }
+
+    // Nothing is written past the configured count.
+    TEST_ASSERT_EQUAL(0xA5, frame[PIXEL_COUNT].red);
+}
+
+TEST(keyframe_processor, broadcast_renders_once)
+{
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_frameproc_init(&arena, PIXEL_COUNT));
+
+    keyframe_base_t * p_kf = keyframe_alloc(sizeof(keyframe_base_t));
+    TEST_ASSERT_NOT_NULL(p_kf);
+    memcpy(p_kf, &counting_init, sizeof(keyframe_base_t));
+    p_kf->flags = KEYFRAME_FLAG_BROADCAST;
+    p_kf->modifiers.repeat_count = 2;
+    p_kf->broadcast.refs = 1;
+
+    for (uint16_t i = 0; i < PIXEL_COUNT; i++)
+    {
+        TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_push(i, p_kf));
+    }
+    pixelkey_keyframeproc_release(p_kf);
+    TEST_ASSERT_EQUAL(PIXEL_COUNT, p_kf->broadcast.refs);
+
+    color_rgb_t frame[PIXEL_COUNT];
+    render_count = 0;
+    for (timestep_t t = 1; t <= 6; t++)
+    {
+        TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frame, t * FRAME_PERIOD));
+        TEST_ASSERT_EQUAL(t, render_count);
+
+        // Every pixel shows the same render; the repeat restarts the clock after frame 3.
+        for (uint16_t i = 0; i < PIXEL_COUNT; i++)
+        {
+            TEST_ASSERT_EQUAL((t - 1U) % 3U + 1U, frame[i].red);
+        }
+    }
+
+    // The repeat count was consumed once, not once per pixel, and the keyframe has been released by all pixels.
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frame, 7U * FRAME_PERIOD));
+    TEST_ASSERT_EQUAL(6, render_count);
+}
+
+TEST(keyframe_processor, render_span)
+{
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_frameproc_init(&arena, PIXEL_COUNT));
+
+    keyframe_base_t * p_kf = keyframe_alloc(sizeof(keyframe_base_t));
+    TEST_ASSERT_NOT_NULL(p_kf);
+    memcpy(p_kf, &span_init, sizeof(keyframe_base_t));
+    p_kf->flags = KEYFRAME_FLAG_BROADCAST;
+    p_kf->broadcast.refs = 1;
+
+    // Two runs of NeoPixels separated by a NeoPixel without a keyframe.
+    for (uint16_t i = 0; i < PIXEL_COUNT; i++)
+    {
+        if (i != 10)
+        {
+            TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_push(i, p_kf));
+        }
+    }
+    pixelkey_keyframeproc_release(p_kf);
+
+    color_rgb_t frame[PIXEL_COUNT];
+    span_count = 0;
+    render_count = 0;
+    for (timestep_t t = 1; t <= 2; t++)
+    {
+        TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frame, t * FRAME_PERIOD));
+
+        // One call per run and every run sees the same time.
+        TEST_ASSERT_EQUAL(2U * t, span_count);
+        for (uint16_t i = 0; i < PIXEL_COUNT; i++)
+        {
+            if (i != 10)
+            {
+                TEST_ASSERT_EQUAL(i, frame[i].red);
+                TEST_ASSERT_EQUAL(t, frame[i].green);
+            }
+        }
+    }
+
+    // The per-pixel render is not used when a span render is provided.
+    TEST_ASSERT_EQUAL(0, render_count);
+}
+
+TEST(keyframe_processor, late_frames_are_dropped)
+{
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_frameproc_init(&arena, PIXEL_COUNT));
+
+    keyframe_base_t * p_kf = keyframe_alloc(sizeof(keyframe_base_t));
+    TEST_ASSERT_NOT_NULL(p_kf);
+    memcpy(p_kf, &counting_init, sizeof(keyframe_base_t));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_push(0, p_kf));
+
+    // Start just before the clock wraps.
+    const timestep_t start = UINT32_MAX - FRAME_PERIOD / 2U;
+    color_rgb_t frame[PIXEL_COUNT];
+    render_count = 0;
+
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frame, start));
+    TEST_ASSERT_EQUAL(1, frame[0].red);
+
+    // The second frame was late; the keyframe jumps to its third frame and finishes on time.
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frame, start + 2U * FRAME_PERIOD));
+    TEST_ASSERT_EQUAL(3, frame[0].red);
+    TEST_ASSERT_EQUAL(2, render_count);
+
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frame, start + 3U * FRAME_PERIOD));
+    TEST_ASSERT_EQUAL(2, render_count);
+}
+
+TEST(keyframe_processor, scheduled_activations)
+{
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_frameproc_init(&arena, PIXEL_COUNT));
+
+    keyframe_set_t set;
+    keyframe_base_t * p_set = keyframe_set_ctor(&set);
+
+    // More keyframes for one NeoPixel than it could hold before, pushed latest first.
+    for (uint8_t n = 8; n > 0; n--)
+    {
+        set.args.color = (color_t) { .color_space = COLOR_SPACE_RGB, .rgb = { .red = n } };
+        TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_push_at(0, p_set->p_api->clone(p_set), n * FRAME_PERIOD));
+    }
+
+    // Of two activations at the same time the last one pushed is kept.
+    set.args.color = (color_t) { .color_space = COLOR_SPACE_RGB, .rgb = { .red = 100 } };
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_push_at(0, p_set->p_api->clone(p_set), 3U * FRAME_PERIOD));
+
+    color_rgb_t frame[PIXEL_COUNT];
+    for (timestep_t t = 0; t <= 8; t++)
+    {
+        TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frame, t * FRAME_PERIOD));
+        TEST_ASSERT_EQUAL((t == 3U) ? 100U : t, frame[0].red);
+        TEST_ASSERT_EQUAL(0, frame[1].red);
+    }
+    TEST_ASSERT_EQUAL(0, keyframe_timeline_count());
+}
+
+TEST(keyframe_processor, overdue_activations_start_partway)
+{
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_frameproc_init(&arena, PIXEL_COUNT));
+
+    color_rgb_t frame[PIXEL_COUNT];
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frame, 0));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frame, FRAME_PERIOD));
+
+    // Scheduled before the last frame; it renders as if it had started on time.
+    keyframe_base_t * p_kf = keyframe_alloc(sizeof(keyframe_base_t));
+    TEST_ASSERT_NOT_NULL(p_kf);
+    memcpy(p_kf, &counting_init, sizeof(keyframe_base_t));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_push_at(0, p_kf, 0));
+
+    // Pushed for now; it starts from the beginning with the next frame.
+    p_kf = keyframe_alloc(sizeof(keyframe_base_t));
+    TEST_ASSERT_NOT_NULL(p_kf);
+    memcpy(p_kf, &counting_init, sizeof(keyframe_base_t));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_push(1, p_kf));
+
+    render_count = 0;
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frame, 2U * FRAME_PERIOD));
+    TEST_ASSERT_EQUAL(3, frame[0].red);
+    TEST_ASSERT_EQUAL(1, frame[1].red);
+
+    // The overdue keyframe finished on its schedule.
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frame, 3U * FRAME_PERIOD));
+    TEST_ASSERT_EQUAL(3, render_count);
+    TEST_ASSERT_EQUAL(2, frame[1].red);
+}
+
+TEST(keyframe_processor, pushes_keep_frames_rendered_ahead)
+{
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_frameproc_init(&arena, PIXEL_COUNT));
+
+    color_rgb_t frame[PIXEL_COUNT];
+    timestep_t stale_time;
+    for (timestep_t t = 1; t <= 3; t++)
+    {
+        TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frame, t * FRAME_PERIOD));
+    }
+
+    // Pushed without a start time, it starts with the first frame not rendered yet.
+    keyframe_base_t * p_kf = keyframe_alloc(sizeof(keyframe_base_t));
+    TEST_ASSERT_NOT_NULL(p_kf);
+    memcpy(p_kf, &counting_init, sizeof(keyframe_base_t));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_push(0, p_kf));
+    TEST_ASSERT_FALSE(pixelkey_keyframeproc_stale_get(&stale_time));
+
+    for (timestep_t t = 4; t <= 6; t++)
+    {
+        TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frame, t * FRAME_PERIOD));
+        TEST_ASSERT_EQUAL(t - 3U, frame[0].red);
+    }
+}
+
+TEST(keyframe_processor, stale_frames_change_only_pushed_pixels)
+{
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_frameproc_init(&arena, PIXEL_COUNT));
+
+    // NeoPixel 1 repeats a 3 frame cycle from the first frame.
+    keyframe_base_t * p_kf = keyframe_alloc(sizeof(keyframe_base_t));
+    TEST_ASSERT_NOT_NULL(p_kf);
+    memcpy(p_kf, &counting_init, sizeof(keyframe_base_t));
+    p_kf->modifiers.repeat_count = -1;
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_push(1, p_kf));
+
+    // Frames 1 to 4 are rendered ahead, each into its own buffer as in the frame ring.
+    color_rgb_t frames[6][PIXEL_COUNT];
+    for (timestep_t t = 1; t <= 4; t++)
+    {
+        TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frames[t], t * FRAME_PERIOD));
+    }
+    const uint32_t framecount = pixelkey_keyframeproc_framecount_get();
+
+    // Dated before the last rendered frame; the frames from its start on are stale.
+    p_kf = keyframe_alloc(sizeof(keyframe_base_t));
+    TEST_ASSERT_NOT_NULL(p_kf);
+    memcpy(p_kf, &counting_init, sizeof(keyframe_base_t));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_push_at(0, p_kf, 2U * FRAME_PERIOD));
+    timestep_t stale_time;
+    TEST_ASSERT_TRUE(pixelkey_keyframeproc_stale_get(&stale_time));
+    TEST_ASSERT_EQUAL(2U * FRAME_PERIOD, stale_time);
+    TEST_ASSERT_FALSE(pixelkey_keyframeproc_stale_get(&stale_time));
+
+    // Rendered again, only the pushed NeoPixel changes; the repeating cycle of the other is untouched.
+    render_count = 0;
+    for (timestep_t t = 2; t <= 4; t++)
+    {
+        const color_rgb_t before = frames[t][1];
+        TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frames[t], t * FRAME_PERIOD));
+        TEST_ASSERT_EQUAL(t - 1U, frames[t][0].red);
+        TEST_ASSERT_EQUAL(before.red, frames[t][1].red);
+    }
+    TEST_ASSERT_EQUAL(3, render_count);
+    TEST_ASSERT_EQUAL(framecount, pixelkey_keyframeproc_framecount_get());
+
+    // The next frame carries on from the last one rendered: the cycle restarted at frame 4 and the pushed keyframe,
+    // past its end, renders for the time since its start.
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frames[5], 5U * FRAME_PERIOD));
+    TEST_ASSERT_EQUAL(4, frames[5][0].red);
+    TEST_ASSERT_EQUAL(2, frames[5][1].red);
+}
+
+TEST(keyframe_processor, repeats_reset_without_init)
+{
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_frameproc_init(&arena, PIXEL_COUNT));
+
+    // One keyframe without a reset and one with, both rendered 3 times.
+    keyframe_base_t const * const p_inits[] = { &counting_init, &resetting_init };
+    for (uint16_t i = 0; i < 2U; i++)
+    {
+        keyframe_base_t * p_kf = keyframe_alloc(sizeof(keyframe_base_t));
+        TEST_ASSERT_NOT_NULL(p_kf);
+        memcpy(p_kf, p_inits[i], sizeof(keyframe_base_t));
+        p_kf->modifiers.repeat_count = 3;
+        TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_push(i, p_kf));
+    }
+
+    color_rgb_t frame[PIXEL_COUNT];
+    init_count = 0;
+    reset_count = 0;
+    for (timestep_t t = 0; t < 9U; t++)
+    {
+        TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frame, t * FRAME_PERIOD));
+        TEST_ASSERT_EQUAL(t % 3U + 1U, frame[0].red);
+        TEST_ASSERT_EQUAL(t % 3U + 1U, frame[1].red);
+    }
+
+    // Each keyframe was initialized once; only the one which asked for it was reset between repeats.
+    TEST_ASSERT_EQUAL(2, init_count);
+    TEST_ASSERT_EQUAL(2, reset_count);
+}
+
+TEST(keyframe_processor, layers_composite)
+{
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_frameproc_init(&arena, PIXEL_COUNT));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_layer_set(1, COLOR_BLEND_ADD, UINT8_MAX));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_INDEX_OUT_OF_RANGE, pixelkey_keyframeproc_layer_set(PIXELKEY_LAYER_COUNT, COLOR_BLEND_ADD, UINT8_MAX));
+
+    // A steady background on the bottom layer.
+    keyframe_set_t set;
+    keyframe_base_t * p_set = keyframe_set_ctor(&set);
+    set.args.color = (color_t) { .color_space = COLOR_SPACE_RGB, .rgb = { .red = 0x40, .blue = 0x10 } };
+    for (uint16_t i = 0; i < 2U; i++)
+    {
+        TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_push(i, p_set->p_api->clone(p_set)));
+    }
+
+    // A short overlay on one NeoPixel.
+    keyframe_base_t * p_kf = keyframe_alloc(sizeof(keyframe_base_t));
+    TEST_ASSERT_NOT_NULL(p_kf);
+    memcpy(p_kf, &counting_init, sizeof(keyframe_base_t));
+    p_kf->modifiers.layer = PIXELKEY_LAYER_COUNT;
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_INDEX_OUT_OF_RANGE, pixelkey_keyframeproc_push(1, p_kf));
+    p_kf->modifiers.layer = 1;
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_push(1, p_kf));
+
+    color_rgb_t frame[PIXEL_COUNT];
+    for (timestep_t t = 0; t < 3U; t++)
+    {
+        TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frame, t * FRAME_PERIOD));
+        TEST_ASSERT_EQUAL(0x40, frame[0].red);
+        TEST_ASSERT_EQUAL(0x40 + t + 1U, frame[1].red);
+        TEST_ASSERT_EQUAL(0x10, frame[1].blue);
+    }
+
+    // The background shows again once the overlay has finished, without being pushed again.
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frame, 3U * FRAME_PERIOD));
+    TEST_ASSERT_EQUAL(0x40, frame[1].red);
+    TEST_ASSERT_EQUAL(0x10, frame[1].blue);
+}
+
+TEST(keyframe_processor, segments_render_on_ticks)
+{
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_frameproc_init(&arena, PIXEL_COUNT));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, segment_set("slow", 0, 1, FRAMERATE / 3U));
+
+    for (uint16_t i = 0; i < 2U; i++)
+    {
+        keyframe_base_t * p_kf = keyframe_alloc(sizeof(keyframe_base_t));
+        TEST_ASSERT_NOT_NULL(p_kf);
+        memcpy(p_kf, &counting_init, sizeof(keyframe_base_t));
+        p_kf->modifiers.repeat_count = -1;
+        TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_push(i, p_kf));
+    }
+
+    color_rgb_t frame[PIXEL_COUNT];
+    render_count = 0;
+    for (timestep_t t = 0; t < 3U; t++)
+    {
+        TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frame, t * FRAME_PERIOD));
+        TEST_ASSERT_EQUAL(t + 1U, frame[1].red);
+
+        // The segment keeps its first frame until its next tick.
+        TEST_ASSERT_EQUAL(1, frame[0].red);
+    }
+    TEST_ASSERT_EQUAL(4, render_count);
+
+    // It renders at the frame time on its tick.
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frame, 3U * FRAME_PERIOD));
+    TEST_ASSERT_EQUAL(4, frame[0].red);
+    TEST_ASSERT_EQUAL(6, render_count);
+}
+
+TEST(keyframe_processor, matrix_renders_virtual_pixels)
+{
+    // A 6 x 6 serpentine mirrored both ways renders a 3 x 3 grid, then the NeoPixel after the matrix.
+    test_config.matrix = (pixel_map_layout_t)
+    {
+        .width = 6,
+        .height = 6,
+        .flags = PIXEL_MAP_FLAG_SERPENTINE | PIXEL_MAP_FLAG_MIRROR_X | PIXEL_MAP_FLAG_MIRROR_Y,
+    };
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_frameproc_init(&arena, PIXEL_COUNT));
+    TEST_ASSERT_EQUAL(3 * 3 + 1, pixelkey_keyframeproc_pixel_count_get());
+
+    keyframe_set_t set;
+    keyframe_base_t * p_set = keyframe_set_ctor(&set);
+    for (uint16_t i = 0; i < pixelkey_keyframeproc_pixel_count_get(); i++)
+    {
+        set.args.color = (color_t) { .color_space = COLOR_SPACE_RGB, .rgb = { .red = (uint8_t) i } };
+        TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_push(i, p_set->p_api->clone(p_set)));
+    }
+
+    color_rgb_t frame[PIXEL_COUNT];
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frame, 0));
+
+    // The corners share the top left virtual NeoPixel; odd rows are wired right to left.
+    TEST_ASSERT_EQUAL(0, frame[0].red);
+    TEST_ASSERT_EQUAL(0, frame[5].red);
+    TEST_ASSERT_EQUAL(0, frame[30].red);
+    TEST_ASSERT_EQUAL(0, frame[35].red);
+    TEST_ASSERT_EQUAL(3, frame[6].red);
+    TEST_ASSERT_EQUAL(5, frame[8].red);
+    TEST_ASSERT_EQUAL(8, frame[15].red);
+    TEST_ASSERT_EQUAL(9, frame[36].red);
+
+    // A layout which does not fit the NeoPixels is ignored.
+    test_config.matrix.height = 7;
+    arena_init(&arena, arena_mem, sizeof(arena_mem));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_frameproc_init(&arena, PIXEL_COUNT));
+    TEST_ASSERT_EQUAL(PIXEL_COUNT, pixelkey_keyframeproc_pixel_count_get());
+}
+
+TEST(keyframe_processor, eval_rate_interpolates)
+{
+    // Keyframes are evaluated every 4 frames and the frames in between are interpolated.
+    test_config.eval_rate = FRAMERATE / 4U;
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_frameproc_init(&arena, PIXEL_COUNT));
+
+    keyframe_base_t * p_kf = keyframe_alloc(sizeof(keyframe_base_t));
+    TEST_ASSERT_NOT_NULL(p_kf);
+    memcpy(p_kf, &counting_init, sizeof(keyframe_base_t));
+    p_kf->modifiers.repeat_count = -1;
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_push(0, p_kf));
+
+    // The first frame evaluates it now and one tick ahead, at 1 and 5.
+    color_rgb_t frame[PIXEL_COUNT];
+    render_count = 0;
+    for (timestep_t t = 0; t < 4U; t++)
+    {
+        TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frame, t * FRAME_PERIOD));
+        TEST_ASSERT_EQUAL(t + 1U, frame[0].red);
+    }
+    TEST_ASSERT_EQUAL(2, render_count);
+
+    // Reaching the tick evaluates the next one.
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frame, 5U * FRAME_PERIOD));
+    TEST_ASSERT_EQUAL(3, render_count);
+    TEST_ASSERT_EQUAL(5, pixelkey_keyframeproc_framecount_get());
+}
+
+TEST(keyframe_processor, stale_pixels_update_evaluations)
+{
+    test_config.eval_rate = FRAMERATE / 4U;
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_frameproc_init(&arena, PIXEL_COUNT));
+
+    // Frames 0 to 3 interpolate towards the evaluation at 4.
+    color_rgb_t frame[PIXEL_COUNT];
+    for (timestep_t t = 0; t < 4U; t++)
+    {
+        TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frame, t * FRAME_PERIOD));
+    }
+
+    // Dated before the last rendered frame; the evaluation ahead was made without it.
+    keyframe_base_t * p_kf = keyframe_alloc(sizeof(keyframe_base_t));
+    TEST_ASSERT_NOT_NULL(p_kf);
+    memcpy(p_kf, &counting_init, sizeof(keyframe_base_t));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_push_at(1, p_kf, FRAME_PERIOD));
+
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixelkey_keyframeproc_render_frame(frame, 4U * FRAME_PERIOD));
+    TEST_ASSERT_EQUAL(4, frame[1].red);
+    TEST_ASSERT_EQUAL(0, frame[0].red);
+}
+
+TEST_GROUP_RUNNER(keyframe_processor)
+{
+    RUN_TEST_CASE(keyframe_processor, init_sizes_from_count);
+    RUN_TEST_CASE(keyframe_processor, init_rejects_unsupported_count);
+    RUN_TEST_CASE(keyframe_processor, render_all_pixels);
+    RUN_TEST_CASE(keyframe_processor, broadcast_renders_once);
+    RUN_TEST_CASE(keyframe_processor, render_span);
+    RUN_TEST_CASE(keyframe_processor, late_frames_are_dropped);
+    RUN_TEST_CASE(keyframe_processor, scheduled_activations);
+    RUN_TEST_CASE(keyframe_processor, overdue_activations_start_partway);
+    RUN_TEST_CASE(keyframe_processor, pushes_keep_frames_rendered_ahead);
+    RUN_TEST_CASE(keyframe_processor, stale_frames_change_only_pushed_pixels);
+    RUN_TEST_CASE(keyframe_processor, repeats_reset_without_init);
+    RUN_TEST_CASE(keyframe_processor, layers_composite);
+    RUN_TEST_CASE(keyframe_processor, segments_render_on_ticks);
+    RUN_TEST_CASE(keyframe_processor, matrix_renders_virtual_pixels);
+    RUN_TEST_CASE(keyframe_processor, eval_rate_interpolates);
+    RUN_TEST_CASE(keyframe_processor, stale_pixels_update_evaluations);
+}
@@ -0,0 +1,120 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "unity_fixture.h"
+
+#include "keyframes.h"
+#include "keyframe_timeline.h"
+
+/** Keyframes are only compared by address. */
+static keyframe_base_t keyframes[4];
+
+TEST_GROUP(keyframe_timeline);
+
+TEST_SETUP(keyframe_timeline)
+{
+    keyframe_timeline_clear();
+}
+
+TEST_TEAR_DOWN(keyframe_timeline)
+{
+    keyframe_timeline_clear();
+}
+
+TEST(keyframe_timeline, ordered_by_start)
+{
+    const timestep_t starts[] = { 500, 100, 400, 200, 300, 100 };
+    for (size_t i = 0; i < sizeof(starts) / sizeof(starts[0]); i++)
+    {
+        TEST_ASSERT_TRUE(keyframe_timeline_insert(starts[i], (uint16_t) i, &keyframes[0]));
+    }
+    TEST_ASSERT_EQUAL(6, keyframe_timeline_count());
+
+    // Nothing is due early.
+    keyframe_activation_t activation;
+    TEST_ASSERT_FALSE(keyframe_timeline_pop_due(99, &activation));
+
+    // Equal start times come out in the order they were inserted.
+    const uint16_t order[] = { 1, 5, 3, 4, 2, 0 };
+    for (size_t i = 0; i < sizeof(order) / sizeof(order[0]); i++)
+    {
+        TEST_ASSERT_TRUE(keyframe_timeline_pop_due(1000, &activation));
+        TEST_ASSERT_EQUAL(order[i], activation.first);
+        TEST_ASSERT_EQUAL(starts[order[i]], activation.start);
+    }
+    TEST_ASSERT_FALSE(keyframe_timeline_pop_due(1000, &activation));
+}
+
+TEST(keyframe_timeline, start_wraps)
+{
+    TEST_ASSERT_TRUE(keyframe_timeline_insert(10, 1, &keyframes[0]));
+    TEST_ASSERT_TRUE(keyframe_timeline_insert(UINT32_MAX - 10U, 0, &keyframes[0]));
+
+    // Times after the clock wraps are later.
+    keyframe_activation_t activation;
+    TEST_ASSERT_TRUE(keyframe_timeline_pop_due(UINT32_MAX, &activation));
+    TEST_ASSERT_EQUAL(0, activation.first);
+    TEST_ASSERT_FALSE(keyframe_timeline_pop_due(UINT32_MAX, &activation));
+    TEST_ASSERT_TRUE(keyframe_timeline_pop_due(10, &activation));
+    TEST_ASSERT_EQUAL(1, activation.first);
+}
+
+TEST(keyframe_timeline, consecutive_pixels_merge)
+{
+    for (uint16_t i = 4; i < 12; i++)
+    {
+        TEST_ASSERT_TRUE(keyframe_timeline_insert(0, i, &keyframes[1]));
+    }
+    // A gap, another keyframe, or another start time need a new entry.
+    TEST_ASSERT_TRUE(keyframe_timeline_insert(0, 13, &keyframes[1]));
+    TEST_ASSERT_TRUE(keyframe_timeline_insert(0, 14, &keyframes[2]));
+    TEST_ASSERT_TRUE(keyframe_timeline_insert(1, 15, &keyframes[2]));
+    TEST_ASSERT_EQUAL(4, keyframe_timeline_count());
+
+    keyframe_activation_t activation;
+    TEST_ASSERT_TRUE(keyframe_timeline_pop_due(0, &activation));
+    TEST_ASSERT_TRUE(&keyframes[1] == activation.p_keyframe);
+    TEST_ASSERT_EQUAL(4, activation.first);
+    TEST_ASSERT_EQUAL(8, activation.count);
+}
+
+TEST(keyframe_timeline, full)
+{
+    for (uint16_t i = 0; i < KEYFRAME_TIMELINE_LENGTH; i++)
+    {
+        // Every other NeoPixel so the entries are not merged.
+        TEST_ASSERT_TRUE(keyframe_timeline_insert(i, (uint16_t) (2U * i), &keyframes[3]));
+    }
+    TEST_ASSERT_FALSE(keyframe_timeline_insert(0, 1, &keyframes[3]));
+
+    // Activations can be added again once some have been removed.
+    keyframe_activation_t activation;
+    TEST_ASSERT_TRUE(keyframe_timeline_pop_due(0, &activation));
+    TEST_ASSERT_TRUE(keyframe_timeline_insert(0, 1, &keyframes[3]));
+}
+
+TEST(keyframe_timeline, shift)
+{
+    TEST_ASSERT_TRUE(keyframe_timeline_insert(0, 0, &keyframes[0]));
+    TEST_ASSERT_TRUE(keyframe_timeline_insert(100, 1, &keyframes[0]));
+    keyframe_timeline_shift(UINT32_MAX - 49U);
+
+    keyframe_activation_t activation;
+    TEST_ASSERT_FALSE(keyframe_timeline_pop_due(UINT32_MAX - 50U, &activation));
+    TEST_ASSERT_TRUE(keyframe_timeline_pop_due(UINT32_MAX - 49U, &activation));
+    TEST_ASSERT_EQUAL(0, activation.first);
+    TEST_ASSERT_TRUE(keyframe_timeline_pop_due(50, &activation));
+    TEST_ASSERT_EQUAL(1, activation.first);
+}
+
+TEST_GROUP_RUNNER(keyframe_timeline)
+{
+    RUN_TEST_CASE(keyframe_timeline, ordered_by_start);
+    RUN_TEST_CASE(keyframe_timeline, start_wraps);
+    RUN_TEST_CASE(keyframe_timeline, consecutive_pixels_merge);
+    RUN_TEST_CASE(keyframe_timeline, full);
+    RUN_TEST_CASE(keyframe_timeline, shift);
+}
@@ -0,0 +1,177 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "unity_fixture.h"
+
+#include "color.h"
+#include "palette.h"
+#include "keyframes.h"
+#include "keyframe_pool.h"
+
+TEST_GROUP(palette);
+
+/** Number of palette writes to the test NV memory. */
+static uint32_t palette_writes = 0;
+
+static pixelkey_error_t test_palette_write(palette_data_t * const p_palette_data)
+{
+    (void) p_palette_data;
+    palette_writes++;
+    return PIXELKEY_ERROR_NONE;
+}
+
+static pixelkey_error_t test_palette_read(palette_data_t const ** pp_palette_data)
+{
+    (void) pp_palette_data;
+    return PIXELKEY_ERROR_NV_NOT_INITIALIZED;
+}
+
+static const palette_api_t test_palette_api =
+{
+    .write = test_palette_write,
+    .read = test_palette_read,
+};
+
+TEST_SETUP(palette)
+{
+    palette_init();
+}
+
+TEST_TEAR_DOWN(palette)
+{
+    palette_clear();
+}
+
+TEST(palette, set_and_find)
+{
+    color_t orange = { .color_space = COLOR_SPACE_RGB, .rgb = { .red = 0xFF, .green = 0x88, .blue = 0x00 } };
+    color_t blue = { .color_space = COLOR_SPACE_HSV, .hsv = { HUE(240), 100, 100 } };
+
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, palette_set("warm", 0, &orange));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, palette_set("sky", PALETTE_INDEX_NONE, &blue));
+
+    // Both forms are stored.
+    palette_entry_t const * p_entry = palette_find("warm", 4, 0);
+    TEST_ASSERT_NOT_NULL(p_entry);
+    TEST_ASSERT_EQUAL_MEMORY(&orange.rgb, &p_entry->rgb, sizeof(color_rgb_t));
+    TEST_ASSERT_EQUAL(100, p_entry->hsv.value);
+
+    p_entry = palette_find("sky", 3, PALETTE_INDEX_NONE);
+    TEST_ASSERT_NOT_NULL(p_entry);
+    TEST_ASSERT_EQUAL(0xFF, p_entry->rgb.blue);
+    TEST_ASSERT_EQUAL(HUE(240), p_entry->hsv.hue);
+
+    // Names and indexes are separate keys.
+    TEST_ASSERT_NULL(palette_find("warm", 4, 1));
+    TEST_ASSERT_NULL(palette_find("warm", 4, PALETTE_INDEX_NONE));
+    TEST_ASSERT_NULL(palette_find("sky", 3, 0));
+    TEST_ASSERT_NULL(palette_find("war", 3, 0));
+
+    // Replacing an entry does not add a new one.
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, palette_set("warm", 0, &blue));
+    TEST_ASSERT_EQUAL(0xFF, palette_find("warm", 4, 0)->rgb.blue);
+}
+
+TEST(palette, invalid_names)
+{
+    color_t color = color_red;
+
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_INVALID_ARGUMENT, palette_set("", 0, &color));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_INVALID_ARGUMENT, palette_set("0warm", 0, &color));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_INVALID_ARGUMENT, palette_set("warm-1", 0, &color));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_INVALID_ARGUMENT, palette_set("averylongname", 0, &color));
+
+    // Built-in names cannot be replaced but may be used for indexed palettes.
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_INVALID_ARGUMENT, palette_set("red", PALETTE_INDEX_NONE, &color));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, palette_set("red", 1, &color));
+}
+
+TEST(palette, full)
+{
+    char name[PALETTE_NAME_MAX_LENGTH];
+    color_t color = color_green;
+
+    for (uint32_t i = 0; i < PALETTE_ENTRIES_MAX; i++)
+    {
+        snprintf(name, sizeof(name), "c%u", (unsigned) (i % 5U));
+        TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, palette_set(name, (uint8_t) i, &color));
+    }
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_BUFFER_FULL, palette_set("extra", PALETTE_INDEX_NONE, &color));
+
+    // Every entry is still reachable through the index.
+    for (uint32_t i = 0; i < PALETTE_ENTRIES_MAX; i++)
+    {
+        snprintf(name, sizeof(name), "c%u", (unsigned) (i % 5U));
+        TEST_ASSERT_NOT_NULL(palette_find(name, strlen(name), (uint8_t) i));
+    }
+
+    palette_clear();
+    TEST_ASSERT_NULL(palette_find("c0", 2, 0));
+}
+
+TEST(palette, color_references)
+{
+    color_t orange = { .color_space = COLOR_SPACE_RGB, .rgb = { .red = 0xFF, .green = 0x88, .blue = 0x00 } };
+    color_t purple = color_purple;
+    color_t color;
+
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, palette_set("warm", 12, &orange));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, palette_set("grape", PALETTE_INDEX_NONE, &purple));
+
+    TEST_ASSERT_TRUE(color_parse("warm.12", &color));
+    TEST_ASSERT_EQUAL(COLOR_SPACE_RGB, color.color_space);
+    TEST_ASSERT_EQUAL_MEMORY(&orange.rgb, &color.rgb, sizeof(color_rgb_t));
+
+    TEST_ASSERT_TRUE(color_parse("grape", &color));
+    TEST_ASSERT_FALSE(color_parse("warm", &color));
+    TEST_ASSERT_FALSE(color_parse("warm.1", &color));
+    TEST_ASSERT_FALSE(color_parse("warm.", &color));
+
+    // Fade keyframes take the stored HSV form.
+    char in[] = "1 red:warm.12:grape";
+    keyframe_fade_t * p_fade = (keyframe_fade_t *) keyframe_fade_parse(in);
+    TEST_ASSERT_NOT_NULL(p_fade);
+    TEST_ASSERT_EQUAL(3, p_fade->p_args->colors_len);
+    TEST_ASSERT_EQUAL_MEMORY(&palette_find("warm", 4, 12)->hsv, &p_fade->p_args->colors[1], sizeof(color_hsv_t));
+    TEST_ASSERT_EQUAL_MEMORY(&purple.hsv, &p_fade->p_args->colors[2], sizeof(color_hsv_t));
+    keyframe_destroy(&p_fade->base);
+}
+
+TEST(palette, saves_batched)
+{
+    color_t color = color_red;
+    palette_register(&test_palette_api);
+    palette_init();
+    palette_writes = 0;
+
+    // Changes are only written when saved, and only once however many there are.
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, palette_set("warm", 0, &color));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, palette_set("warm", 1, &color));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, palette_set("sky", PALETTE_INDEX_NONE, &color));
+    TEST_ASSERT_EQUAL(0, palette_writes);
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, palette_save());
+    TEST_ASSERT_EQUAL(1, palette_writes);
+
+    // Nothing changed, so nothing is written.
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, palette_save());
+    TEST_ASSERT_EQUAL(1, palette_writes);
+
+    palette_clear();
+    TEST_ASSERT_EQUAL(1, palette_writes);
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, palette_save());
+    TEST_ASSERT_EQUAL(2, palette_writes);
+
+    palette_register(NULL);
+}
+
+TEST_GROUP_RUNNER(palette)
+{
+    RUN_TEST_CASE(palette, set_and_find);
+    RUN_TEST_CASE(palette, invalid_names);
+    RUN_TEST_CASE(palette, full);
+    RUN_TEST_CASE(palette, color_references);
+    RUN_TEST_CASE(palette, saves_batched);
+}
@@ -0,0 +1,80 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "unity_fixture.h"
+
+#include "pixel_map.h"
+
+static uint16_t table[16];
+
+TEST_GROUP(pixel_map);
+
+TEST_SETUP(pixel_map)
+{
+    memset(table, 0xFF, sizeof(table));
+}
+
+TEST_TEAR_DOWN(pixel_map)
+{
+}
+
+TEST(pixel_map, layout_validates)
+{
+    uint16_t virtual_count = 0;
+    pixel_map_layout_t layout = { .width = 0 };
+    TEST_ASSERT_TRUE(pixel_map_is_identity(&layout));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixel_map_virtual_count(&layout, 10, &virtual_count));
+    TEST_ASSERT_EQUAL(10, virtual_count);
+
+    // A matrix in wiring order needs no table.
+    layout = (pixel_map_layout_t) { .width = 4, .height = 2 };
+    TEST_ASSERT_TRUE(pixel_map_is_identity(&layout));
+
+    layout = (pixel_map_layout_t) { .width = 4, .height = 0, .flags = PIXEL_MAP_FLAG_SERPENTINE };
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_INVALID_ARGUMENT, pixel_map_virtual_count(&layout, 10, &virtual_count));
+    layout = (pixel_map_layout_t) { .width = 4, .height = 3, .flags = PIXEL_MAP_FLAG_SERPENTINE };
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_INVALID_ARGUMENT, pixel_map_virtual_count(&layout, 10, &virtual_count));
+    layout = (pixel_map_layout_t) { .width = 4, .height = 2, .rotation = PIXEL_MAP_ROTATIONS };
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_INVALID_ARGUMENT, pixel_map_virtual_count(&layout, 10, &virtual_count));
+}
+
+TEST(pixel_map, serpentine_rotated)
+{
+    // 3 x 2 serpentine turned a quarter clockwise; the grid is 2 x 3.
+    //  wired     virtual
+    //  0 1 2     5 0
+    //  5 4 3     4 1
+    //            3 2
+    const pixel_map_layout_t layout = { .width = 3, .height = 2, .rotation = 1, .flags = PIXEL_MAP_FLAG_SERPENTINE };
+    uint16_t virtual_count = 0;
+    TEST_ASSERT_FALSE(pixel_map_is_identity(&layout));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixel_map_virtual_count(&layout, 6, &virtual_count));
+    TEST_ASSERT_EQUAL(6, virtual_count);
+
+    pixel_map_build(&layout, 6, table);
+    const uint16_t expected[] = { 1, 3, 5, 4, 2, 0 };
+    TEST_ASSERT_EQUAL_MEMORY(expected, table, sizeof(expected));
+}
+
+TEST(pixel_map, mirror_renders_half)
+{
+    // 5 x 2 mirrored left to right; the middle column is kept and 2 NeoPixels follow the matrix.
+    const pixel_map_layout_t layout = { .width = 5, .height = 2, .flags = PIXEL_MAP_FLAG_MIRROR_X };
+    uint16_t virtual_count = 0;
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, pixel_map_virtual_count(&layout, 12, &virtual_count));
+    TEST_ASSERT_EQUAL(3 * 2 + 2, virtual_count);
+
+    pixel_map_build(&layout, 12, table);
+    const uint16_t expected[] = { 0, 1, 2, 1, 0, 3, 4, 5, 4, 3, 6, 7 };
+    TEST_ASSERT_EQUAL_MEMORY(expected, table, sizeof(expected));
+}
+
+TEST_GROUP_RUNNER(pixel_map)
+{
+    RUN_TEST_CASE(pixel_map, layout_validates);
+    RUN_TEST_CASE(pixel_map, serpentine_rotated);
+    RUN_TEST_CASE(pixel_map, mirror_renders_half);
+}
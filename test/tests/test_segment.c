@@ -0,0 +1,100 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "unity_fixture.h"
+
+#include "hal_device.h"
+#include "keyframes.h"
+#include "segment.h"
+
+#define FRAME_PERIOD    (TIMESTEP_PER_SECOND / 60U)
+
+static segment_range_t ranges[SEGMENT_RANGES_MAX];
+
+TEST_GROUP(segment);
+
+TEST_SETUP(segment)
+{
+    segment_clear();
+}
+
+TEST_TEAR_DOWN(segment)
+{
+    segment_clear();
+}
+
+TEST(segment, set_validates)
+{
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_INVALID_ARGUMENT, segment_set("1st", 0, 4, 10));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_INVALID_ARGUMENT, segment_set("much_too_long", 0, 4, 10));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_VALUE_OUT_OF_RANGE, segment_set("zone", 0, 0, 10));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_VALUE_OUT_OF_RANGE, segment_set("zone", PIXELKEY_NEOPIXEL_COUNT_MAX - 1U, 2, 10));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_VALUE_OUT_OF_RANGE, segment_set("zone", 0, 4, 0));
+
+    // Segments may not overlap, but one may be moved by setting it again.
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, segment_set("zone", 0, 4, 10));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_INVALID_ARGUMENT, segment_set("other", 3, 4, 10));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, segment_set("zone", 2, 4, 10));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, segment_set("other", 0, 2, 10));
+
+    for (uint16_t i = 2; i < SEGMENTS_MAX; i++)
+    {
+        char name[SEGMENT_NAME_MAX_LENGTH];
+        snprintf(name, sizeof(name), "seg%u", (unsigned) i);
+        TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, segment_set(name, (uint16_t) (8U + i), 1, 10));
+    }
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_BUFFER_FULL, segment_set("full", 100, 1, 10));
+}
+
+TEST(segment, renders_on_ticks)
+{
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, segment_set("slow", 2, 2, 20));
+
+    // Everything renders on the first frame.
+    TEST_ASSERT_EQUAL(1, segment_schedule(0, 0, 8, ranges));
+    TEST_ASSERT_EQUAL(0, ranges[0].first);
+    TEST_ASSERT_EQUAL(8, ranges[0].count);
+
+    // The segment is skipped until its next tick; the NeoPixels around it render every frame.
+    TEST_ASSERT_EQUAL(2, segment_schedule(FRAME_PERIOD, FRAME_PERIOD / 2U, 8, ranges));
+    TEST_ASSERT_EQUAL(0, ranges[0].first);
+    TEST_ASSERT_EQUAL(2, ranges[0].count);
+    TEST_ASSERT_EQUAL(4, ranges[1].first);
+    TEST_ASSERT_EQUAL(4, ranges[1].count);
+
+    // 20 fps does not divide into 60 fps frame times exactly, but renders every third frame.
+    uint32_t renders = 0;
+    for (timestep_t f = 2; f < 62; f++)
+    {
+        renders += (segment_schedule(f * FRAME_PERIOD, FRAME_PERIOD / 2U, 8, ranges) == 1U) ? 1U : 0U;
+    }
+    TEST_ASSERT_EQUAL(20, renders);
+}
+
+TEST(segment, clipped_to_pixel_count)
+{
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, segment_set("tail", 6, 4, 1));
+    TEST_ASSERT_EQUAL(PIXELKEY_ERROR_NONE, segment_set("beyond", 20, 4, 1));
+
+    TEST_ASSERT_EQUAL(1, segment_schedule(0, 0, 8, ranges));
+    TEST_ASSERT_EQUAL(8, ranges[0].count);
+
+    TEST_ASSERT_EQUAL(1, segment_schedule(FRAME_PERIOD, 0, 8, ranges));
+    TEST_ASSERT_EQUAL(0, ranges[0].first);
+    TEST_ASSERT_EQUAL(6, ranges[0].count);
+
+    // A restart renders every segment on the next frame.
+    segment_restart();
+    TEST_ASSERT_EQUAL(1, segment_schedule(2U * FRAME_PERIOD, 0, 8, ranges));
+    TEST_ASSERT_EQUAL(8, ranges[0].count);
+}
+
+TEST_GROUP_RUNNER(segment)
+{
+    RUN_TEST_CASE(segment, set_validates);
+    RUN_TEST_CASE(segment, renders_on_ticks);
+    RUN_TEST_CASE(segment, clipped_to_pixel_count);
+}